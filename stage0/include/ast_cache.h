@@ -0,0 +1,30 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_AST_CACHE_H
+#define WEAVE_BOOTSTRAP_STAGE0C_AST_CACHE_H
+
+#include "common.h"
+#include "sexpr.h"
+
+/* In-memory cache of parsed source files, used by the compile server and by
+ * batch compiles (-j) so the same includes are not re-read and re-parsed per
+ * request or per input.
+ * Entries are keyed by the path as given plus its canonical path, and are
+ * reparsed when the file's mtime, size or inode changes.
+ *
+ * Disabled by default; while disabled every load reads and parses afresh.
+ * Either way, parses go through the on-disk store (ast_store.h) if set.
+ * Loads are thread-safe; cached trees are shared read-only between threads. */
+void ast_cache_enable(int on);
+
+/* Parsed top-level list of PATH. With the cache enabled the result is a
+ * private copy of the cached tree, so callers may rewrite it (merge_includes
+ * does). */
+Node *ast_cache_load(const char *path);
+
+/* Cached tree for PATH itself, parsing it on a miss. Read-only; with the
+ * cache disabled this is a fresh parse like ast_cache_load. */
+Node *ast_cache_peek(const char *path);
+
+/* Lookup counters since startup. */
+void ast_cache_stats(int *hits, int *misses);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_AST_STORE_H
+#define WEAVE_BOOTSTRAP_STAGE0C_AST_STORE_H
+
+#include "common.h"
+#include "sexpr.h"
+
+/* On-disk cache of parsed files: each entry (<dir>/<key>.wast) is a compact
+ * binary form of one file's Node tree, keyed by the file's canonical path
+ * and a hash of its contents, so edits and moves never hit stale trees.
+ * Entries are mmap'd on load and atom/string text points into the mapping.
+ *
+ * Used by ast_cache.c for every parse once a directory is set
+ * (--ast-cache-dir DIR or $WEAVEC0_AST_CACHE_DIR). */
+
+/* Directory for entries, created if missing; NULL or "" turns the store off. */
+void ast_store_set_dir(const char *dir);
+int ast_store_enabled(void);
+
+/* Tree for the file at CANON whose contents are SRC[0..len), or NULL when
+ * there is no valid entry. Node filenames are set to PATH. */
+Node *ast_store_load(const char *path, const char *canon, const char *src, size_t len);
+
+/* Writes TOP as the entry for CANON/SRC. Failures are silent: the store is
+ * only a cache. */
+void ast_store_save(const char *canon, const char *src, size_t len, const Node *top);
+
+/* Entry hits and misses since startup. */
+void ast_store_stats(int *hits, int *misses);
+
+#endif
@@ -9,6 +9,22 @@ typedef enum {
     BUILTIN_ID_PTR_ADD,
     BUILTIN_ID_GET_FIELD,
     BUILTIN_ID_BITCAST,
+    BUILTIN_ID_CAST,
+    BUILTIN_ID_VEC_LOAD,
+    BUILTIN_ID_VEC_STORE,
+    BUILTIN_ID_VEC_SPLAT,
+    BUILTIN_ID_VEC_ADD,
+    BUILTIN_ID_VEC_SUB,
+    BUILTIN_ID_VEC_MUL,
+    BUILTIN_ID_VEC_FMA,
+    BUILTIN_ID_VEC_MIN,
+    BUILTIN_ID_VEC_MAX,
+    BUILTIN_ID_VEC_REDUCE_ADD,
+    BUILTIN_ID_VEC_REDUCE_MIN,
+    BUILTIN_ID_VEC_REDUCE_MAX,
+    BUILTIN_ID_VEC_SHUFFLE,
+    BUILTIN_ID_VEC_CMP,
+    BUILTIN_ID_VEC_SELECT,
     BUILTIN_ID_NONE  /* Sentinel */
 } BuiltinId;
 
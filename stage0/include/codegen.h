@@ -32,8 +32,10 @@ typedef enum {
 /* Enhanced Value representation - Julia-style with metadata */
 typedef struct {
     TypeRef *type;
-    int kind; /* 0=const_i32, 1=temp, 2=ssa */
+    int kind; /* 0=const_i32, 1=temp, 2=ssa, 3=Int64/float constant */
     int const_i32;
+    long long const_i64; /* kind 3, Int64 */
+    double const_f64;    /* kind 3, Float32/Float64 (already rounded to float for Float32) */
     int temp;
     const char *ssa_name;
     /* Metadata flags for optimization and type tracking */
@@ -45,6 +47,11 @@ typedef struct {
 Value value_const_i32(int v);
 Value value_temp(TypeRef *t, int temp);
 Value value_ssa(TypeRef *t, const char *name);
+Value value_const_i64(long long v);
+/* T is Float32 or Float64. */
+Value value_const_float(TypeRef *t, double v);
+/* LLVM literal of a kind-3 constant: decimal for Int64, hex bits for floats. */
+void emit_const_literal(StrBuf *out, Value v);
 
 /* Helper to check if a type is a pointer */
 int is_pointer_type(TypeRef *t);
@@ -63,9 +70,57 @@ Value ensure_type_ctx(IrCtx *ir, Value v, TypeRef *target, const char *ctx);
 #define ensure_type(ir,v,t) ensure_type_ctx(ir,v,t,NULL)
 
 Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr);
+/* (make T ...) in a fn_entry alloca (ir->entry_allocas) instead of the
+ * heap, for makes whose pointer does not outlive the function. */
+Value cg_make_struct_local(IrCtx *ir, VarEnv *env, Node *list);
 int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_last);
 
+/* Results of compile-time (const-eval e) sites, keyed by the form's node. */
+typedef struct {
+    Node **sites;
+    int *is_string;
+    int *ints;
+    char **strs;
+    int count;
+    int cap;
+} ConstEvalTable;
+
+/* Code generation switches; a NULL CodegenOptions means all defaults (0). */
+typedef struct {
+    int inline_llvm_jit; /* Link llvm-jit IR literals into the module instead of JIT-compiling them at run time */
+    const char *incremental_dir; /* Reuse per-function IR from this directory (fn_cache.h), or NULL */
+    int nsw; /* Emit signed add/sub/mul as nsw: overflow is undefined instead of wrapping */
+    int strict_aliasing; /* Attach TBAA metadata (tbaa.h) to loads and stores */
+} CodegenOptions;
+
 /* Compile top-level forms (program/module) to LLVM IR. */
-void compile_to_llvm_ir(Node *top, StrBuf *out, int generate_tests_mode, StrList *selected_test_names, StrList *selected_tags);
+void compile_to_llvm_ir(Node *top, StrBuf *out, int generate_tests_mode, StrList *selected_test_names, StrList *selected_tags,
+                        const CodegenOptions *opts);
+
+/* Incremental compilation for interactive sessions: each top-level form becomes
+ * its own LLVM module, with functions and types from earlier forms kept in the
+ * session's tables and re-declared as externals. */
+typedef struct {
+    void *fn_table;       /* FnTable* */
+    void *type_env;       /* TypeEnv* */
+    int forms;            /* Forms compiled so far; numbers expression thunks */
+    StrList pending_fns;  /* Functions of the definition awaiting commit or rollback */
+    void *saved_fns;      /* FnTable* from before that definition, or NULL */
+} CompileSession;
+
+void compile_session_init(CompileSession *cs);
+/* Module with the runtime helpers every later form links against. */
+void compile_session_prelude(CompileSession *cs, StrBuf *out);
+/* Compile one form into OUT. Returns 0 if it produced nothing to run
+ * (e.g. a type declaration), 1 for definitions, 2 for an expression whose
+ * parameterless thunk is written to THUNK_NAME with its result type in
+ * *OUT_TYPE (Int32, Int64, Float32, Float64, String, pointer or Void).
+ * A definition's signatures are pending (listed in PENDING_FNS) until
+ * compile_session_commit keeps them or compile_session_rollback restores
+ * the table from before it, e.g. when its module fails to link. */
+int compile_session_form(CompileSession *cs, Node *form, StrBuf *out,
+                         char *thunk_name, size_t thunk_cap, TypeRef **out_type);
+void compile_session_commit(CompileSession *cs);
+void compile_session_rollback(CompileSession *cs);
 
 #endif
@@ -12,6 +12,14 @@
 
 void die(const char *msg);
 void die_at(const char *filename, int line, int col, const char *msg);
+
+/* Fatal errors (die, die_at, diag_fatal) end in fatal_exit(). By default it
+ * calls exit(1); an installed handler runs instead and must not return
+ * (e.g. it longjmps back to the REPL prompt). Pass NULL to restore exit.
+ * The handler is per thread. */
+void set_fatal_handler(void (*handler)(void));
+void fatal_exit(void) __attribute__((noreturn));
+
 void *xmalloc(size_t n);
 void *xrealloc(void *p, size_t n);
 char *xstrdup(const char *s);
@@ -41,6 +41,10 @@ void diag_warn(const char *filename, int line, int col,
 void diag_note(const char *filename, int line, int col,
                const char *message);
 
+/* Suppress warnings (e.g. during an auxiliary compile of the same source).
+ * Returns the previous setting. */
+int diag_suppress_warnings(int suppress);
+
 /* Fatal error: report and exit immediately */
 void diag_fatal(const char *filename, int line, int col,
                 const char *code, const char *message, const char *detail) __attribute__((noreturn));
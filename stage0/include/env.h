@@ -6,10 +6,19 @@
 
 typedef struct {
     StrList names;
-    StrList ssa_names;
-    int *kinds; /* 0=local alloca, 1=param ssa */
+    StrList ssa_names; /* kinds 0/1: the alloca; kind 2: the bound SSA value */
+    int *kinds; /* 0=local alloca, 1=param alloca, 2=SSA value, 3=Int32 constant */
+    int *consts; /* kind 3 */
     TypeRef **types;
     int cap;
+    int serial; /* SSA names made so far, their suffix; not reset by env_scope_end */
+    StrList out_of_scope; /* names dropped by env_scope_end, for diagnostics */
+    /* Names that are set or address-taken in the function and so need an
+     * alloca; NULL keeps every binding in memory. */
+    const StrList *in_memory;
+    /* Pointer lets bound to a (make ...) that never escapes the function;
+     * their structs live in the stack frame. NULL promotes none. */
+    const StrList *stack_makes;
 } VarEnv;
 
 void env_init(VarEnv *e);
@@ -20,5 +29,21 @@ void env_add_param(VarEnv *e, const char *name, TypeRef *type);
 int env_kind(VarEnv *e, const char *name);
 TypeRef *env_type(VarEnv *e, const char *name);
 const char *env_ssa_name(VarEnv *e, const char *name);
+int env_const(VarEnv *e, const char *name);
+
+/* Scopes: bindings added after env_scope_begin are dropped by the matching
+ * env_scope_end, so a let in a branch or loop body is not visible after it
+ * (its alloca or SSA value would not dominate the later uses). */
+int env_scope_begin(VarEnv *e);
+void env_scope_end(VarEnv *e, int scope);
+/* Whether NAME is unbound only because its scope has ended. */
+int env_out_of_scope(VarEnv *e, const char *name);
+
+/* Whether NAME must live in an alloca (see in_memory). */
+int env_needs_memory(VarEnv *e, const char *name);
+/* Rebind the innermost NAME to the SSA value %OPERAND (kind 2) or to the
+ * constant V (kind 3) instead of its alloca. */
+void env_bind_value(VarEnv *e, const char *name, const char *operand);
+void env_bind_const(VarEnv *e, const char *name, int v);
 
 #endif
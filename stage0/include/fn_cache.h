@@ -0,0 +1,55 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_FN_CACHE_H
+#define WEAVE_BOOTSTRAP_STAGE0C_FN_CACHE_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+/* On-disk cache of per-function IR for incremental compiles
+ * (--incremental-dir DIR or $WEAVEC0_INCREMENTAL_DIR). For each compiled
+ * input there is one pack (<dir>/<hash of its canonical path>.wfn) holding,
+ * per function, what its fn form added to the module: the definition, the
+ * string constants it uses and the declarations it needed.
+ * Keys are computed by codegen (program.c) from the form after include
+ * expansion, the signatures and struct layouts it refers to, the codegen
+ * switches and the compiler identity, so a hit can be pasted in verbatim.
+ * The pack is read once when opened and rewritten on close with exactly the
+ * functions of this compile, so stale entries do not accumulate. */
+
+typedef enum {
+    FN_PART_FUNCS,
+    FN_PART_GLOBALS,
+    FN_PART_DECLS,
+    FN_PART_COUNT
+} FnCachePart;
+
+typedef struct {
+    const char *data[FN_PART_COUNT];
+    size_t len[FN_PART_COUNT];
+} FnCacheEntry;
+
+typedef struct FnCache FnCache;
+
+/* Pack for the compile of UNIT (the input file) in DIR; empty if there is
+ * none or it is unreadable. */
+FnCache *fn_cache_open(const char *dir, const char *unit);
+
+/* Entry for KEY, pointing into the cache (valid until fn_cache_close).
+ * Returns 1 on a hit, 0 on a miss. */
+int fn_cache_lookup(FnCache *c, uint64_t key, FnCacheEntry *out);
+
+/* Records E (copied) as the entry for KEY. */
+void fn_cache_add(FnCache *c, uint64_t key, const FnCacheEntry *e);
+
+/* Notes a function that cannot be cached (it uses const-eval or llvm-jit). */
+void fn_cache_note_uncacheable(FnCache *c);
+
+/* Writes the pack back if this compile changed it, and frees C. Write
+ * failures are silent: it is only a cache. */
+void fn_cache_close(FnCache *c);
+
+/* Functions reused, recompiled, and recompiled because they cannot be
+ * cached, since startup. */
+void fn_cache_stats(int *hits, int *misses, int *uncacheable);
+
+#endif
@@ -11,14 +11,22 @@ typedef struct {
     TypeRef **ret_types;
     int *param_counts;
     TypeRef ***param_types;
+    int *pure;      /* declared (attrs pure); builtins never are */
+    int *index;     /* open-addressing slots over names: entry + 1, or 0 when empty */
+    int index_cap;  /* power of two, at least twice count */
 } FnTable;
 
 void fn_table_init(FnTable *t);
+void fn_table_free(FnTable *t);
+/* DST (uninitialized) becomes an independent copy of SRC. */
+void fn_table_copy(FnTable *dst, const FnTable *src);
 void fn_table_add(FnTable *t, const char *name, TypeRef *ret_type, int param_count, TypeRef **param_types);
 int fn_table_find(FnTable *t, const char *name);
 TypeRef *fn_table_ret_type(FnTable *t, const char *name, TypeRef *default_ret);
 TypeRef *fn_table_param_type(FnTable *t, const char *name, int index, TypeRef *default_ty);
 int fn_table_param_count(FnTable *t, const char *name);
+void fn_table_set_pure(FnTable *t, const char *name);
+int fn_table_is_pure(FnTable *t, const char *name);
 
 #endif
 
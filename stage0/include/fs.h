@@ -4,9 +4,32 @@
 #include "common.h"
 #include "sexpr.h"
 
+#include <stdio.h>
+
 char *read_file_all(const char *path);
 
+/* Creates directory DIR if missing. Returns 0 if DIR is a directory;
+ * otherwise warns "cannot use WHAT: DIR" and returns -1. */
+int ensure_dir(const char *dir, const char *what);
+
+/* Reads exactly N bytes from FD, retrying short reads and EINTR. Returns 0,
+ * or -1 on error or end of file. */
+int read_full(int fd, void *buf, size_t n);
+
+/* Writes the whole file to F; returns 0 on success. */
+typedef int (*FileWriterFn)(FILE *f, void *ctx);
+
+/* Writes PATH through WRITE into a unique temporary next to it and renames
+ * that into place, so concurrent compiles never see a partial file. Returns
+ * 0 on success; on failure the temporary is removed and PATH is untouched. */
+int write_file_atomic(const char *path, FileWriterFn write, void *ctx);
+
 /* Resolves and merges (include "...") into the provided parsed top list. */
 void merge_includes(Node *top, StrList *included_files, const char *base_dir, StrList *include_dirs, const char *current_filename);
 
+/* Loads PATH and everything it includes into the AST cache (ast_cache.h)
+ * without merging anything. Unresolvable includes are skipped; the compile
+ * that follows reports them. */
+void prefetch_includes(const char *path, StrList *include_dirs);
+
 #endif
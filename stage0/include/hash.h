@@ -0,0 +1,28 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_HASH_H
+#define WEAVE_BOOTSTRAP_STAGE0C_HASH_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+/* 64-bit FNV-1a, for cache keys (not for security). Start from HASH_SEED
+ * and pass the previous result to hash several pieces in sequence. */
+#define HASH_SEED 14695981039346656037ULL
+
+uint64_t hash_bytes(const void *data, size_t n, uint64_t h);
+
+/* Hashes S including its terminating NUL, so ("ab","c") != ("a","bc"). */
+uint64_t hash_str(const char *s, uint64_t h);
+
+/* Continues *H over the contents of the file at PATH. Returns 0, or -1
+ * (leaving *H alone) when it cannot be read. */
+int hash_file(const char *path, uint64_t *h);
+
+/* Identity of the running compiler (a hash of its executable), so caches
+ * keyed on it are invalidated by a rebuild. Computed once per process. */
+uint64_t hash_compiler_identity(void);
+
+/* Lowercase hex of H in OUT (16 digits plus NUL). */
+void hash_hex(uint64_t h, char out[17]);
+
+#endif
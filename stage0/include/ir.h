@@ -20,6 +20,25 @@ typedef struct {
     StrList selected_test_names; /* Filters for selected test names */
     StrList selected_tags;        /* Filters for selected tags */
     int saw_expect;               /* Per-test flag: saw any expect-* assertion */
+    int jit_sites;                /* llvm-jit call sites emitted (per-site fn pointer caches) */
+    int strings;                  /* String constant globals emitted (@.strN / @.tstrN) */
+    int allow_untested;           /* When nonzero, fns may omit (tests ...) (interactive sessions) */
+    int strict_names;             /* When nonzero, an unbound name is an error, not 0 (interactive sessions) */
+    void *const_evals;            /* ConstEvalTable*: evaluated (const-eval e) results, or NULL */
+    int const_eval_inline;        /* When nonzero, (const-eval e) compiles e in place (evaluation pass) */
+    int inline_llvm_jit;          /* When nonzero, llvm-jit IR literals are linked in ahead of time */
+    StrList inline_jit_irs;       /* IR literal per linked llvm-jit function */
+    StrList inline_jit_fns;       /* Function each literal defines */
+    StrList inline_jit_syms;      /* Module-unique symbol it is linked in as */
+    void *fn_cache;               /* FnCache*: per-function IR cache (incremental mode), or NULL */
+    const char *string_scope;     /* When set, string globals are named @.str.<scope>.N */
+    int module_ccalls;            /* declared_ccalls entries made for the whole module (runtime decls) */
+    int nsw;                      /* When nonzero, add/sub/mul carry nsw (signed overflow is UB) */
+    int strict_aliasing;          /* When nonzero, loads and stores carry !tbaa (tbaa.h) */
+    void *tbaa;                   /* TbaaTable*, built by tbaa_init, or NULL */
+    StrBuf metadata;              /* Module-level metadata nodes, appended after the functions */
+    int metadata_ids;             /* Next free !N */
+    StrBuf *entry_allocas;        /* When set, allocas hoisted into the current function's fn_entry block */
 } IrCtx;
 
 void ir_init(IrCtx *ir, StrBuf *out);
@@ -28,5 +47,7 @@ int ir_fresh_label(IrCtx *ir);
 void ir_emit_temp(StrBuf *out, int t);
 void ir_emit_label_ref(StrBuf *out, int lbl);
 void ir_emit_label_def(StrBuf *out, int lbl);
+/* Name of string constant ID: PREFIX (e.g. "@.str") then the scope, if any, and ID. */
+void ir_emit_string_name(StrBuf *out, const IrCtx *ir, const char *prefix, int id);
 
 #endif
@@ -9,6 +9,10 @@ extern "C" {
 
 /* LLVM compilation interface - replaces clang system calls */
 
+/* Initialize the LLVM targets used for compilation. Idempotent; the other
+ * entry points call it on demand, the compile server calls it up front. */
+void llvm_compile_init(void);
+
 /* Compile LLVM IR string to object file (internal - takes explicit length).
  * Returns 0 on success, non-zero on error.
  * opt_level: 0=none, 1=less, 2=default, 3=aggressive
@@ -37,6 +41,18 @@ int llvm_compile_ir_to_assembly(const char *ir_string, const char *output_path,
  */
 int llvm_link_objects(const char *object_files, const char *extra_flags, const char *output_path);
 
+/* Link llvm-jit IR literals into a module ahead of time.
+ * Each irs[i] must define fns[i]; it is linked in as syms[i] with internal
+ * linkage (the module calls it through a matching declaration) and the
+ * literal's other definitions are internalized, so the result has no runtime
+ * JIT dependency and the optimizer can inline across the boundary.
+ * On success returns 0 and stores the linked module text in *out_ir (free()
+ * it). Returns non-zero on parse or link errors, which go to stderr.
+ */
+int llvm_link_ir_literals(const char *module_ir, size_t module_len, int count,
+                          const char *const *irs, const char *const *fns,
+                          const char *const *syms, char **out_ir);
+
 /* Compile LLVM IR string to object file with address sanitizer.
  * Returns 0 on success, non-zero on error.
  * opt_level: 0=none, 1=less, 2=default, 3=aggressive
@@ -50,15 +66,66 @@ int llvm_compile_ir_to_object_asan(const char *ir_string, size_t ir_len,
 /* Opaque handle for JIT session */
 typedef void* LLVMJITSessionRef;
 
-/* Create a new JIT session. Returns NULL on error. */
+/* Create a new JIT session. Returns NULL on error.
+ * Equivalent to llvm_jit_create_session_ex(2, NULL).
+ */
 LLVMJITSessionRef llvm_jit_create_session(void);
 
+/* Create a new JIT session with explicit code generation options.
+ * Returns NULL on error.
+ * opt_level: 0=none, 1=less, 2=default, 3=aggressive
+ * cache_dir: directory for the on-disk object cache. When NULL or empty,
+ *            $WEAVE_JIT_CACHE_DIR is used; if that is unset too, caching is
+ *            disabled. Cached objects are keyed by a hash of the module IR,
+ *            the target triple and opt_level, so stale entries are never hit.
+ * Profiling: set WEAVE_JIT_PERF to expose JIT'd functions to `perf`.
+ *   map     - append symbols to /tmp/perf-<pid>.map (read by `perf report`)
+ *   jitdump - write a jitdump file for `perf inject --jit` (needs an LLVM
+ *             built with LLVM_USE_PERF; falls back to map otherwise)
+ *   1       - both
+ */
+LLVMJITSessionRef llvm_jit_create_session_ex(int opt_level, const char *cache_dir);
+
+/* Report object cache hits and misses for a session.
+ * Returns 0 on success, non-zero if the session has no object cache.
+ */
+int llvm_jit_cache_stats(LLVMJITSessionRef session, unsigned *hits, unsigned *misses);
+
+/* Enable tiered compilation for modules added after this call.
+ * Functions start as tier-0 code (codegen at O0) behind a stub that counts
+ * calls; after `threshold` calls the function is recompiled at opt_level on a
+ * background thread and the stub is atomically redirected to the new code.
+ * threshold 0 disables tiering. $WEAVE_JIT_TIER=<threshold> enables it (at
+ * O2) for every new session. Tier-0 modules bypass the object cache.
+ * Returns 0 on success, non-zero on error.
+ */
+int llvm_jit_set_tiering(LLVMJITSessionRef session, unsigned threshold, int opt_level);
+
+/* Wait for queued tier-up recompilations to finish.
+ * Returns the number of functions promoted so far.
+ */
+unsigned llvm_jit_tier_sync(LLVMJITSessionRef session);
+
 /* Add a module to the JIT session and compile it.
  * Returns 0 on success, non-zero on error.
  * The module IR string should be a complete LLVM module.
  */
 int llvm_jit_add_module(LLVMJITSessionRef session, const char *ir_string, size_t ir_len);
 
+/* Add a module in a new layer that shadows all earlier layers.
+ * Returns 0 on success, non-zero on error.
+ * Symbols referenced by the module resolve against the newest layer that
+ * defines them, so adding a function whose name already exists redefines it
+ * for modules added afterwards (modules already added keep their binding).
+ * Lookups search the newest layer first once any layer exists.
+ */
+int llvm_jit_add_module_layer(LLVMJITSessionRef session, const char *ir_string, size_t ir_len);
+
+/* Withdraw the newest layer, e.g. one whose functions failed to link: later
+ * layers and lookups no longer see it. Returns non-zero if there is none.
+ */
+int llvm_jit_drop_last_layer(LLVMJITSessionRef session);
+
 /* Look up a function by name and return its address.
  * Returns NULL if function not found.
  * The function pointer can be cast to the appropriate function type.
@@ -70,8 +137,9 @@ void llvm_jit_dispose_session(LLVMJITSessionRef session);
 
 /* Convenience function: compile IR and get function pointer in one call.
  * Returns function pointer on success, NULL on error.
- * This creates a temporary session, adds the module, looks up the function,
- * and disposes the session. For multiple lookups, use the session API above.
+ * This creates a session, adds the module and looks up the function. The
+ * session is kept alive so the returned pointer stays valid for the rest of
+ * the process. For multiple lookups, use the session API above.
  */
 void* llvm_jit_compile_and_lookup(const char *ir_string, size_t ir_len, const char *function_name);
 
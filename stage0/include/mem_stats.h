@@ -0,0 +1,57 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_MEM_STATS_H
+#define WEAVE_BOOTSTRAP_STAGE0C_MEM_STATS_H
+
+#include <stddef.h>
+
+/* Allocation accounting for --mem-report.
+ * xmalloc/xrealloc (and StrBuf growth) charge their bytes to the current
+ * category of the calling thread. Subsystems switch categories around their
+ * allocating entry points:
+ *
+ *     MemCategory prev = mem_category_enter(MEM_TYPES);
+ *     ...
+ *     mem_category_leave(prev);
+ *
+ * StrBuf growth while in MEM_CODEGEN is charged to MEM_IR instead: those
+ * are the IR text buffers. Bytes are what was requested (a realloc counts
+ * only its growth); frees are not tracked, so totals are bytes allocated,
+ * not bytes live. LLVM allocates outside xmalloc: its entry is the growth
+ * in resident memory across each backend run.
+ *
+ * State is per thread (batch compiles report each input separately) and
+ * counting is off until mem_stats_enable(1). */
+
+typedef enum {
+    MEM_OTHER,
+    MEM_LEXER,
+    MEM_AST,
+    MEM_TYPES,
+    MEM_ENV,
+    MEM_CODEGEN,
+    MEM_IR,
+    MEM_LLVM,
+    MEM_CATEGORY_COUNT
+} MemCategory;
+
+/* Nonzero while this thread is counting; checked inline by xmalloc. */
+extern __thread int mem_stats_active;
+
+/* Turns counting on or off for this thread and zeroes its counters. */
+void mem_stats_enable(int on);
+
+/* Makes C the current category; returns the previous one for _leave. */
+MemCategory mem_category_enter(MemCategory c);
+void mem_category_leave(MemCategory prev);
+
+/* Charges BYTES (one allocation) to the current category. */
+void mem_stats_note(size_t bytes, int strbuf);
+/* Charges BYTES to C directly, for memory not allocated by xmalloc. */
+void mem_stats_note_in(MemCategory c, size_t bytes);
+
+/* Resident set size of the process right now, in bytes (0 if unknown). */
+size_t mem_current_rss(void);
+
+/* Prints the per-category totals and the process's peak RSS to stdout. */
+void mem_stats_print(void);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_REPL_H
+#define WEAVE_BOOTSTRAP_STAGE0C_REPL_H
+
+#include "common.h"
+
+/* Interactive read-eval-print loop on stdin, backed by the ORC JIT.
+ * Definitions persist across inputs; redefining a function shadows the old
+ * one for subsequently entered forms. Returns the process exit code. */
+int repl_main(StrList *include_dirs, int opt_level);
+
+#endif
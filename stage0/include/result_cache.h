@@ -0,0 +1,26 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_RESULT_CACHE_H
+#define WEAVE_BOOTSTRAP_STAGE0C_RESULT_CACHE_H
+
+#include "common.h"
+
+/* Whole-compilation result cache (--cache-dir DIR or $WEAVEC0_CACHE_DIR):
+ * each entry (<dir>/<hash of key>.out) is the full key followed by a
+ * finished output file (.ll, .o or executable). main.c builds the key from
+ * the merged program after include expansion, the compiler identity and
+ * every flag that changes the output, so a hit is copied to the output path
+ * without generating or compiling anything. The stored key is compared on
+ * every fetch, so two keys sharing a hash never return each other's output. */
+
+/* Copies the output stored under KEY to OUTPUT, with the entry's
+ * permissions. Returns 1 on a hit, 0 when there is no entry for KEY (or it
+ * cannot be copied). */
+int result_cache_fetch(const char *dir, const StrBuf *key, const char *output);
+
+/* Stores a copy of OUTPUT as the entry for KEY. Failures are silent: it is
+ * only a cache. */
+void result_cache_store(const char *dir, const StrBuf *key, const char *output);
+
+/* Hits and misses since startup. */
+void result_cache_stats(int *hits, int *misses);
+
+#endif
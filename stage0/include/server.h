@@ -0,0 +1,25 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_SERVER_H
+#define WEAVE_BOOTSTRAP_STAGE0C_SERVER_H
+
+#include "common.h"
+
+/* A command-line entry point: takes argv as main() does, returns an exit code. */
+typedef int (*ServerCommandFn)(int argc, char **argv);
+
+/* Compile server on a Unix socket.
+ * Each request carries the client's working directory, argv and its stdout
+ * and stderr descriptors. The server first runs PREFETCH in its own process
+ * (warming the AST cache, which is enabled for the server), then forks a
+ * worker that runs COMPILE with the client's descriptors and reports the
+ * exit code back. State warmed in the server (LLVM targets, parsed
+ * includes) is inherited by every worker. Connections from other users
+ * (SO_PEERCRED) are refused.
+ * Runs until killed; returns non-zero if the socket cannot be set up. */
+int server_main(const char *socket_path, ServerCommandFn compile, ServerCommandFn prefetch);
+
+/* Run argv through the server at SOCKET_PATH, with this process's stdout
+ * and stderr. Returns the compile's exit code, or -1 when no server is
+ * listening (the caller should compile locally). */
+int server_client_run(const char *socket_path, int argc, char **argv);
+
+#endif
@@ -28,6 +28,13 @@ int is_atom(Node *n, const char *s);
 Node *list_nth(Node *list, int idx);
 const char *atom_text(Node *n);
 void node_list_push(Node *list, Node *child);
+/* Copy of the tree structure under N. Atom/string text and filenames are
+ * shared with the original, which must outlive the copy. */
+Node *node_clone(const Node *n);
+/* Appends to OUT a byte string that identifies the tree under N: kinds,
+ * text and source locations, which reach the output through diagnostics
+ * embedded in test builds. */
+void node_key(const Node *n, StrBuf *out);
 
 #endif
 
@@ -15,6 +15,8 @@ typedef struct {
     int emitted_intrinsics;
     int emitted_gep;
     int emitted_bitcast;
+    int emitted_cast;         /* (cast T x) numeric conversions */
+    int emitted_vec_ops;      /* vec-* SIMD builtins */
     int emitted_ptr_add;
     int emitted_get_field;
     
@@ -36,11 +38,15 @@ typedef struct {
     /* Logical operations */
     int emitted_and;
     int emitted_or;
+    int short_circuits; /* &&/|| whose right operand is evaluated in its own block */
     
     /* Memory operations */
     int emitted_load;
     int emitted_store;
     int emitted_alloca;
+    int ssa_bindings;   /* lets and params bound to SSA values, without an alloca */
+    int stack_makes;    /* makes that do not escape, placed in the frame instead of malloc'd */
+    int region_makes;   /* make-in bump allocations */
     
     /* Function calls */
     int emitted_calls;
@@ -54,14 +60,19 @@ typedef struct {
     /* Control flow */
     int emitted_branches;
     int emitted_returns;
+    int counted_loops;        /* (for ...) loops with an SSA induction variable */
     
     /* Other */
     int emitted_string_lits;
     int emitted_constants;
+
+    /* Front-end folding */
+    int folded_constants;     /* arith/cmp/logic ops replaced by a constant or an operand */
+    int eliminated_branches;  /* if-stmt/while arms dropped for a constant condition */
 } CompilerStats;
 
-/* Global statistics instance */
-extern CompilerStats compiler_stats;
+/* Statistics instance (per thread) */
+extern __thread CompilerStats compiler_stats;
 
 /* Initialize statistics */
 void stats_init(void);
@@ -0,0 +1,33 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0_TBAA_H
+#define WEAVE_BOOTSTRAP_STAGE0_TBAA_H
+
+#include "ir.h"
+#include "types.h"
+
+struct TypeEnv;
+
+/* Type-based alias metadata for -fstrict-aliasing.
+ * The tree has a scalar per Int32/Int64/Float32/Float64 and an "any
+ * pointer" scalar under a char root, plus one struct-path node per TypeEnv
+ * struct whose layout is modelled, so an Int32 field store is known not to
+ * clobber a pointer field or an Int32 field of another struct. Pointers share one node: Weave bitcasts between them
+ * freely.
+ *
+ * tbaa_init builds the tree once per module into ir->metadata when
+ * ir->strict_aliasing is set; loads and stores then append their tag. With
+ * it unset the emit calls write nothing. */
+void tbaa_init(IrCtx *ir, struct TypeEnv *tenv);
+
+/* Length of the tree at the start of ir->metadata (0 without one); loop
+ * metadata follows it. */
+size_t tbaa_tree_len(IrCtx *ir);
+
+/* ", !tbaa !N" for a load or store of a TY value (scalar types, and
+ * vectors, which take their element's tag). */
+void tbaa_emit_access(IrCtx *ir, StrBuf *out, TypeRef *ty);
+
+/* Same for field FI of struct type STY; falls back to the field's scalar
+ * tag when the struct has no node. */
+void tbaa_emit_field(IrCtx *ir, StrBuf *out, TypeRef *sty, int fi);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef WEAVE_BOOTSTRAP_STAGE0C_TIMING_H
+#define WEAVE_BOOTSTRAP_STAGE0C_TIMING_H
+
+#include <stdio.h>
+
+/* Phase timers for -ftime-report / --time-report=json.
+ * Timers nest: timing_push("parse") inside timing_push("merge includes")
+ * is reported as a child of it. Time spent in the same phase under the
+ * same parent is summed, with a count (e.g. one "emit function" per fn).
+ * Wall time is elapsed time; CPU time is this thread's CPU time, so it
+ * leaves out child processes such as the linker.
+ *
+ * State is per thread (batch compiles time each input separately) and
+ * everything is a no-op until timing_enable(1) or timing_trace_open().
+ *
+ * With --trace=FILE every phase is also recorded as a Chrome trace event
+ * (chrome://tracing, ui.perfetto.dev), one span per push/pop, tagged with
+ * the thread it ran on. */
+
+/* Turns timing on or off for this thread and discards recorded timers. */
+void timing_enable(int on);
+int timing_enabled(void);
+
+/* Starts phase NAME (a string that outlives the report, e.g. a literal)
+ * under the innermost running phase. */
+void timing_push(const char *name);
+/* Like timing_push; in a trace the span is named "NAME DETAIL" (e.g. the
+ * function or file it covers). DETAIL must stay valid until the pop and
+ * may be NULL. */
+void timing_push_detail(const char *name, const char *detail);
+/* Ends the innermost running phase. */
+void timing_pop(void);
+/* Ends every phase still running on this thread, innermost first: after a
+ * fatal error has unwound past their timing_pop calls. */
+void timing_unwind(void);
+
+/* Starts recording trace events for all threads into PATH. Returns 0, or
+ * -1 if PATH cannot be written. */
+int timing_trace_open(const char *path);
+/* Finishes the trace file; also runs at exit (after timing_unwind), so
+ * failed builds still leave a readable trace that includes the phase that
+ * failed. */
+void timing_trace_close(void);
+
+/* Writes the recorded phases for the compile of INPUT: a table like
+ * clang's -ftime-report, or with JSON one JSON object on a single line:
+ *   {"input":..., "phases":[{"name":..., "count":N, "wall_ms":W,
+ *    "cpu_ms":C, "children":[...]}, ...]} */
+void timing_report(FILE *out, const char *input, int json);
+
+#endif
@@ -34,6 +34,9 @@ TypeRef *type_env_resolve_alias(TypeEnv *e, const char *name);
 void type_env_add_struct(TypeEnv *e, const char *name, int field_count, char **field_names, TypeRef **field_types);
 StructDef *type_env_find_struct(TypeEnv *e, const char *name);
 int struct_field_index(StructDef *s, const char *field);
+/* Byte offset of field FI on x86-64, with its size in *SIZE; -1 when a
+ * field up to FI has a layout that is not modelled (nested structs). */
+int struct_field_offset(StructDef *s, int fi, int *size);
 
 #endif
 
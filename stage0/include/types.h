@@ -11,22 +11,38 @@ typedef enum {
     TY_I8PTR,
     TY_VOID,
     TY_STRUCT,
-    TY_PTR
+    TY_PTR,
+    TY_I64,
+    TY_F32,
+    TY_F64,
+    TY_VEC
 } TypeKind;
 
 struct TypeRef {
     TypeKind kind;
     const char *name;   /* for TY_STRUCT */
-    TypeRef *pointee;   /* for TY_PTR */
+    TypeRef *pointee;   /* for TY_PTR; element type for TY_VEC */
+    int lanes;          /* for TY_VEC */
 };
 
 TypeRef *type_i32(void);
 TypeRef *type_i8ptr(void);
 TypeRef *type_void(void);
+TypeRef *type_i64(void);
+TypeRef *type_f32(void);
+TypeRef *type_f64(void);
 TypeRef *type_struct(const char *name);
 TypeRef *type_ptr(TypeRef *pointee);
+/* (vec T N): N lanes of the Int32/Int64/Float32/Float64 type ELEM. */
+TypeRef *type_vec(TypeRef *elem, int lanes);
+/* Lane counts (vec T N) accepts: powers of two from 2 to 64. */
+int type_vec_lanes_valid(long lanes);
 
 int type_eq(TypeRef *a, TypeRef *b);
+/* Int32 or Int64. */
+int type_is_int(TypeRef *t);
+/* Float32 or Float64. */
+int type_is_float(TypeRef *t);
 void emit_llvm_type(StrBuf *out, TypeRef *t);
 
 /* Forward-declared to avoid header cycles. */
@@ -0,0 +1,147 @@
+#include "ast_cache.h"
+
+#include "ast_store.h"
+#include "fs.h"
+#include "mem_stats.h"
+#include "timing.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct {
+    char *path;  /* as given; node filenames use this spelling */
+    char *canon; /* realpath, so a relative path from another cwd misses */
+    struct timespec mtime;
+    off_t size;
+    ino_t ino;
+    Node *top;
+} AstCacheEntry;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static int cache_on = 0;
+static AstCacheEntry *entries = NULL;
+static int entry_count = 0;
+static int entry_cap = 0;
+static int cache_hits = 0;
+static int cache_misses = 0;
+
+void ast_cache_enable(int on) {
+    cache_on = on;
+}
+
+void ast_cache_stats(int *hits, int *misses) {
+    pthread_mutex_lock(&cache_lock);
+    if (hits) *hits = cache_hits;
+    if (misses) *misses = cache_misses;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* Parse PATH, or load it from the on-disk store when one is configured. */
+static Node *parse_file(const char *path) {
+    char *src;
+    char *canon = NULL;
+    Node *top = NULL;
+    MemCategory prev;
+    timing_push_detail("read file", path);
+    src = read_file_all(path);
+    timing_pop();
+    prev = mem_category_enter(MEM_AST);
+    if (ast_store_enabled()) {
+        canon = realpath(path, NULL);
+        timing_push_detail("AST store load", path);
+        if (canon) top = ast_store_load(path, canon, src, strlen(src));
+        timing_pop();
+    }
+    if (!top) {
+        timing_push_detail("parse", path);
+        top = parse_top(src, path);
+        timing_pop();
+        if (canon) {
+            timing_push_detail("AST store save", path);
+            ast_store_save(canon, src, strlen(src), top);
+            timing_pop();
+        }
+    }
+    mem_category_leave(prev);
+    free(canon);
+    free(src);
+    return top;
+}
+
+static AstCacheEntry *find_entry(const char *path, const char *canon) {
+    int i;
+    for (i = 0; i < entry_count; i++) {
+        if (strcmp(entries[i].canon, canon) == 0 && strcmp(entries[i].path, path) == 0) return &entries[i];
+    }
+    return NULL;
+}
+
+static int entry_current(const AstCacheEntry *e, const struct stat *st) {
+    return e->mtime.tv_sec == st->st_mtim.tv_sec && e->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+           e->size == st->st_size && e->ino == st->st_ino;
+}
+
+Node *ast_cache_peek(const char *path) {
+    struct stat st;
+    char *canon;
+    AstCacheEntry *e;
+    Node *top;
+
+    if (!cache_on) return parse_file(path);
+    canon = realpath(path, NULL);
+    if (!canon || stat(canon, &st) != 0) {
+        /* Let read_file_all report the missing file. */
+        free(canon);
+        return parse_file(path);
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    e = find_entry(path, canon);
+    if (e && entry_current(e, &st)) {
+        cache_hits++;
+        top = e->top;
+        pthread_mutex_unlock(&cache_lock);
+        free(canon);
+        return top;
+    }
+    cache_misses++;
+    pthread_mutex_unlock(&cache_lock);
+
+    /* Parse unlocked: a syntax error may longjmp out, and other files can be
+     * served meanwhile. Two threads racing on one file both parse it. */
+    top = parse_file(path);
+
+    pthread_mutex_lock(&cache_lock);
+    e = find_entry(path, canon);
+    if (!e) {
+        if (entry_count + 1 > entry_cap) {
+            entry_cap = entry_cap ? entry_cap * 2 : 16;
+            entries = (AstCacheEntry *)xrealloc(entries, (size_t)entry_cap * sizeof(AstCacheEntry));
+        }
+        e = &entries[entry_count++];
+        e->path = xstrdup(path);
+        e->canon = canon;
+        canon = NULL;
+    }
+    /* A replaced tree is leaked: copies handed out earlier still share its text. */
+    e->top = top;
+    e->mtime = st.st_mtim;
+    e->size = st.st_size;
+    e->ino = st.st_ino;
+    pthread_mutex_unlock(&cache_lock);
+    free(canon);
+    return top;
+}
+
+Node *ast_cache_load(const char *path) {
+    Node *top;
+    MemCategory prev;
+    if (!cache_on) return parse_file(path);
+    top = ast_cache_peek(path);
+    prev = mem_category_enter(MEM_AST);
+    top = node_clone(top);
+    mem_category_leave(prev);
+    return top;
+}
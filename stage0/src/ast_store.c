@@ -0,0 +1,244 @@
+#include "ast_store.h"
+
+#include "fs.h"
+#include "hash.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Entry layout (host byte order; entries are not meant to be portable):
+ *   WastHeader
+ *   WastNode[node_count]   pre-order: a list's children follow it
+ *   char strings[strings_len]  NUL-terminated text, including the canonical
+ *                              path the entry was written for */
+#define WAST_VERSION 1u
+#define WAST_NO_TEXT 0xFFFFFFFFu
+#define WAST_HAS_FILENAME 0x100u
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t content_hash;
+    uint32_t node_count;
+    uint32_t strings_len;
+    uint32_t canon_off;
+    uint32_t reserved;
+    uint64_t body_hash; /* of everything after the header */
+} WastHeader;
+
+typedef struct {
+    uint32_t kind; /* NodeKind | WAST_HAS_FILENAME */
+    uint32_t line;
+    uint32_t col;
+    uint32_t text; /* offset into strings, or WAST_NO_TEXT */
+    uint32_t count;
+} WastNode;
+
+static char *store_dir = NULL;
+static int store_hits = 0;
+static int store_misses = 0;
+
+void ast_store_set_dir(const char *dir) {
+    free(store_dir);
+    store_dir = NULL;
+    if (!dir || !*dir || ensure_dir(dir, "AST cache directory") != 0) return;
+    store_dir = xstrdup(dir);
+}
+
+int ast_store_enabled(void) {
+    return store_dir != NULL;
+}
+
+void ast_store_stats(int *hits, int *misses) {
+    if (hits) *hits = store_hits;
+    if (misses) *misses = store_misses;
+}
+
+static char *entry_path(const char *canon, uint64_t content_hash) {
+    char hex[17];
+    StrBuf path;
+    hash_hex(hash_str(canon, content_hash), hex);
+    sb_init(&path);
+    sb_append(&path, store_dir);
+    sb_append(&path, "/");
+    sb_append(&path, hex);
+    sb_append(&path, ".wast");
+    return path.data;
+}
+
+/* ---- load ---- */
+
+typedef struct {
+    const WastNode *recs;
+    uint32_t count;
+    uint32_t next;
+    const char *strings;
+    uint32_t strings_len;
+    Node *nodes;
+    const char *filename;
+} WastReader;
+
+static Node *read_node(WastReader *rd) {
+    const WastNode *r;
+    Node *n;
+    uint32_t kind;
+    uint32_t i;
+
+    if (rd->next >= rd->count) return NULL;
+    r = &rd->recs[rd->next];
+    n = &rd->nodes[rd->next];
+    rd->next++;
+    kind = r->kind & 0xFFu;
+    if (kind != N_ATOM && kind != N_STRING && kind != N_LIST) return NULL;
+    if (r->text != WAST_NO_TEXT && r->text >= rd->strings_len) return NULL;
+
+    n->kind = (NodeKind)kind;
+    n->text = r->text == WAST_NO_TEXT ? NULL : (char *)(rd->strings + r->text);
+    n->filename = (r->kind & WAST_HAS_FILENAME) ? rd->filename : NULL;
+    n->line = (int)r->line;
+    n->col = (int)r->col;
+    n->items = NULL;
+    n->count = 0;
+    n->cap = 0;
+    if (n->kind != N_LIST) return n;
+
+    if (r->count > rd->count - rd->next) return NULL;
+    /* Lists get their own item arrays: merge_includes appends to them. */
+    if (r->count > 0) n->items = (Node **)xmalloc((size_t)r->count * sizeof(Node *));
+    n->count = n->cap = (int)r->count;
+    for (i = 0; i < r->count; i++) {
+        n->items[i] = read_node(rd);
+        if (!n->items[i]) return NULL;
+    }
+    return n;
+}
+
+Node *ast_store_load(const char *path, const char *canon, const char *src, size_t len) {
+    uint64_t content_hash;
+    char *file;
+    struct stat st;
+    const char *map;
+    const WastHeader *h;
+    WastReader rd;
+    Node *top = NULL;
+    int fd;
+
+    if (!store_dir) return NULL;
+    content_hash = hash_bytes(src, len, HASH_SEED);
+    file = entry_path(canon, content_hash);
+    fd = open(file, O_RDONLY);
+    free(file);
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WastHeader)) {
+        if (fd >= 0) close(fd);
+        __sync_fetch_and_add(&store_misses, 1);
+        return NULL;
+    }
+    map = (const char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == (const char *)MAP_FAILED) {
+        __sync_fetch_and_add(&store_misses, 1);
+        return NULL;
+    }
+
+    h = (const WastHeader *)map;
+    if (memcmp(h->magic, "WAST", 4) == 0 && h->version == WAST_VERSION && h->content_hash == content_hash &&
+        h->node_count > 0 && h->strings_len > 0 &&
+        (size_t)st.st_size == sizeof(WastHeader) + (size_t)h->node_count * sizeof(WastNode) + h->strings_len &&
+        hash_bytes(map + sizeof(WastHeader), (size_t)st.st_size - sizeof(WastHeader), HASH_SEED) == h->body_hash) {
+        rd.recs = (const WastNode *)(map + sizeof(WastHeader));
+        rd.count = h->node_count;
+        rd.next = 0;
+        rd.strings = map + sizeof(WastHeader) + (size_t)h->node_count * sizeof(WastNode);
+        rd.strings_len = h->strings_len;
+        if (rd.strings[rd.strings_len - 1] == '\0' && h->canon_off < rd.strings_len &&
+            strcmp(rd.strings + h->canon_off, canon) == 0) {
+            rd.nodes = (Node *)xmalloc((size_t)rd.count * sizeof(Node));
+            rd.filename = xstrdup(path);
+            top = read_node(&rd);
+            if (rd.next != rd.count) top = NULL;
+        }
+    }
+    if (!top) {
+        /* Corrupt or colliding entry: reparse (and overwrite it). */
+        munmap((void *)map, (size_t)st.st_size);
+        __sync_fetch_and_add(&store_misses, 1);
+        return NULL;
+    }
+    /* The mapping stays for the life of the process: node text points into it. */
+    __sync_fetch_and_add(&store_hits, 1);
+    return top;
+}
+
+/* ---- save ---- */
+
+static uint32_t put_string(StrBuf *strings, const char *s) {
+    uint32_t off = (uint32_t)strings->len;
+    sb_append_n(strings, s, strlen(s) + 1);
+    return off;
+}
+
+static uint32_t put_node(StrBuf *recs, StrBuf *strings, const Node *n) {
+    WastNode r;
+    uint32_t total = 1;
+    int i;
+    r.kind = (uint32_t)n->kind | (n->filename ? WAST_HAS_FILENAME : 0u);
+    r.line = (uint32_t)n->line;
+    r.col = (uint32_t)n->col;
+    r.text = n->text ? put_string(strings, n->text) : WAST_NO_TEXT;
+    r.count = n->kind == N_LIST ? (uint32_t)n->count : 0u;
+    sb_append_n(recs, (const char *)&r, sizeof(r));
+    if (n->kind == N_LIST) {
+        for (i = 0; i < n->count; i++) total += put_node(recs, strings, n->items[i]);
+    }
+    return total;
+}
+
+typedef struct {
+    const WastHeader *h;
+    const StrBuf *recs;
+    const StrBuf *strings;
+} WastEntry;
+
+static int write_entry(FILE *f, void *ctx) {
+    const WastEntry *e = (const WastEntry *)ctx;
+    return fwrite(e->h, sizeof(*e->h), 1, f) == 1 &&
+                   fwrite(e->recs->data, 1, e->recs->len, f) == e->recs->len &&
+                   fwrite(e->strings->data, 1, e->strings->len, f) == e->strings->len
+               ? 0
+               : -1;
+}
+
+void ast_store_save(const char *canon, const char *src, size_t len, const Node *top) {
+    WastHeader h;
+    WastEntry e;
+    StrBuf recs;
+    StrBuf strings;
+    char *file;
+
+    if (!store_dir || !top) return;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "WAST", 4);
+    h.version = WAST_VERSION;
+    h.content_hash = hash_bytes(src, len, HASH_SEED);
+    sb_init(&recs);
+    sb_init(&strings);
+    h.node_count = put_node(&recs, &strings, top);
+    h.canon_off = put_string(&strings, canon);
+    h.strings_len = (uint32_t)strings.len;
+    h.body_hash = hash_bytes(strings.data, strings.len, hash_bytes(recs.data, recs.len, HASH_SEED));
+
+    file = entry_path(canon, h.content_hash);
+    e.h = &h;
+    e.recs = &recs;
+    e.strings = &strings;
+    write_file_atomic(file, write_entry, &e);
+    free(file);
+    free(recs.data);
+    free(strings.data);
+}
@@ -6,7 +6,11 @@
 #include "ir.h"
 #include "stats.h"
 #include "cgutils.h"
+#include "tbaa.h"
 
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Helper functions for emitting values (similar to expr.c) */
@@ -15,6 +19,8 @@ static void emit_value_i32(StrBuf *out, Value v) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -26,6 +32,8 @@ static void emit_value(StrBuf *out, Value v) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -78,6 +86,453 @@ static Value cg_bitcast_impl(IrCtx *ir, VarEnv *env, Node *expr) {
     return maybe_bitcast(ir, src, to_ty);
 }
 
+/* Compile-time (cast TO x) of a literal, when the result is defined and
+ * rounds as the instruction would. */
+static int fold_cast(Value src, TypeRef *to_ty, Value *out) {
+    long long iv = src.type->kind == TY_I32 ? src.const_i32 : src.const_i64;
+    double fv = src.const_f64;
+    if (type_is_int(src.type)) {
+        if (to_ty->kind == TY_I32) *out = value_const_i32((int)(unsigned)iv);
+        else if (to_ty->kind == TY_I64) *out = value_const_i64(iv);
+        /* i64 -> f32 through double could round twice. */
+        else if (to_ty->kind == TY_F64 || (long long)(double)iv == iv) *out = value_const_float(to_ty, (double)iv);
+        else return 0;
+        return 1;
+    }
+    if (type_is_float(to_ty)) {
+        *out = value_const_float(to_ty, fv);
+        return 1;
+    }
+    /* fptosi of an out-of-range value is poison: leave it to run time. */
+    if (to_ty->kind == TY_I32 && fv > (double)INT_MIN - 1.0 && fv < (double)INT_MAX + 1.0) {
+        *out = value_const_i32((int)fv);
+        return 1;
+    }
+    if (to_ty->kind == TY_I64 && fv >= -9223372036854775808.0 && fv < 9223372036854775808.0) {
+        *out = value_const_i64((long long)fv);
+        return 1;
+    }
+    return 0;
+}
+
+/* (cast T x): conversions between Int32, Int64, Float32 and Float64 -
+ * sext/trunc, sitofp/fptosi, fpext/fptrunc. Other operand types get the
+ * usual implicit conversions (ensure_type). */
+static Value cg_cast_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    TypeEnv *tenv = (TypeEnv *)ir->type_env;
+    TypeRef *to_ty = parse_type_node(tenv, list_nth(expr, 1));
+    Value src = cg_expr(ir, env, list_nth(expr, 2));
+    TypeRef *from_ty = src.type ? src.type : type_i32();
+    const char *op;
+    Value folded;
+    int t;
+
+    if (type_eq(from_ty, to_ty)) return src;
+    if (!(type_is_int(from_ty) || type_is_float(from_ty)) || !(type_is_int(to_ty) || type_is_float(to_ty))) {
+        return ensure_type_ctx_at(ir, src, to_ty, "cast", expr);
+    }
+    STAT_INC(emitted_cast);
+    if ((src.kind == 0 || src.kind == 3) && fold_cast(src, to_ty, &folded)) {
+        STAT_INC(folded_constants);
+        return folded;
+    }
+    if (type_is_int(from_ty) && type_is_int(to_ty)) op = to_ty->kind == TY_I64 ? "sext" : "trunc";
+    else if (type_is_int(from_ty)) op = "sitofp";
+    else if (type_is_int(to_ty)) op = "fptosi";
+    else op = to_ty->kind == TY_F64 ? "fpext" : "fptrunc";
+
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = ");
+    sb_append(ir->out, op);
+    sb_append(ir->out, " ");
+    emit_typed_value(ir->out, from_ty, src);
+    sb_append(ir->out, " to ");
+    emit_llvm_type(ir->out, to_ty);
+    sb_append(ir->out, "\n");
+    return value_temp(to_ty, t);
+}
+
+/* ---- SIMD: (vec T N) values and the vec-* builtins ----
+ * Lane-wise operations map to LLVM vector instructions and intrinsics
+ * (llvm.fma, llvm.smin, llvm.minnum, llvm.vector.reduce.*), which the
+ * backend lowers to native vector instructions. Lane masks from vec-cmp
+ * are (vec Int32 N) values with -1 in true lanes and 0 elsewhere. */
+
+static void vec_error(Node *at, const char *msg, const char *hint) {
+    diag_fatal(at && at->filename ? at->filename : NULL, at ? at->line : 0, at ? at->col : 0, "type-mismatch", msg,
+               hint);
+}
+
+/* Type argument I of EXPR, which must be a (vec T N). */
+static TypeRef *vec_type_arg(IrCtx *ir, Node *expr, int i) {
+    TypeRef *ty = parse_type_node((TypeEnv *)ir->type_env, list_nth(expr, i));
+    if (ty->kind != TY_VEC) {
+        vec_error(expr, "expected a (vec T N) type", "e.g. (vec-load (vec Float32 4) p)");
+    }
+    return ty;
+}
+
+/* Operand I of EXPR as a vector; with WANT set, converted to that type. */
+static Value vec_operand(IrCtx *ir, VarEnv *env, Node *expr, int i, TypeRef *want) {
+    Node *n = list_nth(expr, i);
+    Value v = cg_expr(ir, env, n);
+    if (want) return ensure_type_ctx_at(ir, v, want, atom_text(list_nth(expr, 0)), n ? n : expr);
+    if (!v.type || v.type->kind != TY_VEC) {
+        vec_error(n ? n : expr, "expected a (vec T N) operand", "vectors come from vec-load, vec-splat or vec-* results");
+    }
+    return v;
+}
+
+/* Byte alignment of one lane: vec-load/vec-store only assume an aligned
+ * element pointer. */
+static int vec_lane_align(TypeRef *vty) {
+    return vty->pointee->kind == TY_I64 || vty->pointee->kind == TY_F64 ? 8 : 4;
+}
+
+/* NAME.vNty, the overload suffix of a vector intrinsic. */
+static void vec_intrinsic_name(StrBuf *out, const char *name, TypeRef *vty) {
+    TypeKind k = vty->pointee->kind;
+    sb_append(out, name);
+    sb_append(out, ".v");
+    sb_printf_i32(out, vty->lanes);
+    sb_append(out, k == TY_I32 ? "i32" : k == TY_I64 ? "i64" : k == TY_F32 ? "f32" : "f64");
+}
+
+/* Calls intrinsic NAME (overloaded on VTY) with ARGS, declaring it once
+ * per module. FLAGS are fast-math flags for the call, or NULL. */
+static Value emit_vec_intrinsic(IrCtx *ir, const char *name, TypeRef *vty, TypeRef *ret_ty, const char *flags,
+                                Value *args, int nargs) {
+    StrBuf fn;
+    int t;
+    int i;
+    sb_init(&fn);
+    vec_intrinsic_name(&fn, name, vty);
+    if (!sl_contains(&ir->declared_ccalls, fn.data)) {
+        sl_push(&ir->declared_ccalls, fn.data);
+        sb_append(&ir->decls, "declare ");
+        emit_llvm_type(&ir->decls, ret_ty);
+        sb_append(&ir->decls, " @");
+        sb_append(&ir->decls, fn.data);
+        sb_append(&ir->decls, "(");
+        for (i = 0; i < nargs; i++) {
+            if (i != 0) sb_append(&ir->decls, ", ");
+            emit_llvm_type(&ir->decls, args[i].type);
+        }
+        sb_append(&ir->decls, ")\n");
+    }
+    STAT_INC_INTRINSIC();
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = call ");
+    if (flags) {
+        sb_append(ir->out, flags);
+        sb_append(ir->out, " ");
+    }
+    emit_llvm_type(ir->out, ret_ty);
+    sb_append(ir->out, " @");
+    sb_append(ir->out, fn.data);
+    sb_append(ir->out, "(");
+    for (i = 0; i < nargs; i++) {
+        if (i != 0) sb_append(ir->out, ", ");
+        emit_typed_value(ir->out, args[i].type, args[i]);
+    }
+    sb_append(ir->out, ")\n");
+    free(fn.data);
+    return value_temp(ret_ty, t);
+}
+
+/* (vec-load (vec T N) p): N lanes from the (ptr T) p. */
+static Value cg_vec_load_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    TypeRef *vty = vec_type_arg(ir, expr, 1);
+    Value p = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_ptr(vty->pointee), "vec-load", expr);
+    Value vp = maybe_bitcast(ir, p, type_ptr(vty));
+    int t = ir_fresh_temp(ir);
+    STAT_INC(emitted_vec_ops);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = load ");
+    emit_llvm_type(ir->out, vty);
+    sb_append(ir->out, ", ");
+    emit_typed_value(ir->out, vp.type, vp);
+    sb_append(ir->out, ", align ");
+    sb_printf_i32(ir->out, vec_lane_align(vty));
+    tbaa_emit_access(ir, ir->out, vty);
+    sb_append(ir->out, "\n");
+    return value_temp(vty, t);
+}
+
+/* (vec-store (vec T N) p v): stores the N lanes of v at the (ptr T) p. */
+static Value cg_vec_store_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    TypeRef *vty = vec_type_arg(ir, expr, 1);
+    Value p = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_ptr(vty->pointee), "vec-store", expr);
+    Value v = vec_operand(ir, env, expr, 3, vty);
+    Value vp = maybe_bitcast(ir, p, type_ptr(vty));
+    STAT_INC(emitted_vec_ops);
+    sb_append(ir->out, "  store ");
+    emit_typed_value(ir->out, vty, v);
+    sb_append(ir->out, ", ");
+    emit_typed_value(ir->out, vp.type, vp);
+    sb_append(ir->out, ", align ");
+    sb_printf_i32(ir->out, vec_lane_align(vty));
+    tbaa_emit_access(ir, ir->out, vty);
+    sb_append(ir->out, "\n");
+    return value_const_i32(0);
+}
+
+/* (vec-splat (vec T N) x): x in every lane. */
+static Value cg_vec_splat_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    TypeRef *vty = vec_type_arg(ir, expr, 1);
+    Value x = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), vty->pointee, "vec-splat", expr);
+    int one = ir_fresh_temp(ir);
+    int t = ir_fresh_temp(ir);
+    STAT_INC(emitted_vec_ops);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, one);
+    sb_append(ir->out, " = insertelement ");
+    emit_llvm_type(ir->out, vty);
+    sb_append(ir->out, " undef, ");
+    emit_typed_value(ir->out, vty->pointee, x);
+    sb_append(ir->out, ", i32 0\n  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = shufflevector ");
+    emit_llvm_type(ir->out, vty);
+    sb_append(ir->out, " ");
+    ir_emit_temp(ir->out, one);
+    sb_append(ir->out, ", ");
+    emit_llvm_type(ir->out, vty);
+    sb_append(ir->out, " undef, <");
+    sb_printf_i32(ir->out, vty->lanes);
+    sb_append(ir->out, " x i32> zeroinitializer\n");
+    return value_temp(vty, t);
+}
+
+/* Lane-wise OP of two vectors of one type; NSW marks integer add/sub/mul
+ * nsw under --nsw, as cg_arith does. */
+static Value emit_vec_binop(IrCtx *ir, const char *op, int nsw, Value a, Value b) {
+    int t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = ");
+    sb_append(ir->out, op);
+    sb_append(ir->out, nsw && ir->nsw ? " nsw " : " ");
+    emit_typed_value(ir->out, a.type, a);
+    sb_append(ir->out, ", ");
+    emit_value(ir->out, b);
+    sb_append(ir->out, "\n");
+    return value_temp(a.type, t);
+}
+
+static Value cg_vec_arith(IrCtx *ir, VarEnv *env, Node *expr, const char *int_op, const char *float_op) {
+    Value a = vec_operand(ir, env, expr, 1, NULL);
+    Value b = vec_operand(ir, env, expr, 2, a.type);
+    STAT_INC(emitted_vec_ops);
+    if (type_is_float(a.type->pointee)) return emit_vec_binop(ir, float_op, 0, a, b);
+    return emit_vec_binop(ir, int_op, 1, a, b);
+}
+
+static Value cg_vec_add_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_arith(ir, env, expr, "add", "fadd");
+}
+
+static Value cg_vec_sub_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_arith(ir, env, expr, "sub", "fsub");
+}
+
+static Value cg_vec_mul_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_arith(ir, env, expr, "mul", "fmul");
+}
+
+/* (vec-fma a b c): a*b + c per lane, fused (one rounding) on floats. */
+static Value cg_vec_fma_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    Value args[3];
+    args[0] = vec_operand(ir, env, expr, 1, NULL);
+    args[1] = vec_operand(ir, env, expr, 2, args[0].type);
+    args[2] = vec_operand(ir, env, expr, 3, args[0].type);
+    STAT_INC(emitted_vec_ops);
+    if (type_is_float(args[0].type->pointee)) {
+        return emit_vec_intrinsic(ir, "llvm.fma", args[0].type, args[0].type, NULL, args, 3);
+    }
+    return emit_vec_binop(ir, "add", 1, emit_vec_binop(ir, "mul", 1, args[0], args[1]), args[2]);
+}
+
+/* Lane-wise min/max: signed on integers; on floats a NaN lane yields the
+ * other operand (llvm.minnum/maxnum). */
+static Value cg_vec_minmax(IrCtx *ir, VarEnv *env, Node *expr, const char *int_fn, const char *float_fn) {
+    Value args[2];
+    args[0] = vec_operand(ir, env, expr, 1, NULL);
+    args[1] = vec_operand(ir, env, expr, 2, args[0].type);
+    STAT_INC(emitted_vec_ops);
+    return emit_vec_intrinsic(ir, type_is_float(args[0].type->pointee) ? float_fn : int_fn, args[0].type,
+                              args[0].type, NULL, args, 2);
+}
+
+static Value cg_vec_min_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_minmax(ir, env, expr, "llvm.smin", "llvm.minnum");
+}
+
+static Value cg_vec_max_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_minmax(ir, env, expr, "llvm.smax", "llvm.maxnum");
+}
+
+/* Horizontal reductions to one T. Float sums are reassociated: lanes are
+ * added in whatever order vectorizes best, not left to right. */
+static Value cg_vec_reduce(IrCtx *ir, VarEnv *env, Node *expr, const char *int_fn, const char *float_fn) {
+    Value args[2];
+    Value v = vec_operand(ir, env, expr, 1, NULL);
+    TypeRef *elem = v.type->pointee;
+    STAT_INC(emitted_vec_ops);
+    if (type_is_float(elem) && strcmp(float_fn, "llvm.vector.reduce.fadd") == 0) {
+        args[0] = value_const_float(elem, -0.0);
+        args[1] = v;
+        return emit_vec_intrinsic(ir, float_fn, v.type, elem, "reassoc", args, 2);
+    }
+    args[0] = v;
+    return emit_vec_intrinsic(ir, type_is_float(elem) ? float_fn : int_fn, v.type, elem, NULL, args, 1);
+}
+
+static Value cg_vec_reduce_add_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_reduce(ir, env, expr, "llvm.vector.reduce.add", "llvm.vector.reduce.fadd");
+}
+
+static Value cg_vec_reduce_min_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_reduce(ir, env, expr, "llvm.vector.reduce.smin", "llvm.vector.reduce.fmin");
+}
+
+static Value cg_vec_reduce_max_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    return cg_vec_reduce(ir, env, expr, "llvm.vector.reduce.smax", "llvm.vector.reduce.fmax");
+}
+
+/* (vec-shuffle a [b] (i ...)): lane k of the result is lane i_k of a ++ b
+ * (of a alone without b). The index list is constant and its length is the
+ * result's lane count. */
+static Value cg_vec_shuffle_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    Node *mask = list_nth(expr, expr->count - 1);
+    Value a, b;
+    int has_b = expr->count == 4;
+    int limit;
+    int t;
+    int i;
+    if (expr->count != 3 && expr->count != 4) {
+        diag_fatal(expr->filename, expr->line, expr->col, "arity-mismatch", "vec-shuffle takes 2 or 3 arguments",
+                   "(vec-shuffle a (3 2 1 0)) or (vec-shuffle a b (0 4 1 5))");
+    }
+    a = vec_operand(ir, env, expr, 1, NULL);
+    b = has_b ? vec_operand(ir, env, expr, 2, a.type) : a;
+    limit = has_b ? 2 * a.type->lanes : a.type->lanes;
+    if (!mask || mask->kind != N_LIST || !type_vec_lanes_valid(mask->count)) {
+        vec_error(mask ? mask : expr, "vec-shuffle needs a list of lane indices",
+                  "the list's length is the result's lane count: a power of two from 2 to 64");
+    }
+    for (i = 0; i < mask->count; i++) {
+        Node *idx = list_nth(mask, i);
+        const char *s = idx && idx->kind == N_ATOM ? atom_text(idx) : NULL;
+        char *endp = NULL;
+        long lane = s ? strtol(s, &endp, 10) : -1;
+        if (!s || !endp || *endp != '\0' || lane < 0 || lane >= limit) {
+            char hint[64];
+            snprintf(hint, sizeof(hint), "indices are integers from 0 to %d", limit - 1);
+            vec_error(idx ? idx : mask, "vec-shuffle lane index out of range", hint);
+        }
+    }
+    STAT_INC(emitted_vec_ops);
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = shufflevector ");
+    emit_typed_value(ir->out, a.type, a);
+    sb_append(ir->out, ", ");
+    emit_llvm_type(ir->out, a.type);
+    if (has_b) {
+        sb_append(ir->out, " ");
+        emit_value(ir->out, b);
+    } else {
+        sb_append(ir->out, " undef");
+    }
+    sb_append(ir->out, ", <");
+    sb_printf_i32(ir->out, mask->count);
+    sb_append(ir->out, " x i32> <");
+    for (i = 0; i < mask->count; i++) {
+        if (i != 0) sb_append(ir->out, ", ");
+        sb_append(ir->out, "i32 ");
+        sb_append(ir->out, atom_text(list_nth(mask, i)));
+    }
+    sb_append(ir->out, ">\n");
+    return value_temp(type_vec(a.type->pointee, mask->count), t);
+}
+
+/* (vec-cmp OP a b), OP one of == != < <= > >=: a lane mask, signed on
+ * integers and false on NaN lanes (but for !=) on floats, as cg_cmp. */
+static Value cg_vec_cmp_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    static const char *ops[] = {"==", "!=", "<", "<=", ">", ">="};
+    static const char *ipreds[] = {"eq", "ne", "slt", "sle", "sgt", "sge"};
+    static const char *fpreds[] = {"oeq", "une", "olt", "ole", "ogt", "oge"};
+    Node *op_node = list_nth(expr, 1);
+    TypeRef *mask_ty;
+    Value a, b;
+    int op = -1;
+    int tcmp, t;
+    int i;
+    for (i = 0; i < 6; i++) {
+        if (is_atom(op_node, ops[i])) op = i;
+    }
+    if (op < 0) vec_error(op_node ? op_node : expr, "vec-cmp needs a comparison", "one of == != < <= > >=");
+    a = vec_operand(ir, env, expr, 2, NULL);
+    b = vec_operand(ir, env, expr, 3, a.type);
+    mask_ty = type_vec(type_i32(), a.type->lanes);
+    STAT_INC(emitted_vec_ops);
+    tcmp = ir_fresh_temp(ir);
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, tcmp);
+    sb_append(ir->out, type_is_float(a.type->pointee) ? " = fcmp " : " = icmp ");
+    sb_append(ir->out, type_is_float(a.type->pointee) ? fpreds[op] : ipreds[op]);
+    sb_append(ir->out, " ");
+    emit_typed_value(ir->out, a.type, a);
+    sb_append(ir->out, ", ");
+    emit_value(ir->out, b);
+    sb_append(ir->out, "\n  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = sext <");
+    sb_printf_i32(ir->out, a.type->lanes);
+    sb_append(ir->out, " x i1> ");
+    ir_emit_temp(ir->out, tcmp);
+    sb_append(ir->out, " to ");
+    emit_llvm_type(ir->out, mask_ty);
+    sb_append(ir->out, "\n");
+    return value_temp(mask_ty, t);
+}
+
+/* (vec-select mask a b): lanes of a where mask is non-zero, else of b. */
+static Value cg_vec_select_impl(IrCtx *ir, VarEnv *env, Node *expr) {
+    Value mask = vec_operand(ir, env, expr, 1, NULL);
+    Value a = vec_operand(ir, env, expr, 2, NULL);
+    Value b = vec_operand(ir, env, expr, 3, a.type);
+    int tcond, t;
+    mask = ensure_type_ctx_at(ir, mask, type_vec(type_i32(), a.type->lanes), "vec-select mask", list_nth(expr, 1));
+    STAT_INC(emitted_vec_ops);
+    tcond = ir_fresh_temp(ir);
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, tcond);
+    sb_append(ir->out, " = icmp ne ");
+    emit_typed_value(ir->out, mask.type, mask);
+    sb_append(ir->out, ", zeroinitializer\n  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = select <");
+    sb_printf_i32(ir->out, a.type->lanes);
+    sb_append(ir->out, " x i1> ");
+    ir_emit_temp(ir->out, tcond);
+    sb_append(ir->out, ", ");
+    emit_typed_value(ir->out, a.type, a);
+    sb_append(ir->out, ", ");
+    emit_typed_value(ir->out, b.type, b);
+    sb_append(ir->out, "\n");
+    return value_temp(a.type, t);
+}
+
 /* Builtin function registry - maps names to their kinds and metadata */
 static BuiltinDef builtins[] = {
     {
@@ -104,6 +559,134 @@ static BuiltinDef builtins[] = {
         .param_types = NULL,
         .codegen = cg_bitcast_impl
     },
+    {
+        .name = "cast",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* The to-type */
+        .param_count = 2,  /* to-type, src */
+        .param_types = NULL,
+        .codegen = cg_cast_impl
+    },
+    {
+        .name = "vec-load",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* The vec-type */
+        .param_count = 2,  /* vec-type, ptr */
+        .param_types = NULL,
+        .codegen = cg_vec_load_impl
+    },
+    {
+        .name = "vec-store",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Int32 0, used as a statement */
+        .param_count = 3,  /* vec-type, ptr, value */
+        .param_types = NULL,
+        .codegen = cg_vec_store_impl
+    },
+    {
+        .name = "vec-splat",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* The vec-type */
+        .param_count = 2,  /* vec-type, scalar */
+        .param_types = NULL,
+        .codegen = cg_vec_splat_impl
+    },
+    {
+        .name = "vec-add",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 2,  /* a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_add_impl
+    },
+    {
+        .name = "vec-sub",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 2,  /* a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_sub_impl
+    },
+    {
+        .name = "vec-mul",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 2,  /* a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_mul_impl
+    },
+    {
+        .name = "vec-fma",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 3,  /* a, b, c */
+        .param_types = NULL,
+        .codegen = cg_vec_fma_impl
+    },
+    {
+        .name = "vec-min",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 2,  /* a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_min_impl
+    },
+    {
+        .name = "vec-max",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 2,  /* a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_max_impl
+    },
+    {
+        .name = "vec-reduce-add",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Lane type of v */
+        .param_count = 1,  /* v */
+        .param_types = NULL,
+        .codegen = cg_vec_reduce_add_impl
+    },
+    {
+        .name = "vec-reduce-min",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Lane type of v */
+        .param_count = 1,  /* v */
+        .param_types = NULL,
+        .codegen = cg_vec_reduce_min_impl
+    },
+    {
+        .name = "vec-reduce-max",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Lane type of v */
+        .param_count = 1,  /* v */
+        .param_types = NULL,
+        .codegen = cg_vec_reduce_max_impl
+    },
+    {
+        .name = "vec-shuffle",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Lanes of a, one per index */
+        .param_count = -1, /* a, [b,] (lane indices) */
+        .param_types = NULL,
+        .codegen = cg_vec_shuffle_impl
+    },
+    {
+        .name = "vec-cmp",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* (vec Int32 N) lane mask */
+        .param_count = 3,  /* op, a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_cmp_impl
+    },
+    {
+        .name = "vec-select",
+        .kind = BUILTIN_INTRINSIC,
+        .ret_type = NULL,  /* Type of a */
+        .param_count = 3,  /* mask, a, b */
+        .param_types = NULL,
+        .codegen = cg_vec_select_impl
+    },
     /* Add more builtins here as needed */
     { .name = NULL }  /* Sentinel */
 };
@@ -139,23 +722,82 @@ BuiltinId builtin_id(const char *name) {
     if (strcmp(name, "ptr-add") == 0) return BUILTIN_ID_PTR_ADD;
     if (strcmp(name, "get-field") == 0) return BUILTIN_ID_GET_FIELD;
     if (strcmp(name, "bitcast") == 0) return BUILTIN_ID_BITCAST;
+    if (strcmp(name, "cast") == 0) return BUILTIN_ID_CAST;
+    if (strcmp(name, "vec-load") == 0) return BUILTIN_ID_VEC_LOAD;
+    if (strcmp(name, "vec-store") == 0) return BUILTIN_ID_VEC_STORE;
+    if (strcmp(name, "vec-splat") == 0) return BUILTIN_ID_VEC_SPLAT;
+    if (strcmp(name, "vec-add") == 0) return BUILTIN_ID_VEC_ADD;
+    if (strcmp(name, "vec-sub") == 0) return BUILTIN_ID_VEC_SUB;
+    if (strcmp(name, "vec-mul") == 0) return BUILTIN_ID_VEC_MUL;
+    if (strcmp(name, "vec-fma") == 0) return BUILTIN_ID_VEC_FMA;
+    if (strcmp(name, "vec-min") == 0) return BUILTIN_ID_VEC_MIN;
+    if (strcmp(name, "vec-max") == 0) return BUILTIN_ID_VEC_MAX;
+    if (strcmp(name, "vec-reduce-add") == 0) return BUILTIN_ID_VEC_REDUCE_ADD;
+    if (strcmp(name, "vec-reduce-min") == 0) return BUILTIN_ID_VEC_REDUCE_MIN;
+    if (strcmp(name, "vec-reduce-max") == 0) return BUILTIN_ID_VEC_REDUCE_MAX;
+    if (strcmp(name, "vec-shuffle") == 0) return BUILTIN_ID_VEC_SHUFFLE;
+    if (strcmp(name, "vec-cmp") == 0) return BUILTIN_ID_VEC_CMP;
+    if (strcmp(name, "vec-select") == 0) return BUILTIN_ID_VEC_SELECT;
     return BUILTIN_ID_NONE;
 }
 
 /* Central dispatch function - Julia-style switch statement */
 Value cg_builtin(IrCtx *ir, VarEnv *env, BuiltinId id, Node *expr) {
+    /* No type: the caller falls through to its own handling. */
+    Value unhandled = {0};
+    BuiltinDef *def = find_builtin(atom_text(list_nth(expr, 0)));
+    /* Fixed-arity builtins (get-field still parses its own forms). */
+    if (def && def->codegen && def->param_count >= 0 && expr->count - 1 != def->param_count) {
+        char details[96];
+        snprintf(details, sizeof(details), "'%s' takes %d argument(s), got %d", def->name, def->param_count,
+                 expr->count - 1);
+        diag_fatal(expr->filename, expr->line, expr->col, "arity-mismatch", "wrong number of builtin arguments",
+                   details);
+    }
     /* Julia-style switch-based dispatch - one central point for all builtins */
     switch (id) {
     case BUILTIN_ID_PTR_ADD:
         return cg_ptr_add_impl(ir, env, expr);
     case BUILTIN_ID_BITCAST:
         return cg_bitcast_impl(ir, env, expr);
+    case BUILTIN_ID_CAST:
+        return cg_cast_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_LOAD:
+        return cg_vec_load_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_STORE:
+        return cg_vec_store_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_SPLAT:
+        return cg_vec_splat_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_ADD:
+        return cg_vec_add_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_SUB:
+        return cg_vec_sub_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_MUL:
+        return cg_vec_mul_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_FMA:
+        return cg_vec_fma_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_MIN:
+        return cg_vec_min_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_MAX:
+        return cg_vec_max_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_REDUCE_ADD:
+        return cg_vec_reduce_add_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_REDUCE_MIN:
+        return cg_vec_reduce_min_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_REDUCE_MAX:
+        return cg_vec_reduce_max_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_SHUFFLE:
+        return cg_vec_shuffle_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_CMP:
+        return cg_vec_cmp_impl(ir, env, expr);
+    case BUILTIN_ID_VEC_SELECT:
+        return cg_vec_select_impl(ir, env, expr);
     case BUILTIN_ID_GET_FIELD:
         /* get-field still handled in expr.c via cg_get_field for now */
-        return value_const_i32(0);
+        return unhandled;
     case BUILTIN_ID_NONE:
     default:
-        return value_const_i32(0);  /* Not a builtin or not implemented */
+        return unhandled;  /* Not a builtin or not implemented */
     }
 }
 
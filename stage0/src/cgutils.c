@@ -2,6 +2,7 @@
 #include "codegen.h"
 #include "diagnostics.h"
 #include "stats.h"
+#include "tbaa.h"
 #include "ir.h"
 #include "types.h"
 #include "common.h"
@@ -13,6 +14,8 @@ static void emit_value(StrBuf *out, Value v) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -24,6 +27,8 @@ static void emit_value_i32(StrBuf *out, Value v) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -125,6 +130,7 @@ Value emit_load(IrCtx *ir, TypeRef *load_type, Value ptr) {
     emit_llvm_type(ir->out, ptr.type);
     sb_append(ir->out, " ");
     emit_value(ir->out, ptr);
+    tbaa_emit_access(ir, ir->out, load_type);
     sb_append(ir->out, "\n");
     Value result = value_temp(load_type, t);
     result.is_pointer = is_pointer_type(load_type);
@@ -141,6 +147,7 @@ void emit_store(IrCtx *ir, Value val, Value ptr) {
     emit_llvm_type(ir->out, ptr.type);
     sb_append(ir->out, " ");
     emit_value(ir->out, ptr);
+    tbaa_emit_access(ir, ir->out, val.type);
     sb_append(ir->out, "\n");
 }
 
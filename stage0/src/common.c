@@ -1,12 +1,27 @@
 #include "common.h"
 
+#include "mem_stats.h"
+
+#include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Per thread, so batch workers (-j) can each recover from their own errors. */
+static __thread void (*fatal_handler)(void) = NULL;
+
+void set_fatal_handler(void (*handler)(void)) {
+    fatal_handler = handler;
+}
+
+void fatal_exit(void) {
+    if (fatal_handler) fatal_handler();
+    exit(1);
+}
+
 void die(const char *msg) {
     fprintf(stderr, "weavec0c: %s\n", msg);
-    exit(1);
+    fatal_exit();
 }
 
 void die_at(const char *filename, int line, int col, const char *msg) {
@@ -15,21 +30,29 @@ void die_at(const char *filename, int line, int col, const char *msg) {
     } else {
         fprintf(stderr, "weavec0c: %d:%d: %s\n", line, col, msg);
     }
-    exit(1);
+    fatal_exit();
 }
 
 void *xmalloc(size_t n) {
     void *p = malloc(n ? n : 1);
     if (!p) die("out of memory");
+    if (mem_stats_active) mem_stats_note(n, 0);
     return p;
 }
 
-void *xrealloc(void *p, size_t n) {
+/* With accounting on, a realloc is charged only for its growth. */
+static void *realloc_counted(void *p, size_t n, int strbuf) {
+    size_t old = p && mem_stats_active ? malloc_usable_size(p) : 0;
     void *q = realloc(p, n ? n : 1);
     if (!q) die("out of memory");
+    if (mem_stats_active) mem_stats_note(n > old ? n - old : 0, strbuf);
     return q;
 }
 
+void *xrealloc(void *p, size_t n) {
+    return realloc_counted(p, n, 0);
+}
+
 char *xstrdup(const char *s) {
     size_t n = strlen(s);
     char *p = (char *)xmalloc(n + 1);
@@ -48,7 +71,7 @@ void sb_reserve(StrBuf *b, size_t need) {
     if (need <= b->cap) return;
     cap = b->cap ? b->cap : 256;
     while (cap < need) cap *= 2;
-    b->data = (char *)xrealloc(b->data, cap);
+    b->data = (char *)realloc_counted(b->data, cap, 1);
     b->cap = cap;
 }
 
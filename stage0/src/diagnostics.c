@@ -1,7 +1,16 @@
 #include "diagnostics.h"
+#include "common.h"
 #include <stdio.h>
 #include <stdlib.h>
 
+static __thread int warnings_suppressed = 0;
+
+int diag_suppress_warnings(int suppress) {
+    int prev = warnings_suppressed;
+    warnings_suppressed = suppress;
+    return prev;
+}
+
 static const char *severity_str(DiagSeverity sev) {
     switch (sev) {
     case DIAG_ERROR: return "error";
@@ -16,6 +25,7 @@ void diag_report(const char *filename, int line, int col,
                  const char *code,
                  const char *message,
                  const char *detail) {
+    if (severity == DIAG_WARNING && warnings_suppressed) return;
     /* Format: filename:line:col: severity: [code] message */
     if (filename && line > 0 && col > 0) {
         fprintf(stderr, "%s:%d:%d: %s", filename, line, col, severity_str(severity));
@@ -60,5 +70,5 @@ void diag_note(const char *filename, int line, int col,
 void diag_fatal(const char *filename, int line, int col,
                 const char *code, const char *message, const char *detail) {
     diag_error(filename, line, col, code, message, detail);
-    exit(1);
+    fatal_exit();
 }
@@ -1,5 +1,7 @@
 #include "env.h"
 
+#include "mem_stats.h"
+
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,8 +11,13 @@ void env_init(VarEnv *e) {
     sl_init(&e->names);
     sl_init(&e->ssa_names);
     e->kinds = NULL;
+    e->consts = NULL;
     e->types = NULL;
     e->cap = 0;
+    e->serial = 0;
+    sl_init(&e->out_of_scope);
+    e->in_memory = NULL;
+    e->stack_makes = NULL;
 }
 
 int env_find(VarEnv *e, const char *name) {
@@ -31,6 +38,7 @@ static void env_reserve(VarEnv *e, int need) {
     cap = e->cap ? e->cap : 16;
     while (cap < need) cap *= 2;
     e->kinds = (int *)xrealloc(e->kinds, (size_t)cap * sizeof(int));
+    e->consts = (int *)xrealloc(e->consts, (size_t)cap * sizeof(int));
     e->types = (TypeRef **)xrealloc(e->types, (size_t)cap * sizeof(TypeRef *));
     e->cap = cap;
 }
@@ -62,7 +70,7 @@ static char *make_ssa_name(VarEnv *e, const char *name) {
     char *base = sanitize_name(name);
     size_t nb = strlen(base);
     char numbuf[32];
-    int idx = e->names.len;
+    int idx = ++e->serial;
     int written;
     char *out;
     written = snprintf(numbuf, sizeof(numbuf), "%d", idx);
@@ -80,11 +88,14 @@ static char *make_ssa_name(VarEnv *e, const char *name) {
 }
 
 static void env_add(VarEnv *e, const char *name, int kind, TypeRef *type) {
+    MemCategory prev = mem_category_enter(MEM_ENV);
     env_reserve(e, e->names.len + 1);
     sl_push(&e->names, name);
     sl_push(&e->ssa_names, make_ssa_name(e, name));
+    mem_category_leave(prev);
     int idx = e->names.len - 1;
     e->kinds[idx] = kind;
+    e->consts[idx] = 0;
     e->types[idx] = type;
     /* Debug: track TypeRef storage */
     if (getenv("WEAVEC0_DEBUG_MEM") && type) {
@@ -118,7 +129,7 @@ TypeRef *env_type(VarEnv *e, const char *name) {
     }
     /* Debug: track TypeRef retrieval and verify integrity */
     if (getenv("WEAVEC0_DEBUG_MEM") && result) {
-        int valid_kind = (result->kind >= 0 && result->kind <= 4); /* TY_I32=0, TY_PTR=4 */
+        int valid_kind = (result->kind >= TY_I32 && result->kind <= TY_VEC);
         fprintf(stderr, "[mem] env_type retrieving '%s': idx=%d, type=%p, kind=%d, valid=%d\n",
                 name ? name : "<null>", idx, (void *)result, result->kind, valid_kind);
         if (!valid_kind) {
@@ -128,8 +139,49 @@ TypeRef *env_type(VarEnv *e, const char *name) {
     return result;
 }
 
+int env_scope_begin(VarEnv *e) {
+    return e->names.len;
+}
+
+void env_scope_end(VarEnv *e, int scope) {
+    while (e->names.len > scope) {
+        char *name = e->names.items[--e->names.len];
+        if (!sl_contains(&e->out_of_scope, name)) sl_push(&e->out_of_scope, name);
+        free(name);
+        free(e->ssa_names.items[--e->ssa_names.len]);
+    }
+}
+
+int env_out_of_scope(VarEnv *e, const char *name) {
+    return !env_has(e, name) && sl_contains(&e->out_of_scope, name);
+}
+
 const char *env_ssa_name(VarEnv *e, const char *name) {
     int idx = env_find(e, name);
     if (idx < 0 || idx >= e->ssa_names.len) return name;
     return e->ssa_names.items[idx];
 }
+
+int env_const(VarEnv *e, const char *name) {
+    int idx = env_find(e, name);
+    return idx < 0 ? 0 : e->consts[idx];
+}
+
+int env_needs_memory(VarEnv *e, const char *name) {
+    return !e->in_memory || sl_contains((StrList *)e->in_memory, name);
+}
+
+void env_bind_value(VarEnv *e, const char *name, const char *operand) {
+    int idx = env_find(e, name);
+    if (idx < 0) return;
+    free(e->ssa_names.items[idx]);
+    e->ssa_names.items[idx] = xstrdup(operand);
+    e->kinds[idx] = 2;
+}
+
+void env_bind_const(VarEnv *e, const char *name, int v) {
+    int idx = env_find(e, name);
+    if (idx < 0) return;
+    e->consts[idx] = v;
+    e->kinds[idx] = 3;
+}
@@ -1,12 +1,14 @@
 #include "codegen.h"
 #include "diagnostics.h"
 #include "stats.h"
+#include "tbaa.h"
 #include "cgutils.h"
 
 #include "fn_table.h"
 #include "type_env.h"
 #include "builtins.h"
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -21,11 +23,31 @@ static int is_number_atom(Node *n) {
     return endp && *endp == '\0';
 }
 
+/* Float64 literal: a decimal with a '.' or an exponent ("0.5", "-2.", "1e-3").
+ * Names such as "inf" or "e" stay names: the atom must start with a digit,
+ * or with a sign or '.' followed by one. */
+static int is_float_atom(Node *n) {
+    const char *s;
+    const char *p;
+    char *endp;
+    if (!n || n->kind != N_ATOM) return 0;
+    s = n->text;
+    if (!s || !*s) return 0;
+    p = (*s == '-' || *s == '+') ? s + 1 : s;
+    if (*p == '.') p++;
+    if (*p < '0' || *p > '9') return 0;
+    if (!strpbrk(s, ".eE")) return 0;
+    (void)strtod(s, &endp);
+    return endp && *endp == '\0';
+}
+
 static void emit_value_i32(StrBuf *out, Value v) {
     if (v.kind == 0) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -37,6 +59,8 @@ static void emit_value(StrBuf *out, Value v) {
         sb_printf_i32(out, v.const_i32);
     } else if (v.kind == 1) {
         ir_emit_temp(out, v.temp);
+    } else if (v.kind == 3) {
+        emit_const_literal(out, v);
     } else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -53,6 +77,9 @@ static const char *type_debug_name(TypeRef *t, char *buf, size_t n) {
     if (!t) return "<null>";
     switch (t->kind) {
     case TY_I32: return "i32";
+    case TY_I64: return "i64";
+    case TY_F32: return "float";
+    case TY_F64: return "double";
     case TY_I8PTR: return "i8*";
     case TY_VOID: return "void";
     case TY_STRUCT:
@@ -70,6 +97,11 @@ static const char *type_debug_name(TypeRef *t, char *buf, size_t n) {
             return buf;
         }
         return "ptr";
+    case TY_VEC: {
+        char elem_buf[16];
+        snprintf(buf, n, "<%d x %s>", t->lanes, type_debug_name(t->pointee, elem_buf, sizeof(elem_buf)));
+        return buf;
+    }
     default:
         return "<unknown>";
     }
@@ -79,7 +111,7 @@ Value ensure_type_ctx_at(IrCtx *ir, Value v, TypeRef *target, const char *ctx, N
     char expected_buf[64];
     char got_buf[64];
     /* Defensive: ensure v always has a valid type with valid kind */
-    if (!v.type || v.type->kind < TY_I32 || v.type->kind > TY_PTR) {
+    if (!v.type || v.type->kind < TY_I32 || v.type->kind > TY_VEC) {
         v.type = type_i32();
     }
     if (type_eq(v.type, target)) return v;
@@ -87,7 +119,16 @@ Value ensure_type_ctx_at(IrCtx *ir, Value v, TypeRef *target, const char *ctx, N
      * - allow i32 const 0 as null i8*
      * - allow ptr -> i8* via bitcast
      * - allow ptr/i8* -> i32 via ptrtoint (for bootstrap flexibility)
+     * - allow Int32 literals as Int64/Float32/Float64 and Int64/Float64
+     *   literals as floats; other numeric conversions need (cast T x)
      */
+    if (target && (target->kind == TY_I64 || type_is_float(target)) && v.kind == 0) {
+        if (target->kind == TY_I64) return value_const_i64(v.const_i32);
+        return value_const_float(target, (double)v.const_i32);
+    }
+    if (type_is_float(target) && v.kind == 3) {
+        return value_const_float(target, v.type->kind == TY_I64 ? (double)v.const_i64 : v.const_f64);
+    }
     if (target && target->kind == TY_I8PTR && v.type && v.type->kind == TY_I32 && v.kind == 0 && v.const_i32 == 0) {
         int t = ir_fresh_temp(ir);
         sb_append(ir->out, "  ");
@@ -173,23 +214,15 @@ static Value cg_load(IrCtx *ir, VarEnv *env, Node *list) {
     emit_llvm_type(ir->out, ptrv.type);
     sb_append(ir->out, " ");
     emit_value(ir->out, ptrv);
+    tbaa_emit_access(ir, ir->out, ty);
     sb_append(ir->out, "\n");
     return value_temp(ty, t);
 }
 
-static Value cg_make_struct(IrCtx *ir, VarEnv *env, Node *list) {
-    TypeEnv *tenv = (TypeEnv *)ir->type_env;
-    TypeRef *ty = parse_type_node(tenv, list_nth(list, 1));
-    StructDef *sd = NULL;
-    int i;
+/* i32 temp holding sizeof(TY), via the GEP-from-null trick. */
+static int emit_struct_size(IrCtx *ir, TypeRef *ty) {
     int size_ptr = ir_fresh_temp(ir);
-    int size_i64 = ir_fresh_temp(ir);
-    int malloc_result = ir_fresh_temp(ir);
-    int ptr = ir_fresh_temp(ir);
-    if (!ty || ty->kind != TY_STRUCT) die("make expects struct type");
-    sd = type_env_find_struct(tenv, ty->name);
-    
-    /* Calculate struct size using GEP null trick */
+    int size = ir_fresh_temp(ir);
     sb_append(ir->out, "  ");
     ir_emit_temp(ir->out, size_ptr);
     sb_append(ir->out, " = getelementptr ");
@@ -197,32 +230,31 @@ static Value cg_make_struct(IrCtx *ir, VarEnv *env, Node *list) {
     sb_append(ir->out, ", ");
     emit_llvm_type(ir->out, ty);
     sb_append(ir->out, "* null, i32 1\n");
-    
-    /* Convert pointer to integer (gives us the size) */
     sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, size_i64);
+    ir_emit_temp(ir->out, size);
     sb_append(ir->out, " = ptrtoint ");
     emit_llvm_type(ir->out, ty);
     sb_append(ir->out, "* ");
     ir_emit_temp(ir->out, size_ptr);
     sb_append(ir->out, " to i32\n");
-    
-    /* Call malloc */
-    sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, malloc_result);
-    sb_append(ir->out, " = call i8* @malloc(i32 ");
-    ir_emit_temp(ir->out, size_i64);
-    sb_append(ir->out, ")\n");
-    
-    /* Bitcast to struct pointer */
+    return size;
+}
+
+/* Bitcasts the i8* temp RAW to TY* and stores the (field value) forms
+ * LIST[first..] through it. */
+static Value emit_struct_init(IrCtx *ir, VarEnv *env, Node *list, int first, TypeRef *ty, int raw) {
+    TypeEnv *tenv = (TypeEnv *)ir->type_env;
+    StructDef *sd = type_env_find_struct(tenv, ty->name);
+    int ptr = ir_fresh_temp(ir);
+    int i;
     sb_append(ir->out, "  ");
     ir_emit_temp(ir->out, ptr);
     sb_append(ir->out, " = bitcast i8* ");
-    ir_emit_temp(ir->out, malloc_result);
+    ir_emit_temp(ir->out, raw);
     sb_append(ir->out, " to ");
     emit_llvm_type(ir->out, ty);
     sb_append(ir->out, "*\n");
-    for (i = 2; i < list->count; i++) {
+    for (i = first; i < list->count; i++) {
         Node *field = list_nth(list, i);
         const char *fname = atom_text(list_nth(field, 0));
         int fi = struct_field_index(sd, fname);
@@ -248,12 +280,161 @@ static Value cg_make_struct(IrCtx *ir, VarEnv *env, Node *list) {
         emit_llvm_type(ir->out, fty);
         sb_append(ir->out, "* ");
         ir_emit_temp(ir->out, pfi);
+        tbaa_emit_field(ir, ir->out, ty, fi);
         sb_append(ir->out, "\n");
     }
     /* Return pointer to the allocated struct instead of loading the value */
     return value_temp(type_ptr(ty), ptr);
 }
 
+static TypeRef *make_struct_type(IrCtx *ir, Node *type_node) {
+    TypeRef *ty = parse_type_node((TypeEnv *)ir->type_env, type_node);
+    if (!ty || ty->kind != TY_STRUCT) die("make expects struct type");
+    return ty;
+}
+
+static Value cg_make_struct(IrCtx *ir, VarEnv *env, Node *list) {
+    TypeRef *ty = make_struct_type(ir, list_nth(list, 1));
+    int size = emit_struct_size(ir, ty);
+    int malloc_result = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, malloc_result);
+    sb_append(ir->out, " = call i8* @malloc(i32 ");
+    ir_emit_temp(ir->out, size);
+    sb_append(ir->out, ")\n");
+    return emit_struct_init(ir, env, list, 2, ty, malloc_result);
+}
+
+Value cg_make_struct_local(IrCtx *ir, VarEnv *env, Node *list) {
+    TypeRef *ty;
+    int slot;
+    int raw;
+    if (!ir->entry_allocas) return cg_make_struct(ir, env, list);
+    ty = make_struct_type(ir, list_nth(list, 1));
+    slot = ir_fresh_temp(ir);
+    raw = ir_fresh_temp(ir);
+    STAT_INC(stack_makes);
+    /* One slot per site in fn_entry, so a make in a loop reuses it. */
+    sb_append(ir->entry_allocas, "  ");
+    ir_emit_temp(ir->entry_allocas, slot);
+    sb_append(ir->entry_allocas, " = alloca ");
+    emit_llvm_type(ir->entry_allocas, ty);
+    sb_append(ir->entry_allocas, "\n");
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, raw);
+    sb_append(ir->out, " = bitcast ");
+    emit_llvm_type(ir->out, ty);
+    sb_append(ir->out, "* ");
+    ir_emit_temp(ir->out, slot);
+    sb_append(ir->out, " to i8*\n");
+    return emit_struct_init(ir, env, list, 2, ty, raw);
+}
+
+/* (make-in region T (field value)...): bump-allocates from the region's
+ * current chunk inline and calls region-alloc only when it is full. */
+static Value cg_make_in(IrCtx *ir, VarEnv *env, Node *list) {
+    TypeRef *region_ty = type_ptr(type_struct("Region"));
+    Value region = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(list, 1)), region_ty, "make-in", list);
+    TypeRef *ty = make_struct_type(ir, list_nth(list, 2));
+    int size = emit_struct_size(ir, ty);
+    int rounded = ir_fresh_temp(ir);
+    int size8 = ir_fresh_temp(ir);
+    int pcur = ir_fresh_temp(ir);
+    int pend = ir_fresh_temp(ir);
+    int cur = ir_fresh_temp(ir);
+    int end = ir_fresh_temp(ir);
+    int next = ir_fresh_temp(ir);
+    int fits = ir_fresh_temp(ir);
+    int refilled = ir_fresh_temp(ir);
+    int raw = ir_fresh_temp(ir);
+    int bump_l = ir_fresh_label(ir);
+    int refill_l = ir_fresh_label(ir);
+    int join_l = ir_fresh_label(ir);
+
+    STAT_INC(region_makes);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, rounded);
+    sb_append(ir->out, " = add i32 ");
+    ir_emit_temp(ir->out, size);
+    sb_append(ir->out, ", 7\n  ");
+    ir_emit_temp(ir->out, size8);
+    sb_append(ir->out, " = and i32 ");
+    ir_emit_temp(ir->out, rounded);
+    sb_append(ir->out, ", -8\n  ");
+    ir_emit_temp(ir->out, pcur);
+    sb_append(ir->out, " = getelementptr inbounds %Region, %Region* ");
+    emit_value(ir->out, region);
+    sb_append(ir->out, ", i32 0, i32 0\n  ");
+    ir_emit_temp(ir->out, pend);
+    sb_append(ir->out, " = getelementptr inbounds %Region, %Region* ");
+    emit_value(ir->out, region);
+    sb_append(ir->out, ", i32 0, i32 1\n  ");
+    ir_emit_temp(ir->out, cur);
+    sb_append(ir->out, " = load i8*, i8** ");
+    ir_emit_temp(ir->out, pcur);
+    tbaa_emit_access(ir, ir->out, type_i8ptr());
+    sb_append(ir->out, "\n  ");
+    ir_emit_temp(ir->out, end);
+    sb_append(ir->out, " = load i8*, i8** ");
+    ir_emit_temp(ir->out, pend);
+    tbaa_emit_access(ir, ir->out, type_i8ptr());
+    sb_append(ir->out, "\n  ");
+    /* A fresh region has cur == end == null, which fails the test too. */
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, " = getelementptr i8, i8* ");
+    ir_emit_temp(ir->out, cur);
+    sb_append(ir->out, ", i32 ");
+    ir_emit_temp(ir->out, size8);
+    sb_append(ir->out, "\n  ");
+    ir_emit_temp(ir->out, fits);
+    sb_append(ir->out, " = icmp ule i8* ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, ", ");
+    ir_emit_temp(ir->out, end);
+    sb_append(ir->out, "\n  br i1 ");
+    ir_emit_temp(ir->out, fits);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, bump_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, refill_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, bump_l);
+    sb_append(ir->out, "  store i8* ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, ", i8** ");
+    ir_emit_temp(ir->out, pcur);
+    tbaa_emit_access(ir, ir->out, type_i8ptr());
+    sb_append(ir->out, "\n  br label ");
+    ir_emit_label_ref(ir->out, join_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, refill_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, refilled);
+    sb_append(ir->out, " = call i8* @region-alloc(%Region* ");
+    emit_value(ir->out, region);
+    sb_append(ir->out, ", i32 ");
+    ir_emit_temp(ir->out, size8);
+    sb_append(ir->out, ")\n  br label ");
+    ir_emit_label_ref(ir->out, join_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, join_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, raw);
+    sb_append(ir->out, " = phi i8* [ ");
+    ir_emit_temp(ir->out, cur);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, bump_l);
+    sb_append(ir->out, " ], [ ");
+    ir_emit_temp(ir->out, refilled);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, refill_l);
+    sb_append(ir->out, " ]\n");
+    return emit_struct_init(ir, env, list, 3, ty, raw);
+}
+
 static Value cg_get_field(IrCtx *ir, VarEnv *env, Node *list) {
     Value base = cg_expr(ir, env, list_nth(list, 1));
     const char *fname = atom_text(list_nth(list, 2));
@@ -290,6 +471,7 @@ static Value cg_get_field(IrCtx *ir, VarEnv *env, Node *list) {
     emit_llvm_type(ir->out, sd->field_types[fi]);
     sb_append(ir->out, "* ");
     ir_emit_temp(ir->out, pfield);
+    tbaa_emit_field(ir, ir->out, sty, fi);
     sb_append(ir->out, "\n");
     return value_temp(sd->field_types[fi], loadt);
 }
@@ -315,15 +497,12 @@ static void emit_escaped_c_string(StrBuf *out, const char *s) {
     }
 }
 
-static Value cg_string_lit(IrCtx *ir, Node *str_node) {
-    static int str_id = 0;
-    int id = str_id++;
-    const char *s = atom_text(str_node);
+static Value cg_cstring(IrCtx *ir, const char *s) {
+    int id = ir->strings++;
     int n = (int)strlen(s) + 1;
     int t = ir_fresh_temp(ir);
 
-    sb_append(&ir->globals, "@.str");
-    sb_printf_i32(&ir->globals, id);
+    ir_emit_string_name(&ir->globals, ir, "@.str", id);
     sb_append(&ir->globals, " = private constant [");
     sb_printf_i32(&ir->globals, n);
     sb_append(&ir->globals, " x i8] c\"");
@@ -336,149 +515,517 @@ static Value cg_string_lit(IrCtx *ir, Node *str_node) {
     sb_printf_i32(ir->out, n);
     sb_append(ir->out, " x i8], [");
     sb_printf_i32(ir->out, n);
-    sb_append(ir->out, " x i8]* @.str");
-    sb_printf_i32(ir->out, id);
+    sb_append(ir->out, " x i8]* ");
+    ir_emit_string_name(ir->out, ir, "@.str", id);
     sb_append(ir->out, ", i32 0, i32 0\n");
 
     return value_temp(type_i8ptr(), t);
 }
 
+static Value cg_string_lit(IrCtx *ir, Node *str_node) {
+    return cg_cstring(ir, atom_text(str_node));
+}
+
+/* Declared signature of an llvm-jit call site. */
+typedef struct {
+    int nparams;
+    TypeRef **params;
+    TypeRef *ret;
+} JitSig;
+
+static const char *const JIT_USAGE =
+    "Usage: (llvm-jit \"IR code\" \"function_name\" [(params T ...)] [(returns T)] (args ...))";
+static const char *const JIT_BATCH_USAGE =
+    "Usage: (llvm-jit-batch \"IR code\" \"function_name\" (params T ...) (returns T) "
+    "(count n) (args array ...) [(out array)])";
+
+/* Find the (name ...) clause among list items from index start on. */
+static Node *jit_clause(Node *list, int start, const char *name) {
+    int i;
+    for (i = start; i < list->count; i++) {
+        Node *item = list_nth(list, i);
+        if (item && item->kind == N_LIST && is_atom(list_nth(item, 0), name)) return item;
+    }
+    return NULL;
+}
+
+static void jit_fatal(Node *at, const char *msg, const char *usage) {
+    diag_fatal(at && at->filename ? at->filename : NULL,
+               at ? at->line : 0,
+               at ? at->col : 0,
+               "syntax-error", msg, usage);
+}
+
+/* Parse (params ...) / (returns ...) clauses. Without a (params ...) clause
+ * every argument is an Int32 (nargs_default of them); the result defaults
+ * to Int32 as well. */
+static JitSig jit_parse_sig(IrCtx *ir, Node *list, int nargs_default) {
+    TypeEnv *tenv = (TypeEnv *)ir->type_env;
+    Node *params = jit_clause(list, 3, "params");
+    Node *returns = jit_clause(list, 3, "returns");
+    JitSig sig;
+    int i;
+    sig.nparams = params ? params->count - 1 : nargs_default;
+    sig.params = (TypeRef **)xmalloc((size_t)(sig.nparams > 0 ? sig.nparams : 1) * sizeof(TypeRef *));
+    for (i = 0; i < sig.nparams; i++) {
+        sig.params[i] = params ? parse_type_node(tenv, list_nth(params, i + 1)) : type_i32();
+    }
+    sig.ret = returns ? parse_type_node(tenv, list_nth(returns, 1)) : type_i32();
+    return sig;
+}
+
+static void emit_jit_fn_ptr_type(StrBuf *out, JitSig *sig) {
+    int i;
+    emit_llvm_type(out, sig->ret);
+    sb_append(out, " (");
+    for (i = 0; i < sig->nparams; i++) {
+        if (i != 0) sb_append(out, ", ");
+        emit_llvm_type(out, sig->params[i]);
+    }
+    sb_append(out, ")*");
+}
+
+/* Emit the per-site function pointer cache. The first execution resolves the
+ * symbol through llvm_jit_lookup_cached() and stores it in an internal global;
+ * later executions cost a load and a well-predicted branch. Returns a temp
+ * holding the pointer cast to the declared signature. */
+static int emit_jit_fn_ptr(IrCtx *ir, const char *ir_str, const char *func_name, JitSig *sig) {
+    int site = ir->jit_sites++;
+    int cached = ir_fresh_temp(ir);
+    int is_null = ir_fresh_temp(ir);
+    int resolved;
+    int fptr = ir_fresh_temp(ir);
+    int typed = ir_fresh_temp(ir);
+    int hit_l = ir_fresh_label(ir);
+    int miss_l = ir_fresh_label(ir);
+    int call_l = ir_fresh_label(ir);
+    Value ir_ptr, name_ptr;
+
+    if (!sl_contains(&ir->declared_ccalls, "llvm_jit_lookup_cached")) {
+        sl_push(&ir->declared_ccalls, "llvm_jit_lookup_cached");
+        sb_append(&ir->decls, "declare i8* @llvm_jit_lookup_cached(i8*, i8*)\n");
+    }
+    sb_append(&ir->globals, "@llvm_jit_fnptr_");
+    sb_printf_i32(&ir->globals, site);
+    sb_append(&ir->globals, " = internal global i8* null\n");
+
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, cached);
+    sb_append(ir->out, " = load i8*, i8** @llvm_jit_fnptr_");
+    sb_printf_i32(ir->out, site);
+    sb_append(ir->out, "\n  ");
+    ir_emit_temp(ir->out, is_null);
+    sb_append(ir->out, " = icmp eq i8* ");
+    ir_emit_temp(ir->out, cached);
+    sb_append(ir->out, ", null\n  br i1 ");
+    ir_emit_temp(ir->out, is_null);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, miss_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, hit_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, miss_l);
+    ir_ptr = cg_cstring(ir, ir_str);
+    name_ptr = cg_cstring(ir, func_name);
+    resolved = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, resolved);
+    sb_append(ir->out, " = call i8* @llvm_jit_lookup_cached(i8* ");
+    emit_value(ir->out, ir_ptr);
+    sb_append(ir->out, ", i8* ");
+    emit_value(ir->out, name_ptr);
+    sb_append(ir->out, ")\n  store i8* ");
+    ir_emit_temp(ir->out, resolved);
+    sb_append(ir->out, ", i8** @llvm_jit_fnptr_");
+    sb_printf_i32(ir->out, site);
+    sb_append(ir->out, "\n  br label ");
+    ir_emit_label_ref(ir->out, call_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, hit_l);
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, call_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, call_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, fptr);
+    sb_append(ir->out, " = phi i8* [ ");
+    ir_emit_temp(ir->out, cached);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, hit_l);
+    sb_append(ir->out, " ], [ ");
+    ir_emit_temp(ir->out, resolved);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, miss_l);
+    sb_append(ir->out, " ]\n  ");
+    ir_emit_temp(ir->out, typed);
+    sb_append(ir->out, " = bitcast i8* ");
+    ir_emit_temp(ir->out, fptr);
+    sb_append(ir->out, " to ");
+    emit_jit_fn_ptr_type(ir->out, sig);
+    sb_append(ir->out, "\n");
+    return typed;
+}
+
+/* --inline-llvm-jit: record the literal for program.c to link into the
+ * module and declare the symbol it will be linked in as. One symbol per
+ * distinct (IR, function) pair. */
+static const char *jit_inline_symbol(IrCtx *ir, const char *ir_str, const char *func_name, JitSig *sig) {
+    StrBuf sym;
+    int i;
+    for (i = 0; i < ir->inline_jit_syms.len; i++) {
+        if (strcmp(ir->inline_jit_irs.items[i], ir_str) == 0 &&
+            strcmp(ir->inline_jit_fns.items[i], func_name) == 0) {
+            return ir->inline_jit_syms.items[i];
+        }
+    }
+    sb_init(&sym);
+    sb_append(&sym, "__weave_ir_");
+    sb_printf_i32(&sym, ir->inline_jit_syms.len);
+    sb_append(&sym, "_");
+    sb_append(&sym, func_name);
+    sl_push(&ir->inline_jit_irs, ir_str);
+    sl_push(&ir->inline_jit_fns, func_name);
+    sl_push(&ir->inline_jit_syms, sym.data);
+
+    sb_append(&ir->decls, "declare ");
+    emit_llvm_type(&ir->decls, sig->ret);
+    sb_append(&ir->decls, " @");
+    sb_append(&ir->decls, sym.data);
+    sb_append(&ir->decls, "(");
+    for (i = 0; i < sig->nparams; i++) {
+        if (i != 0) sb_append(&ir->decls, ", ");
+        emit_llvm_type(&ir->decls, sig->params[i]);
+    }
+    sb_append(&ir->decls, ")\n");
+    free(sym.data);
+    return ir->inline_jit_syms.items[ir->inline_jit_syms.len - 1];
+}
+
+/* Emit `call <sig> %fptr(args)`, or `call <sig> @direct(args)` when direct
+ * is set; returns the call's temp, or -1 for Void. */
+static int emit_jit_call(IrCtx *ir, JitSig *sig, int fptr, const char *direct, Value *args) {
+    int i;
+    int t = -1;
+    sb_append(ir->out, "  ");
+    if (sig->ret->kind != TY_VOID) {
+        t = ir_fresh_temp(ir);
+        ir_emit_temp(ir->out, t);
+        sb_append(ir->out, " = ");
+    }
+    sb_append(ir->out, "call ");
+    emit_llvm_type(ir->out, sig->ret);
+    sb_append(ir->out, " ");
+    if (direct) {
+        sb_append(ir->out, "@");
+        sb_append(ir->out, direct);
+    } else {
+        ir_emit_temp(ir->out, fptr);
+    }
+    sb_append(ir->out, "(");
+    for (i = 0; i < sig->nparams; i++) {
+        if (i != 0) sb_append(ir->out, ", ");
+        emit_typed_value(ir->out, sig->params[i], args[i]);
+    }
+    sb_append(ir->out, ")\n");
+    return t;
+}
+
+static void jit_literals(Node *list, const char *usage, const char **ir_str, const char **func_name) {
+    Node *ir_node = list_nth(list, 1);
+    Node *func_name_node = list_nth(list, 2);
+    if (!ir_node || !func_name_node) {
+        jit_fatal(list, "llvm-jit requires IR string and function name", usage);
+    }
+    if (ir_node->kind != N_STRING || func_name_node->kind != N_STRING) {
+        jit_fatal(list, "llvm-jit IR and function name must be string literals", usage);
+    }
+    *ir_str = atom_text(ir_node);
+    *func_name = atom_text(func_name_node);
+}
+
+/* (llvm-jit "IR" "fn" [(params T ...)] [(returns T)] (args ...))
+ * Calls the JIT-compiled function directly through a pointer of the declared
+ * type, so any arity and any Weave type (Int32, String, pointers to structs)
+ * works without a per-signature C helper. */
+static Value cg_llvm_jit(IrCtx *ir, VarEnv *env, Node *list) {
+    const char *ir_str;
+    const char *func_name;
+    Node *args_list;
+    int nargs = 0;
+    int arg_start = 0;
+    JitSig sig;
+    Value *args;
+    int fptr, t, i;
+
+    jit_literals(list, JIT_USAGE, &ir_str, &func_name);
+    args_list = jit_clause(list, 3, "args");
+    if (!args_list) {
+        /* Legacy form: a bare argument list in position 3. */
+        args_list = list_nth(list, 3);
+        if (args_list && args_list->kind != N_LIST) args_list = NULL;
+        if (args_list && (is_atom(list_nth(args_list, 0), "params") ||
+                          is_atom(list_nth(args_list, 0), "returns"))) {
+            args_list = NULL;
+        }
+    } else {
+        arg_start = 1;
+    }
+    if (args_list) nargs = args_list->count - arg_start;
+
+    sig = jit_parse_sig(ir, list, nargs);
+    if (nargs != sig.nparams) {
+        char details[128];
+        snprintf(details, sizeof(details), "'%s' declares %d parameter(s) but %d argument(s) were given",
+                 func_name, sig.nparams, nargs);
+        diag_fatal(list->filename, list->line, list->col, "arity-mismatch",
+                   "llvm-jit argument count does not match (params ...)", details);
+    }
+
+    args = (Value *)xmalloc((size_t)(nargs > 0 ? nargs : 1) * sizeof(Value));
+    for (i = 0; i < nargs; i++) {
+        Node *arg = list_nth(args_list, arg_start + i);
+        args[i] = ensure_type_ctx_at(ir, cg_expr(ir, env, arg), sig.params[i], "llvm-jit-arg", arg);
+    }
+
+    if (ir->inline_llvm_jit) {
+        t = emit_jit_call(ir, &sig, -1, jit_inline_symbol(ir, ir_str, func_name, &sig), args);
+    } else {
+        fptr = emit_jit_fn_ptr(ir, ir_str, func_name, &sig);
+        t = emit_jit_call(ir, &sig, fptr, NULL, args);
+    }
+    free(args);
+    free(sig.params);
+    if (t < 0) return value_const_i32(0);
+    return value_temp(sig.ret, t);
+}
+
+/* (llvm-jit-batch "IR" "fn" (params T ...) (returns R) (count n)
+ *                 (args xs ...) [(out rs)])
+ * Calls fn once per index i in [0, n) with arguments xs[i] ... and stores the
+ * result to rs[i]. Each args entry is a (ptr T) column matching one parameter.
+ * The symbol is resolved once and the loop runs natively, so per-element cost
+ * is a plain indirect call. Evaluates to n. */
+static Value cg_llvm_jit_batch(IrCtx *ir, VarEnv *env, Node *list) {
+    const char *ir_str;
+    const char *func_name;
+    Node *count_node = jit_clause(list, 3, "count");
+    Node *args_list = jit_clause(list, 3, "args");
+    Node *out_node = jit_clause(list, 3, "out");
+    JitSig sig;
+    Value n, outv;
+    Value *columns, *args;
+    const char *direct = NULL;
+    int fptr, i;
+    int guard, idx, next, more, r;
+    int entry_l, body_l, exit_l;
+
+    jit_literals(list, JIT_BATCH_USAGE, &ir_str, &func_name);
+    if (!count_node || !args_list || !jit_clause(list, 3, "params")) {
+        jit_fatal(list, "llvm-jit-batch requires (params ...), (count n) and (args ...)", JIT_BATCH_USAGE);
+    }
+    sig = jit_parse_sig(ir, list, 0);
+    if (args_list->count - 1 != sig.nparams) {
+        jit_fatal(args_list, "llvm-jit-batch needs one argument array per parameter", JIT_BATCH_USAGE);
+    }
+    if (sig.ret->kind != TY_VOID && !out_node) {
+        jit_fatal(list, "llvm-jit-batch with a result type requires (out array)", JIT_BATCH_USAGE);
+    }
+
+    n = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(count_node, 1)), type_i32(), "llvm-jit-batch-count", count_node);
+    columns = (Value *)xmalloc((size_t)(sig.nparams > 0 ? sig.nparams : 1) * sizeof(Value));
+    args = (Value *)xmalloc((size_t)(sig.nparams > 0 ? sig.nparams : 1) * sizeof(Value));
+    for (i = 0; i < sig.nparams; i++) {
+        Node *col = list_nth(args_list, i + 1);
+        columns[i] = ensure_type_ctx_at(ir, cg_expr(ir, env, col), type_ptr(sig.params[i]), "llvm-jit-batch-arg", col);
+    }
+    outv = value_const_i32(0);
+    if (sig.ret->kind != TY_VOID) {
+        outv = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(out_node, 1)), type_ptr(sig.ret), "llvm-jit-batch-out", out_node);
+    }
+
+    if (ir->inline_llvm_jit) {
+        direct = jit_inline_symbol(ir, ir_str, func_name, &sig);
+        fptr = -1;
+    } else {
+        fptr = emit_jit_fn_ptr(ir, ir_str, func_name, &sig);
+    }
+
+    entry_l = ir_fresh_label(ir);
+    body_l = ir_fresh_label(ir);
+    exit_l = ir_fresh_label(ir);
+    guard = ir_fresh_temp(ir);
+    idx = ir_fresh_temp(ir);
+
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, entry_l);
+    sb_append(ir->out, "\n");
+    ir_emit_label_def(ir->out, entry_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, guard);
+    sb_append(ir->out, " = icmp sgt i32 ");
+    emit_value_i32(ir->out, n);
+    sb_append(ir->out, ", 0\n  br i1 ");
+    ir_emit_temp(ir->out, guard);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, body_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, exit_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, body_l);
+    next = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, idx);
+    sb_append(ir->out, " = phi i32 [ 0, ");
+    ir_emit_label_ref(ir->out, entry_l);
+    sb_append(ir->out, " ], [ ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, body_l);
+    sb_append(ir->out, " ]\n");
+    for (i = 0; i < sig.nparams; i++) {
+        Value slot = emit_gep(ir, sig.params[i], columns[i], value_temp(type_i32(), idx));
+        args[i] = emit_load(ir, sig.params[i], slot);
+    }
+    r = emit_jit_call(ir, &sig, fptr, direct, args);
+    if (r >= 0) {
+        Value slot = emit_gep(ir, sig.ret, outv, value_temp(type_i32(), idx));
+        emit_store(ir, value_temp(sig.ret, r), slot);
+    }
+    more = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, " = add i32 ");
+    ir_emit_temp(ir->out, idx);
+    sb_append(ir->out, ", 1\n  ");
+    ir_emit_temp(ir->out, more);
+    sb_append(ir->out, " = icmp slt i32 ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, ", ");
+    emit_value_i32(ir->out, n);
+    sb_append(ir->out, "\n  br i1 ");
+    ir_emit_temp(ir->out, more);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, body_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, exit_l);
+    sb_append(ir->out, "\n");
+    ir_emit_label_def(ir->out, exit_l);
+
+    free(columns);
+    free(args);
+    free(sig.params);
+    return n;
+}
+
+/* Reject (const-eval e) whose expression reads a local or parameter: it is
+ * evaluated once, at compile time, outside any function. */
+static void const_eval_check_closed(VarEnv *env, Node *e, Node *site) {
+    int i;
+    if (!e) return;
+    if (e->kind == N_ATOM) {
+        if (env_has(env, e->text)) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "const-eval expression refers to local '%s'", e->text);
+            diag_fatal(site->filename, site->line, site->col, "const-eval-local", msg,
+                       "const-eval operands must be literals or calls to top-level functions");
+        }
+        return;
+    }
+    if (e->kind != N_LIST) return;
+    for (i = 0; i < e->count; i++) const_eval_check_closed(env, list_nth(e, i), site);
+}
+
+/* (const-eval e): replaced by the Int32 or String value e had when the
+ * compiler evaluated it through the JIT (see program.c). */
+static Value cg_const_eval(IrCtx *ir, VarEnv *env, Node *expr) {
+    ConstEvalTable *tab = (ConstEvalTable *)ir->const_evals;
+    Node *e = list_nth(expr, 1);
+    int i;
+
+    if (expr->count != 2) {
+        diag_fatal(expr->filename, expr->line, expr->col, "const-eval-arity",
+                   "const-eval takes exactly one expression", NULL);
+    }
+    const_eval_check_closed(env, e, expr);
+    if (ir->const_eval_inline) return cg_expr(ir, env, e);
+    for (i = 0; tab && i < tab->count; i++) {
+        if (tab->sites[i] != expr) continue;
+        if (tab->is_string[i]) return cg_cstring(ir, tab->strs[i]);
+        return value_const_i32(tab->ints[i]);
+    }
+    diag_fatal(expr->filename, expr->line, expr->col, "const-eval-unevaluated",
+               "const-eval site was not evaluated", NULL);
+}
+
+/* C math functions a ccall is checked against: the return and every
+ * argument have the one float type, so (ccall "sqrt" (returns Int32) ...)
+ * is reported instead of reading a garbage register. */
+typedef struct {
+    const char *name;
+    TypeKind type;
+    int nargs;
+} LibmSig;
+
+static const LibmSig libm_sigs[] = {
+    {"sqrt", TY_F64, 1},  {"sqrtf", TY_F32, 1},   {"fabs", TY_F64, 1},   {"fabsf", TY_F32, 1},
+    {"sin", TY_F64, 1},   {"sinf", TY_F32, 1},    {"cos", TY_F64, 1},    {"cosf", TY_F32, 1},
+    {"tan", TY_F64, 1},   {"tanf", TY_F32, 1},    {"atan", TY_F64, 1},   {"atanf", TY_F32, 1},
+    {"exp", TY_F64, 1},   {"expf", TY_F32, 1},    {"log", TY_F64, 1},    {"logf", TY_F32, 1},
+    {"log2", TY_F64, 1},  {"log2f", TY_F32, 1},   {"log10", TY_F64, 1},  {"log10f", TY_F32, 1},
+    {"floor", TY_F64, 1}, {"floorf", TY_F32, 1},  {"ceil", TY_F64, 1},   {"ceilf", TY_F32, 1},
+    {"round", TY_F64, 1}, {"roundf", TY_F32, 1},  {"trunc", TY_F64, 1},  {"truncf", TY_F32, 1},
+    {"pow", TY_F64, 2},   {"powf", TY_F32, 2},    {"fmod", TY_F64, 2},   {"fmodf", TY_F32, 2},
+    {"atan2", TY_F64, 2}, {"atan2f", TY_F32, 2},  {"hypot", TY_F64, 2},  {"hypotf", TY_F32, 2},
+    {"fmin", TY_F64, 2},  {"fminf", TY_F32, 2},   {"fmax", TY_F64, 2},   {"fmaxf", TY_F32, 2},
+    {"fma", TY_F64, 3},   {"fmaf", TY_F32, 3},
+};
+
+static void check_libm_ccall(Node *list, const char *sym, TypeRef *ret_ty, TypeRef **arg_types, int nargs) {
+    const LibmSig *sig = NULL;
+    char msg[128];
+    char hint[160];
+    const char *ty;
+    int ok;
+    size_t k;
+    int i;
+    if (!sym) return;
+    for (k = 0; k < sizeof(libm_sigs) / sizeof(libm_sigs[0]); k++) {
+        if (strcmp(libm_sigs[k].name, sym) == 0) {
+            sig = &libm_sigs[k];
+            break;
+        }
+    }
+    if (!sig) return;
+    ok = ret_ty->kind == sig->type && nargs == sig->nargs;
+    for (i = 0; ok && i < nargs; i++) ok = arg_types[i]->kind == sig->type;
+    if (ok) return;
+    ty = sig->type == TY_F64 ? "Float64" : "Float32";
+    snprintf(msg, sizeof(msg), "ccall does not match the C signature of %s", sym);
+    snprintf(hint, sizeof(hint), "%s takes %d %s argument%s and returns %s", sym, sig->nargs, ty,
+             sig->nargs == 1 ? "" : "s", ty);
+    diag_fatal(list->filename, list->line, list->col, "type-mismatch", msg, hint);
+}
+
 static Value cg_call(IrCtx *ir, VarEnv *env, Node *list) {
     Node *head = list_nth(list, 0);
     int argc = list->count - 1;
     int i;
     int t;
 
-    /* llvm-jit special form - JIT compile and execute LLVM IR */
+    if (is_atom(head, "const-eval")) {
+        return cg_const_eval(ir, env, list);
+    }
+
+    /* llvm-jit special forms - JIT compile LLVM IR and call it through a typed trampoline */
     if (is_atom(head, "llvm-jit")) {
-        Node *ir_node = list_nth(list, 1);
-        Node *func_name_node = list_nth(list, 2);
-        Node *args_list = list_nth(list, 3);
-        
-        if (!ir_node || !func_name_node) {
-            diag_fatal(list && list->filename ? list->filename : NULL,
-                       list ? list->line : 0,
-                       list ? list->col : 0,
-                       "syntax-error",
-                       "llvm-jit requires IR string and function name",
-                       "Usage: (llvm-jit \"IR code\" \"function_name\" (args ...))");
-        }
-        
-        const char *ir_str = atom_text(ir_node);
-        const char *func_name = atom_text(func_name_node);
-        
-        if (!ir_str || !func_name) {
-            diag_fatal(list && list->filename ? list->filename : NULL,
-                       list ? list->line : 0,
-                       list ? list->col : 0,
-                       "syntax-error",
-                       "llvm-jit IR and function name must be string literals",
-                       "Usage: (llvm-jit \"IR code\" \"function_name\" (args ...))");
-        }
-        
-        /* For now, support simple case: function that takes 2 Int32s and returns Int32 */
-        Value arg1_val = {0}, arg2_val = {0};
-        if (args_list && args_list->kind == N_LIST) {
-            /* Check if it's (args ...) form or just a list of arguments */
-            Node *first = list_nth(args_list, 0);
-            int start_idx = 0;
-            if (first && first->kind == N_ATOM && is_atom(first, "args")) {
-                start_idx = 1;  /* Skip "args" atom */
-            }
-            /* Need at least 2 arguments after start_idx */
-            if (args_list->count >= start_idx + 2) {
-                Node *arg1 = list_nth(args_list, start_idx);
-                Node *arg2 = list_nth(args_list, start_idx + 1);
-                if (arg1 && arg2) {
-                    arg1_val = ensure_type_ctx(ir, cg_expr(ir, env, arg1), type_i32(), "llvm-jit-arg1");
-                    arg2_val = ensure_type_ctx(ir, cg_expr(ir, env, arg2), type_i32(), "llvm-jit-arg2");
-                }
-            }
-        }
-        
-        /* Declare JIT helper if not already declared */
-        if (!sl_contains(&ir->declared_ccalls, "llvm_jit_call_i32_i32_i32")) {
-            sl_push(&ir->declared_ccalls, "llvm_jit_call_i32_i32_i32");
-            sb_append(&ir->decls, "declare i32 @llvm_jit_call_i32_i32_i32(i8*, i8*, i32, i32)\n");
-        }
-        
-        /* Emit call to JIT helper */
-        int t = ir_fresh_temp(ir);
-        sb_append(ir->out, "  ");
-        ir_emit_temp(ir->out, t);
-        sb_append(ir->out, " = call i32 @llvm_jit_call_i32_i32_i32(i8* getelementptr inbounds ([");
-        /* Calculate IR string length - approximate for now */
-        int ir_len = (int)strlen(ir_str);
-        sb_printf_i32(ir->out, ir_len + 1);
-        sb_append(ir->out, " x i8], [");
-        sb_printf_i32(ir->out, ir_len + 1);
-        sb_append(ir->out, " x i8]* @");
-        
-        /* Create a global string constant for IR */
-        static int ir_counter = 0;
-        ir_counter++;
-        char ir_global[64];
-        snprintf(ir_global, sizeof(ir_global), "llvm_jit_ir_%d", ir_counter);
-        
-        /* Emit global string constant */
-        if (!sl_contains(&ir->declared_ccalls, ir_global)) {
-            sl_push(&ir->declared_ccalls, ir_global);
-            sb_append(&ir->globals, "@");
-            sb_append(&ir->globals, ir_global);
-            sb_append(&ir->globals, " = private unnamed_addr constant [");
-            sb_printf_i32(&ir->globals, ir_len + 1);
-            sb_append(&ir->globals, " x i8] c\"");
-            /* Escape the string for LLVM IR */
-            int i;
-            for (i = 0; ir_str[i]; i++) {
-                if (ir_str[i] == '\n') {
-                    sb_append(&ir->globals, "\\0A");
-                } else if (ir_str[i] == '"') {
-                    sb_append(&ir->globals, "\\22");
-                } else if (ir_str[i] == '\\') {
-                    sb_append(&ir->globals, "\\5C");
-                } else {
-                    sb_append_ch(&ir->globals, ir_str[i]);
-                }
-            }
-            sb_append(&ir->globals, "\\00\"\n");
-        }
-        
-        sb_append(ir->out, ir_global);
-        sb_append(ir->out, ", i32 0, i32 0), i8* getelementptr inbounds ([");
-        
-        /* Function name string */
-        int func_name_len = (int)strlen(func_name);
-        sb_printf_i32(ir->out, func_name_len + 1);
-        sb_append(ir->out, " x i8], [");
-        sb_printf_i32(ir->out, func_name_len + 1);
-        sb_append(ir->out, " x i8]* @");
-        
-        char func_global[64];
-        snprintf(func_global, sizeof(func_global), "llvm_jit_func_%d", ir_counter);
-        
-        if (!sl_contains(&ir->declared_ccalls, func_global)) {
-            sl_push(&ir->declared_ccalls, func_global);
-            sb_append(&ir->globals, "@");
-            sb_append(&ir->globals, func_global);
-            sb_append(&ir->globals, " = private unnamed_addr constant [");
-            sb_printf_i32(&ir->globals, func_name_len + 1);
-            sb_append(&ir->globals, " x i8] c\"");
-            sb_append(&ir->globals, func_name);
-            sb_append(&ir->globals, "\\00\"\n");
-        }
-        
-        sb_append(ir->out, func_global);
-        sb_append(ir->out, ", i32 0, i32 0), i32 ");
-        emit_value_i32(ir->out, arg1_val);
-        sb_append(ir->out, ", i32 ");
-        emit_value_i32(ir->out, arg2_val);
-        sb_append(ir->out, ")\n");
-        
-        Value v;
-        v.temp = t;
-        v.type = type_i32();
-        return v;
+        return cg_llvm_jit(ir, env, list);
+    }
+    if (is_atom(head, "llvm-jit-batch")) {
+        return cg_llvm_jit_batch(ir, env, list);
     }
     
     /* ccall special form */
@@ -520,8 +1067,20 @@ static Value cg_call(IrCtx *ir, VarEnv *env, Node *list) {
                 }
                 arg_types[i] = aty;
                 arg_vals[i] = ensure_type_ctx_at(ir, cg_expr(ir, env, expr), aty, "ccall-arg", arg);
+                /* Variadic arguments: C promotes float to double. */
+                if (is_printf && aty->kind == TY_F32) {
+                    int promoted = ir_fresh_temp(ir);
+                    sb_append(ir->out, "  ");
+                    ir_emit_temp(ir->out, promoted);
+                    sb_append(ir->out, " = fpext float ");
+                    emit_value(ir->out, arg_vals[i]);
+                    sb_append(ir->out, " to double\n");
+                    arg_types[i] = type_f64();
+                    arg_vals[i] = value_temp(type_f64(), promoted);
+                }
             }
         }
+        check_libm_ccall(list, sym, ret_ty, arg_types, nargs);
 
         /* Emit declare only if not already declared */
         if (!sl_contains(&ir->declared_ccalls, sym)) {
@@ -588,6 +1147,11 @@ static Value cg_call(IrCtx *ir, VarEnv *env, Node *list) {
         if (dbg_calls && fn_idx < 0) {
             fprintf(stderr, "[dbg] unknown fn: %s\n", fn_name);
         }
+        if (fn_idx < 0 && ir->strict_names) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "'%s' is not a defined function", fn_name);
+            diag_fatal(list->filename, list->line, list->col, "unbound-function", msg, NULL);
+        }
 
         if (argc > 0) {
             arg_vals = (Value *)xmalloc((size_t)argc * sizeof(Value));
@@ -638,7 +1202,13 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
     if (!expr) return value_const_i32(0);
 
     if (expr->kind == N_ATOM) {
-        if (is_number_atom(expr)) return value_const_i32(atoi(expr->text));
+        if (is_number_atom(expr)) {
+            /* Integers that do not fit Int32 are Int64 literals. */
+            long long v = strtoll(expr->text, NULL, 10);
+            if (v < INT_MIN || v > INT_MAX) return value_const_i64(v);
+            return value_const_i32((int)v);
+        }
+        if (is_float_atom(expr)) return value_const_float(type_f64(), strtod(expr->text, NULL));
 
         /* variable reference */
         if (env_has(env, expr->text)) {
@@ -650,7 +1220,10 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
                 fprintf(stderr, "[dbg] Variable 'a' lookup: kind=%d, ty=%p, ty_kind=%d, ssa='%s'\n",
                         kind, (void *)ty, ty ? ty->kind : -1, ssa ? ssa : "<null>");
             }
-            /* Both locals (kind==0) and parameters (kind==1) are in allocas now */
+            /* Immutable bindings are values (kind 2/3); the rest live in allocas. */
+            if (kind == 2) return value_ssa(ty ? ty : type_i32(), ssa);
+            if (kind == 3) return value_const_i32(env_const(env, expr->text));
+            /* Both locals (kind==0) and parameters (kind==1) are in allocas */
             /* Defensive: handle kind==-1 case (shouldn't happen but handle gracefully) */
             if (kind == 0 || kind == 1) {
                 /* Defensive: if type is NULL (shouldn't happen but handle gracefully) */
@@ -671,6 +1244,7 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
                 emit_llvm_type(ir->out, ty);
                 sb_append(ir->out, "* %");
                 sb_append(ir->out, ssa);
+                tbaa_emit_access(ir, ir->out, ty);
                 sb_append(ir->out, "\n");
                 /* Debug: verify Value creation */
                 if (getenv("WEAVEC0_DEBUG_SIGS") && strcmp(expr->text, "a") == 0) {
@@ -690,10 +1264,23 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
             emit_llvm_type(ir->out, ty);
             sb_append(ir->out, "* %");
             sb_append(ir->out, ssa ? ssa : expr->text);
+            tbaa_emit_access(ir, ir->out, ty);
             sb_append(ir->out, "\n");
             return value_temp(ty, t);
         }
 
+        if (env_out_of_scope(env, expr->text)) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "'%s' is not in scope here", expr->text);
+            diag_fatal(expr->filename, expr->line, expr->col, "unbound-variable", msg,
+                       "A let inside an if-stmt arm, loop body or && / || operand ends with it; "
+                       "bind the name before the branch and set it inside.");
+        }
+        if (ir->strict_names) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "'%s' is not defined", expr->text);
+            diag_fatal(expr->filename, expr->line, expr->col, "unbound-variable", msg, NULL);
+        }
         /* Unknown atom: treat as 0 */
         return value_const_i32(0);
     }
@@ -773,6 +1360,10 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
             return cg_make_struct(ir, env, expr);
         }
 
+        if (is_atom(head, "make-in")) {
+            return cg_make_in(ir, env, expr);
+        }
+
         /* Check builtin registry first - Julia-style central dispatch */
         const char *head_name = atom_text(head);
         BuiltinId bid = builtin_id(head_name);
@@ -857,33 +1448,150 @@ Value cg_expr(IrCtx *ir, VarEnv *env, Node *expr) {
 
 /* Enum-based operation implementations - Julia-style */
 
+/* Constant folding. Operands are folded only once they have been emitted,
+ * so side effects are kept; i32 arithmetic wraps as LLVM's add/sub/mul do
+ * without nsw. Division is left to run time when it could trap. */
+static int fold_arith(ArithOp op, Value lhs, Value rhs, Value *out) {
+    unsigned a = (unsigned)lhs.const_i32;
+    unsigned b = (unsigned)rhs.const_i32;
+    int lc = lhs.kind == 0;
+    int rc = rhs.kind == 0;
+
+    if (lc && rc) {
+        switch (op) {
+        case ARITH_ADD: *out = value_const_i32((int)(a + b)); return 1;
+        case ARITH_SUB: *out = value_const_i32((int)(a - b)); return 1;
+        case ARITH_MUL: *out = value_const_i32((int)(a * b)); return 1;
+        case ARITH_DIV:
+            if (b == 0 || (lhs.const_i32 == INT_MIN && rhs.const_i32 == -1)) return 0;
+            *out = value_const_i32(lhs.const_i32 / rhs.const_i32);
+            return 1;
+        }
+    }
+    /* Identities: x+0, 0+x, x-0, x*1, 1*x, x/1, x*0, 0*x. */
+    if ((rc && rhs.const_i32 == 0 && (op == ARITH_ADD || op == ARITH_SUB)) ||
+        (rc && rhs.const_i32 == 1 && (op == ARITH_MUL || op == ARITH_DIV))) {
+        *out = lhs;
+        return 1;
+    }
+    if ((lc && lhs.const_i32 == 0 && op == ARITH_ADD) || (lc && lhs.const_i32 == 1 && op == ARITH_MUL)) {
+        *out = rhs;
+        return 1;
+    }
+    if (op == ARITH_MUL && ((lc && lhs.const_i32 == 0) || (rc && rhs.const_i32 == 0))) {
+        *out = value_const_i32(0);
+        return 1;
+    }
+    return 0;
+}
+
+/* Folding for Int64 and float constants (kind 3) once both operands have
+ * the operation's type. Int64 wraps like i32 above; floats are computed in
+ * double, which rounds Float32 results exactly as float arithmetic would. */
+static int fold_wide_arith(ArithOp op, TypeRef *ty, Value lhs, Value rhs, Value *out) {
+    if (lhs.kind != 3 || rhs.kind != 3) return 0;
+    if (ty->kind == TY_I64) {
+        unsigned long long a = (unsigned long long)lhs.const_i64;
+        unsigned long long b = (unsigned long long)rhs.const_i64;
+        switch (op) {
+        case ARITH_ADD: *out = value_const_i64((long long)(a + b)); return 1;
+        case ARITH_SUB: *out = value_const_i64((long long)(a - b)); return 1;
+        case ARITH_MUL: *out = value_const_i64((long long)(a * b)); return 1;
+        case ARITH_DIV:
+            if (b == 0 || (lhs.const_i64 == LLONG_MIN && rhs.const_i64 == -1)) return 0;
+            *out = value_const_i64(lhs.const_i64 / rhs.const_i64);
+            return 1;
+        }
+        return 0;
+    }
+    switch (op) {
+    case ARITH_ADD: *out = value_const_float(ty, lhs.const_f64 + rhs.const_f64); return 1;
+    case ARITH_SUB: *out = value_const_float(ty, lhs.const_f64 - rhs.const_f64); return 1;
+    case ARITH_MUL: *out = value_const_float(ty, lhs.const_f64 * rhs.const_f64); return 1;
+    case ARITH_DIV: *out = value_const_float(ty, lhs.const_f64 / rhs.const_f64); return 1;
+    }
+    return 0;
+}
+
+static int fold_cmp(CmpOp op, long long a, long long b) {
+    switch (op) {
+    case CMP_EQ: return a == b;
+    case CMP_NE: return a != b;
+    case CMP_LT: return a < b;
+    case CMP_LE: return a <= b;
+    case CMP_GT: return a > b;
+    case CMP_GE: return a >= b;
+    }
+    return 0;
+}
+
+/* Same as fcmp's ordered predicates, and une for !=, on NaN. */
+static int fold_fcmp(CmpOp op, double a, double b) {
+    switch (op) {
+    case CMP_EQ: return a == b;
+    case CMP_NE: return a != b;
+    case CMP_LT: return a < b;
+    case CMP_LE: return a <= b;
+    case CMP_GT: return a > b;
+    case CMP_GE: return a >= b;
+    }
+    return 0;
+}
+
+/* Type both operands of a binary numeric op are converted to: that of an
+ * Int64 or float operand, preferring one that is not a literal so literals
+ * adapt to it ((* 0.5 x) with x Float32 is a Float32 multiply); otherwise
+ * Int32, with pointers going through ptrtoint as before. */
+static TypeRef *numeric_operand_type(Value lhs, Value rhs) {
+    int lw = lhs.type && (lhs.type->kind == TY_I64 || type_is_float(lhs.type));
+    int rw = rhs.type && (rhs.type->kind == TY_I64 || type_is_float(rhs.type));
+    if (lw && lhs.kind != 3) return lhs.type;
+    if (rw && rhs.kind != 3) return rhs.type;
+    if (lw) return lhs.type;
+    if (rw) return rhs.type;
+    return type_i32();
+}
+
 Value cg_arith(IrCtx *ir, VarEnv *env, Node *expr, ArithOp op) {
-    Value lhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 1)), type_i32(), "arith", expr);
-    Value rhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_i32(), "arith", expr);
-    int t = ir_fresh_temp(ir);
+    Value raw_lhs = cg_expr(ir, env, list_nth(expr, 1));
+    Value raw_rhs = cg_expr(ir, env, list_nth(expr, 2));
+    TypeRef *ty = numeric_operand_type(raw_lhs, raw_rhs);
+    Value lhs = ensure_type_ctx_at(ir, raw_lhs, ty, "arith", expr);
+    Value rhs = ensure_type_ctx_at(ir, raw_rhs, ty, "arith", expr);
+    int fp = type_is_float(ty);
+    Value folded;
+    int t;
+    if (ty->kind == TY_I32 ? fold_arith(op, lhs, rhs, &folded) : fold_wide_arith(op, ty, lhs, rhs, &folded)) {
+        STAT_INC(folded_constants);
+        return folded;
+    }
+    t = ir_fresh_temp(ir);
     sb_append(ir->out, "  ");
     ir_emit_temp(ir->out, t);
     sb_append(ir->out, " = ");
     switch (op) {
     case ARITH_ADD:
-        sb_append(ir->out, "add");
+        sb_append(ir->out, fp ? "fadd" : "add");
         break;
     case ARITH_SUB:
-        sb_append(ir->out, "sub");
+        sb_append(ir->out, fp ? "fsub" : "sub");
         break;
     case ARITH_MUL:
-        sb_append(ir->out, "mul");
+        sb_append(ir->out, fp ? "fmul" : "mul");
         break;
     case ARITH_DIV:
-        sb_append(ir->out, "sdiv");
+        sb_append(ir->out, fp ? "fdiv" : "sdiv");
         break;
     }
-    sb_append(ir->out, " i32 ");
-    emit_value_i32(ir->out, lhs);
+    if (ir->nsw && op != ARITH_DIV && !fp) sb_append(ir->out, " nsw");
+    sb_append(ir->out, " ");
+    emit_llvm_type(ir->out, ty);
+    sb_append(ir->out, " ");
+    emit_value(ir->out, lhs);
     sb_append(ir->out, ", ");
-    emit_value_i32(ir->out, rhs);
+    emit_value(ir->out, rhs);
     sb_append(ir->out, "\n");
-    return value_temp(type_i32(), t);
+    return value_temp(ty, t);
 }
 
 Value cg_cmp(IrCtx *ir, VarEnv *env, Node *expr, CmpOp op) {
@@ -906,13 +1614,16 @@ Value cg_cmp(IrCtx *ir, VarEnv *env, Node *expr, CmpOp op) {
     case CMP_GE: pred = "sge"; break;
     }
 
-    tcmp = ir_fresh_temp(ir);
-    tout = ir_fresh_temp(ir);
+    if (raw_lhs.kind == 0 && raw_rhs.kind == 0 && !lhs_is_ptr && !rhs_is_ptr) {
+        STAT_INC(folded_constants);
+        return value_const_i32(fold_cmp(op, raw_lhs.const_i32, raw_rhs.const_i32));
+    }
 
     /* Pointer-aware equality: bitcast both to i8* when needed */
     if ((op == CMP_EQ || op == CMP_NE) && (lhs_is_ptr || rhs_is_ptr)) {
         lhs = ensure_type_ctx_at(ir, raw_lhs, type_i8ptr(), "cmp", expr);
         rhs = ensure_type_ctx_at(ir, raw_rhs, type_i8ptr(), "cmp", expr);
+        tcmp = ir_fresh_temp(ir);
         sb_append(ir->out, "  ");
         ir_emit_temp(ir->out, tcmp);
         sb_append(ir->out, " = icmp ");
@@ -923,20 +1634,41 @@ Value cg_cmp(IrCtx *ir, VarEnv *env, Node *expr, CmpOp op) {
         emit_value(ir->out, rhs);
         sb_append(ir->out, "\n");
     } else {
-        /* Fallback to integer comparison; ptrs become i32 via ptrtoint */
-        lhs = ensure_type_ctx_at(ir, raw_lhs, type_i32(), "cmp", expr);
-        rhs = ensure_type_ctx_at(ir, raw_rhs, type_i32(), "cmp", expr);
+        /* Numeric comparison (icmp, or fcmp on floats); ptrs become i32
+         * via ptrtoint */
+        TypeRef *ty = numeric_operand_type(raw_lhs, raw_rhs);
+        lhs = ensure_type_ctx_at(ir, raw_lhs, ty, "cmp", expr);
+        rhs = ensure_type_ctx_at(ir, raw_rhs, ty, "cmp", expr);
+        if (lhs.kind == 3 && rhs.kind == 3) {
+            STAT_INC(folded_constants);
+            if (ty->kind == TY_I64) return value_const_i32(fold_cmp(op, lhs.const_i64, rhs.const_i64));
+            return value_const_i32(fold_fcmp(op, lhs.const_f64, rhs.const_f64));
+        }
+        if (type_is_float(ty)) {
+            switch (op) {
+            case CMP_EQ: pred = "oeq"; break;
+            case CMP_NE: pred = "une"; break;
+            case CMP_LT: pred = "olt"; break;
+            case CMP_LE: pred = "ole"; break;
+            case CMP_GT: pred = "ogt"; break;
+            case CMP_GE: pred = "oge"; break;
+            }
+        }
+        tcmp = ir_fresh_temp(ir);
         sb_append(ir->out, "  ");
         ir_emit_temp(ir->out, tcmp);
-        sb_append(ir->out, " = icmp ");
+        sb_append(ir->out, type_is_float(ty) ? " = fcmp " : " = icmp ");
         sb_append(ir->out, pred);
-        sb_append(ir->out, " i32 ");
-        emit_value_i32(ir->out, lhs);
+        sb_append(ir->out, " ");
+        emit_llvm_type(ir->out, ty);
+        sb_append(ir->out, " ");
+        emit_value(ir->out, lhs);
         sb_append(ir->out, ", ");
-        emit_value_i32(ir->out, rhs);
+        emit_value(ir->out, rhs);
         sb_append(ir->out, "\n");
     }
 
+    tout = ir_fresh_temp(ir);
     sb_append(ir->out, "  ");
     ir_emit_temp(ir->out, tout);
     sb_append(ir->out, " = zext i1 ");
@@ -945,54 +1677,142 @@ Value cg_cmp(IrCtx *ir, VarEnv *env, Node *expr, CmpOp op) {
     return value_temp(type_i32(), tout);
 }
 
+/* i1 temp holding (v != 0). */
+static int emit_truth_i1(IrCtx *ir, Value v) {
+    int t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = icmp ne i32 ");
+    emit_value_i32(ir->out, v);
+    sb_append(ir->out, ", 0\n");
+    return t;
+}
+
+static Value emit_zext_i1(IrCtx *ir, int tb) {
+    int tout = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, tout);
+    sb_append(ir->out, " = zext i1 ");
+    ir_emit_temp(ir->out, tb);
+    sb_append(ir->out, " to i32\n");
+    return value_temp(type_i32(), tout);
+}
+
+/* (&& a b) / (|| a b). The right operand is evaluated only when the left
+ * one does not decide the result: it is emitted into its own block and the
+ * two paths meet in a phi. A right operand that needs no instructions
+ * (literal or SSA value) is combined without branching, and literal left
+ * operands fold at emission. */
 Value cg_logic(IrCtx *ir, VarEnv *env, Node *expr, LogicOp op) {
-    int tb1, tb2, tb3, tout;
+    int tb1, tb2, tb3;
+    int rhs_l, short_l, done_l, end_l;
+    StrBuf rhs_code;
+    StrBuf *saved_out;
     Value lhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 1)), type_i32(), "logic", expr);
-    Value rhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_i32(), "logic", expr);
+    Value rhs;
+    int scope;
     
     if (op == LOGIC_AND) {
         STAT_INC(emitted_and);
     } else {
         STAT_INC(emitted_or);
     }
-    
-    tb1 = ir_fresh_temp(ir);
-    tb2 = ir_fresh_temp(ir);
-    tb3 = ir_fresh_temp(ir);
-    tout = ir_fresh_temp(ir);
-    
-    sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, tb1);
-    sb_append(ir->out, " = icmp ne i32 ");
-    emit_value_i32(ir->out, lhs);
-    sb_append(ir->out, ", 0\n");
-    
-    sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, tb2);
-    sb_append(ir->out, " = icmp ne i32 ");
-    emit_value_i32(ir->out, rhs);
-    sb_append(ir->out, ", 0\n");
-    
-    sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, tb3);
-    sb_append(ir->out, " = ");
-    if (op == LOGIC_AND) {
-        sb_append(ir->out, "and");
-    } else {
-        sb_append(ir->out, "or");
+
+    /* A literal left operand that decides the result ((&& 0 x), (|| 1 x)):
+     * the right one is never evaluated. */
+    if (lhs.kind == 0 && (lhs.const_i32 != 0) == (op == LOGIC_OR)) {
+        STAT_INC(folded_constants);
+        return value_const_i32(op == LOGIC_OR);
+    }
+    if (lhs.kind == 0) {
+        /* Neutral literal: the result is just (rhs != 0). */
+        scope = env_scope_begin(env);
+        rhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_i32(), "logic", expr);
+        env_scope_end(env, scope);
+        STAT_INC(folded_constants);
+        if (rhs.kind == 0) return value_const_i32(rhs.const_i32 != 0);
+        return emit_zext_i1(ir, emit_truth_i1(ir, rhs));
+    }
+
+    /* Emit the right operand aside; where it goes depends on whether it
+     * needed any instructions. */
+    sb_init(&rhs_code);
+    saved_out = ir->out;
+    ir->out = &rhs_code;
+    /* Lets in a (block ...) operand stay inside it: it may not run. */
+    scope = env_scope_begin(env);
+    rhs = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(expr, 2)), type_i32(), "logic", expr);
+    env_scope_end(env, scope);
+    ir->out = saved_out;
+
+    if (rhs_code.len == 0) {
+        free(rhs_code.data);
+        if (rhs.kind == 0) {
+            STAT_INC(folded_constants);
+            if ((rhs.const_i32 != 0) == (op == LOGIC_OR)) return value_const_i32(op == LOGIC_OR);
+            return emit_zext_i1(ir, emit_truth_i1(ir, lhs));
+        }
+        tb1 = emit_truth_i1(ir, lhs);
+        tb2 = emit_truth_i1(ir, rhs);
+        tb3 = ir_fresh_temp(ir);
+        sb_append(ir->out, "  ");
+        ir_emit_temp(ir->out, tb3);
+        sb_append(ir->out, op == LOGIC_AND ? " = and i1 " : " = or i1 ");
+        ir_emit_temp(ir->out, tb1);
+        sb_append(ir->out, ", ");
+        ir_emit_temp(ir->out, tb2);
+        sb_append(ir->out, "\n");
+        return emit_zext_i1(ir, tb3);
     }
-    sb_append(ir->out, " i1 ");
+
+    /*   br %lhs, rhs_l, short_l     (|| swaps the targets)
+     * short_l: br end_l
+     * rhs_l:   <rhs code>; br done_l
+     * done_l:  br end_l             (rhs may have ended in another block)
+     * end_l:   phi [ (op == ||), short_l ], [ rhs != 0, done_l ] */
+    STAT_INC(short_circuits);
+    rhs_l = ir_fresh_label(ir);
+    short_l = ir_fresh_label(ir);
+    done_l = ir_fresh_label(ir);
+    end_l = ir_fresh_label(ir);
+    tb1 = emit_truth_i1(ir, lhs);
+    sb_append(ir->out, "  br i1 ");
     ir_emit_temp(ir->out, tb1);
-    sb_append(ir->out, ", ");
-    ir_emit_temp(ir->out, tb2);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, op == LOGIC_AND ? rhs_l : short_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, op == LOGIC_AND ? short_l : rhs_l);
     sb_append(ir->out, "\n");
-    
+
+    ir_emit_label_def(ir->out, short_l);
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, end_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, rhs_l);
+    sb_append_n(ir->out, rhs_code.data, rhs_code.len);
+    free(rhs_code.data);
+    tb2 = emit_truth_i1(ir, rhs);
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, done_l);
+    sb_append(ir->out, "\n");
+    ir_emit_label_def(ir->out, done_l);
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, end_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, end_l);
+    tb3 = ir_fresh_temp(ir);
     sb_append(ir->out, "  ");
-    ir_emit_temp(ir->out, tout);
-    sb_append(ir->out, " = zext i1 ");
     ir_emit_temp(ir->out, tb3);
-    sb_append(ir->out, " to i32\n");
-    return value_temp(type_i32(), tout);
+    sb_append(ir->out, op == LOGIC_AND ? " = phi i1 [ false, " : " = phi i1 [ true, ");
+    ir_emit_label_ref(ir->out, short_l);
+    sb_append(ir->out, " ], [ ");
+    ir_emit_temp(ir->out, tb2);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, done_l);
+    sb_append(ir->out, " ]\n");
+    return emit_zext_i1(ir, tb3);
 }
 
 /* is_pointer_type is now in cgutils.c - removed duplicate */
@@ -0,0 +1,247 @@
+#include "fn_cache.h"
+
+#include "fs.h"
+#include "hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Pack layout (host byte order; packs are not meant to be portable):
+ *   FnPackHeader
+ *   FnPackRecord[count]
+ *   char unit[unit_len]   canonical path of the input, NUL-terminated
+ *   char data[data_len]   each record's parts back to back, in record order */
+#define WFN_VERSION 1u
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t unit_len;
+    uint64_t data_len;
+    uint64_t body_hash; /* of everything after the header */
+} FnPackHeader;
+
+typedef struct {
+    uint64_t key;
+    uint32_t len[FN_PART_COUNT];
+    uint32_t reserved;
+} FnPackRecord;
+
+struct FnCache {
+    char *path;
+    char *unit;
+    /* The pack as read: records, and each record's data offset. */
+    char *old;
+    const FnPackRecord *old_recs;
+    const char *old_data;
+    size_t *old_offs;
+    int old_count;
+    int *slots; /* open addressing over old_recs by key: record + 1, or 0 */
+    int slot_cap;
+    /* The pack this compile writes back. */
+    StrBuf new_recs;
+    StrBuf new_data;
+    int new_count;
+    int misses;
+};
+
+static int cache_hits = 0;
+static int cache_misses = 0;
+static int cache_uncacheable = 0;
+
+void fn_cache_stats(int *hits, int *misses, int *uncacheable) {
+    if (hits) *hits = cache_hits;
+    if (misses) *misses = cache_misses;
+    if (uncacheable) *uncacheable = cache_uncacheable;
+}
+
+void fn_cache_note_uncacheable(FnCache *c) {
+    (void)c;
+    __sync_fetch_and_add(&cache_uncacheable, 1);
+}
+
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    char *buf;
+    long n;
+    if (!f) return NULL;
+    if (fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    buf = (char *)xmalloc((size_t)n + 1);
+    if (fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = (size_t)n;
+    return buf;
+}
+
+static int slot_of(uint64_t key, int cap) {
+    return (int)(key & (uint64_t)(cap - 1));
+}
+
+/* Adopts the pack in BUF[0..len) if it is intact and was written for C's unit. */
+static int load_pack(FnCache *c, char *buf, size_t len) {
+    const FnPackHeader *h = (const FnPackHeader *)buf;
+    size_t recs_len;
+    size_t off = 0;
+    int i;
+
+    if (len < sizeof(*h) || memcmp(h->magic, "WFN1", 4) != 0 || h->version != WFN_VERSION) return 0;
+    recs_len = (size_t)h->count * sizeof(FnPackRecord);
+    if (len != sizeof(*h) + recs_len + h->unit_len + h->data_len) return 0;
+    if (hash_bytes(buf + sizeof(*h), len - sizeof(*h), HASH_SEED) != h->body_hash) return 0;
+    if (h->unit_len != strlen(c->unit) + 1 || memcmp(buf + sizeof(*h) + recs_len, c->unit, h->unit_len) != 0) return 0;
+
+    c->old_recs = (const FnPackRecord *)(buf + sizeof(*h));
+    c->old_data = buf + sizeof(*h) + recs_len + h->unit_len;
+    c->old_count = (int)h->count;
+    c->old_offs = (size_t *)xmalloc(((size_t)c->old_count + 1) * sizeof(size_t));
+    for (i = 0; i < c->old_count; i++) {
+        int p;
+        c->old_offs[i] = off;
+        for (p = 0; p < FN_PART_COUNT; p++) off += c->old_recs[i].len[p];
+    }
+    if (off != h->data_len) return 0;
+
+    c->slot_cap = 16;
+    while (c->slot_cap < c->old_count * 2) c->slot_cap *= 2;
+    c->slots = (int *)xmalloc((size_t)c->slot_cap * sizeof(int));
+    memset(c->slots, 0, (size_t)c->slot_cap * sizeof(int));
+    for (i = 0; i < c->old_count; i++) {
+        int s = slot_of(c->old_recs[i].key, c->slot_cap);
+        while (c->slots[s]) s = (s + 1) & (c->slot_cap - 1);
+        c->slots[s] = i + 1;
+    }
+    return 1;
+}
+
+FnCache *fn_cache_open(const char *dir, const char *unit) {
+    FnCache *c = (FnCache *)xmalloc(sizeof(FnCache));
+    char hex[17];
+    StrBuf path;
+    size_t len = 0;
+    char *buf;
+
+    memset(c, 0, sizeof(*c));
+    c->unit = xstrdup(unit);
+    hash_hex(hash_str(unit, HASH_SEED), hex);
+    sb_init(&path);
+    sb_append(&path, dir);
+    sb_append(&path, "/");
+    sb_append(&path, hex);
+    sb_append(&path, ".wfn");
+    c->path = path.data;
+    sb_init(&c->new_recs);
+    sb_init(&c->new_data);
+
+    buf = read_file(c->path, &len);
+    if (buf && load_pack(c, buf, len)) {
+        c->old = buf;
+    } else {
+        /* Missing, corrupt or colliding: start empty (and overwrite it). */
+        free(buf);
+        free(c->old_offs);
+        free(c->slots);
+        c->old_offs = NULL;
+        c->slots = NULL;
+        c->old_recs = NULL;
+        c->old_count = 0;
+    }
+    return c;
+}
+
+void fn_cache_add(FnCache *c, uint64_t key, const FnCacheEntry *e) {
+    FnPackRecord r;
+    int p;
+    memset(&r, 0, sizeof(r));
+    r.key = key;
+    for (p = 0; p < FN_PART_COUNT; p++) {
+        r.len[p] = (uint32_t)e->len[p];
+        if (e->len[p]) sb_append_n(&c->new_data, e->data[p], e->len[p]);
+    }
+    sb_append_n(&c->new_recs, (const char *)&r, sizeof(r));
+    c->new_count++;
+}
+
+int fn_cache_lookup(FnCache *c, uint64_t key, FnCacheEntry *out) {
+    if (c->slot_cap > 0) {
+        int s = slot_of(key, c->slot_cap);
+        while (c->slots[s]) {
+            int i = c->slots[s] - 1;
+            if (c->old_recs[i].key == key) {
+                const char *p = c->old_data + c->old_offs[i];
+                int part;
+                for (part = 0; part < FN_PART_COUNT; part++) {
+                    out->data[part] = p;
+                    out->len[part] = c->old_recs[i].len[part];
+                    p += out->len[part];
+                }
+                fn_cache_add(c, key, out);
+                __sync_fetch_and_add(&cache_hits, 1);
+                return 1;
+            }
+            s = (s + 1) & (c->slot_cap - 1);
+        }
+    }
+    c->misses++;
+    __sync_fetch_and_add(&cache_misses, 1);
+    return 0;
+}
+
+typedef struct {
+    const FnPackHeader *h;
+    const FnCache *c;
+} FnPack;
+
+static int write_pack_file(FILE *f, void *ctx) {
+    const FnPack *p = (const FnPack *)ctx;
+    const FnCache *c = p->c;
+    return fwrite(p->h, sizeof(*p->h), 1, f) == 1 &&
+                   fwrite(c->new_recs.data, 1, c->new_recs.len, f) == c->new_recs.len &&
+                   fwrite(c->unit, 1, p->h->unit_len, f) == p->h->unit_len &&
+                   fwrite(c->new_data.data, 1, c->new_data.len, f) == c->new_data.len
+               ? 0
+               : -1;
+}
+
+static void write_pack(FnCache *c) {
+    FnPackHeader h;
+    FnPack pack;
+    size_t unit_len = strlen(c->unit) + 1;
+    uint64_t body;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "WFN1", 4);
+    h.version = WFN_VERSION;
+    h.count = (uint32_t)c->new_count;
+    h.unit_len = (uint32_t)unit_len;
+    h.data_len = c->new_data.len;
+    body = hash_bytes(c->new_recs.data, c->new_recs.len, HASH_SEED);
+    body = hash_bytes(c->unit, unit_len, body);
+    h.body_hash = hash_bytes(c->new_data.data, c->new_data.len, body);
+
+    pack.h = &h;
+    pack.c = c;
+    write_file_atomic(c->path, write_pack_file, &pack);
+}
+
+void fn_cache_close(FnCache *c) {
+    if (!c) return;
+    /* Unchanged when every function hit and none went away. */
+    if (c->misses > 0 || c->new_count != c->old_count) write_pack(c);
+    free(c->path);
+    free(c->unit);
+    free(c->old);
+    free(c->old_offs);
+    free(c->slots);
+    free(c->new_recs.data);
+    free(c->new_data.data);
+    free(c);
+}
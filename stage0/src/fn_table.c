@@ -1,5 +1,8 @@
 #include "fn_table.h"
 
+#include "hash.h"
+#include "mem_stats.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +16,7 @@ static void fn_table_reserve(FnTable *t, int need) {
     t->ret_types = (TypeRef **)xrealloc(t->ret_types, (size_t)cap * sizeof(TypeRef *));
     t->param_counts = (int *)xrealloc(t->param_counts, (size_t)cap * sizeof(int));
     t->param_types = (TypeRef ***)xrealloc(t->param_types, (size_t)cap * sizeof(TypeRef **));
+    t->pure = (int *)xrealloc(t->pure, (size_t)cap * sizeof(int));
     t->cap = cap;
 }
 
@@ -23,12 +27,66 @@ void fn_table_init(FnTable *t) {
     t->ret_types = NULL;
     t->param_counts = NULL;
     t->param_types = NULL;
+    t->pure = NULL;
+    t->index = NULL;
+    t->index_cap = 0;
 }
 
-int fn_table_find(FnTable *t, const char *name) {
+void fn_table_free(FnTable *t) {
     int i;
     for (i = 0; i < t->count; i++) {
-        if (strcmp(t->names[i], name) == 0) return i;
+        free(t->names[i]);
+        free(t->param_types[i]);
+    }
+    free(t->names);
+    free(t->ret_types);
+    free(t->param_counts);
+    free(t->param_types);
+    free(t->pure);
+    free(t->index);
+    fn_table_init(t);
+}
+
+void fn_table_copy(FnTable *dst, const FnTable *src) {
+    int i;
+    fn_table_init(dst);
+    for (i = 0; i < src->count; i++) {
+        fn_table_add(dst, src->names[i], src->ret_types[i], src->param_counts[i], src->param_types[i]);
+        dst->pure[i] = src->pure[i];
+    }
+}
+
+static void index_insert(FnTable *t, int entry) {
+    int mask = t->index_cap - 1;
+    int slot = (int)(hash_str(t->names[entry], HASH_SEED) & (uint64_t)mask);
+    while (t->index[slot]) slot = (slot + 1) & mask;
+    t->index[slot] = entry + 1;
+}
+
+/* Keeps the index at most half full, rebuilding it as the table grows. */
+static void index_reserve(FnTable *t, int need) {
+    int cap;
+    int i;
+    if (need * 2 <= t->index_cap) return;
+    cap = t->index_cap ? t->index_cap : 64;
+    while (cap < need * 2) cap *= 2;
+    free(t->index);
+    t->index = (int *)xmalloc((size_t)cap * sizeof(int));
+    memset(t->index, 0, (size_t)cap * sizeof(int));
+    t->index_cap = cap;
+    for (i = 0; i < t->count; i++) index_insert(t, i);
+}
+
+int fn_table_find(FnTable *t, const char *name) {
+    int mask;
+    int slot;
+    if (t->index_cap == 0) return -1;
+    mask = t->index_cap - 1;
+    slot = (int)(hash_str(name, HASH_SEED) & (uint64_t)mask);
+    while (t->index[slot]) {
+        int entry = t->index[slot] - 1;
+        if (strcmp(t->names[entry], name) == 0) return entry;
+        slot = (slot + 1) & mask;
     }
     return -1;
 }
@@ -43,6 +101,7 @@ static TypeRef **copy_param_types(int param_count, TypeRef **param_types) {
 }
 
 void fn_table_add(FnTable *t, const char *name, TypeRef *ret_type, int param_count, TypeRef **param_types) {
+    MemCategory prev = mem_category_enter(MEM_TYPES);
     int idx = fn_table_find(t, name);
     TypeRef **pt = copy_param_types(param_count, param_types);
     if (idx >= 0) {
@@ -57,14 +116,20 @@ void fn_table_add(FnTable *t, const char *name, TypeRef *ret_type, int param_cou
         t->ret_types[idx] = ret_type;
         t->param_counts[idx] = param_count;
         t->param_types[idx] = pt;
+        t->pure[idx] = 0;
+        mem_category_leave(prev);
         return;
     }
     fn_table_reserve(t, t->count + 1);
+    index_reserve(t, t->count + 1);
     t->names[t->count] = xstrdup(name);
     t->ret_types[t->count] = ret_type;
     t->param_counts[t->count] = param_count;
     t->param_types[t->count] = pt;
+    t->pure[t->count] = 0;
+    index_insert(t, t->count);
     t->count += 1;
+    mem_category_leave(prev);
 }
 
 TypeRef *fn_table_ret_type(FnTable *t, const char *name, TypeRef *default_ret) {
@@ -79,6 +144,16 @@ int fn_table_param_count(FnTable *t, const char *name) {
     return t->param_counts[idx];
 }
 
+void fn_table_set_pure(FnTable *t, const char *name) {
+    int idx = fn_table_find(t, name);
+    if (idx >= 0) t->pure[idx] = 1;
+}
+
+int fn_table_is_pure(FnTable *t, const char *name) {
+    int idx = fn_table_find(t, name);
+    return idx >= 0 && t->pure[idx];
+}
+
 TypeRef *fn_table_param_type(FnTable *t, const char *name, int index, TypeRef *default_ty) {
     int idx = fn_table_find(t, name);
     if (idx < 0) return default_ty;
@@ -1,8 +1,13 @@
 #include "fs.h"
 
+#include "ast_cache.h"
+
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 char *read_file_all(const char *path) {
     FILE *f = fopen(path, "rb");
@@ -11,7 +16,7 @@ char *read_file_all(const char *path) {
     size_t nread;
     if (!f) {
         fprintf(stderr, "weavec0c: cannot read file: %s\n", path);
-        exit(1);
+        fatal_exit();
     }
     fseek(f, 0, SEEK_END);
     size = ftell(f);
@@ -56,7 +61,7 @@ char *read_file_all(const char *path) {
                 fprintf(stderr,
                         "weavec0c: error: @weave-allow-long-file directive requires a reason: %s\n",
                         path);
-                exit(1);
+                fatal_exit();
             }
         }
         
@@ -82,7 +87,7 @@ char *read_file_all(const char *path) {
                 fprintf(stderr,
                         "weavec0c:       at the very first line of the file.\n");
             }
-            exit(1);
+            fatal_exit();
         }
         if (lines > 256) {
             fprintf(stderr,
@@ -94,6 +99,48 @@ char *read_file_all(const char *path) {
     return buf;
 }
 
+int ensure_dir(const char *dir, const char *what) {
+    struct stat st;
+    if (mkdir(dir, 0777) == 0) return 0;
+    if (stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) return 0;
+    fprintf(stderr, "weavec0c: warning: cannot use %s: %s\n", what, dir);
+    return -1;
+}
+
+int read_full(int fd, void *buf, size_t n) {
+    char *p = (char *)buf;
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+int write_file_atomic(const char *path, FileWriterFn write, void *ctx) {
+    static unsigned seq = 0;
+    char suffix[64];
+    StrBuf tmp;
+    FILE *f;
+    int ok = 0;
+
+    snprintf(suffix, sizeof(suffix), ".tmp.%d.%u", (int)getpid(), __sync_fetch_and_add(&seq, 1u));
+    sb_init(&tmp);
+    sb_append(&tmp, path);
+    sb_append(&tmp, suffix);
+    f = fopen(tmp.data, "wb");
+    if (f) {
+        ok = write(f, ctx) == 0;
+        if (fclose(f) != 0) ok = 0;
+        if (ok && rename(tmp.data, path) != 0) ok = 0;
+        if (!ok) unlink(tmp.data);
+    }
+    free(tmp.data);
+    return ok ? 0 : -1;
+}
+
 static char *path_join2(const char *a, const char *b) {
     size_t na = strlen(a);
     size_t nb = strlen(b);
@@ -185,7 +232,7 @@ static void merge_includes_in_list(Node *list, StrList *included_files, const ch
             resolved = resolve_include_path(inc, base_dir, include_dirs);
             if (!resolved) {
                 fprintf(stderr, "weavec0c: include not found: %s (base_dir=%s)\n", inc, base_dir ? base_dir : "<null>");
-                exit(1);
+                fatal_exit();
             }
             {
                 char *canon = realpath(resolved, NULL);
@@ -210,11 +257,9 @@ void merge_includes(Node *top, StrList *included_files, const char *base_dir, St
 }
 
 static void merge_file_into(Node *dst_list, const char *file_path, StrList *included_files, StrList *include_dirs, const char *current_filename) {
-    char *src = read_file_all(file_path);
-    Node *file_top = parse_top(src, file_path);
+    Node *file_top = ast_cache_load(file_path);
     char *dir = dir_name(file_path);
     int i;
-    free(src);
 
     merge_includes(file_top, included_files, dir, include_dirs, file_path);
     free(dir);
@@ -223,3 +268,51 @@ static void merge_file_into(Node *dst_list, const char *file_path, StrList *incl
         node_list_push(dst_list, file_top->items[i]);
     }
 }
+
+static void prefetch_in_list(Node *list, const char *base_dir, StrList *include_dirs, StrList *seen);
+
+static void prefetch_file(const char *path, StrList *include_dirs, StrList *seen) {
+    Node *top = ast_cache_peek(path);
+    char *dir = dir_name(path);
+    prefetch_in_list(top, dir, include_dirs, seen);
+    free(dir);
+}
+
+/* Same include walk as merge_includes_in_list, but read-only: cached trees
+ * are shared and must not be rewritten. */
+static void prefetch_in_list(Node *list, const char *base_dir, StrList *include_dirs, StrList *seen) {
+    int i;
+    for (i = 0; i < list->count; i++) {
+        Node *form = list->items[i];
+        Node *head = list_nth(form, 0);
+        if (!head || head->kind != N_ATOM) continue;
+
+        if (strcmp(head->text, "include") == 0) {
+            const char *inc = atom_text(list_nth(form, 1));
+            char *resolved;
+            char *canon;
+
+            if (!inc || inc[0] == '\0') continue;
+            resolved = resolve_include_path(inc, base_dir, include_dirs);
+            if (!resolved) continue; /* reported by the real compile */
+            canon = realpath(resolved, NULL);
+            if (canon && !sl_contains(seen, canon)) {
+                sl_push(seen, canon);
+                prefetch_file(canon, include_dirs, seen);
+            }
+            free(canon);
+            free(resolved);
+        } else if (is_atom(head, "module") || is_atom(head, "program")) {
+            prefetch_in_list(form, base_dir, include_dirs, seen);
+        }
+    }
+}
+
+void prefetch_includes(const char *path, StrList *include_dirs) {
+    StrList seen;
+    int i;
+    sl_init(&seen);
+    prefetch_file(path, include_dirs, &seen);
+    for (i = 0; i < seen.len; i++) free(seen.items[i]);
+    free(seen.items);
+}
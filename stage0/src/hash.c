@@ -0,0 +1,61 @@
+#include "hash.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+uint64_t hash_bytes(const void *data, size_t n, uint64_t h) {
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t hash_str(const char *s, uint64_t h) {
+    return hash_bytes(s, strlen(s) + 1, h);
+}
+
+static uint64_t compiler_identity;
+static pthread_once_t compiler_identity_once = PTHREAD_ONCE_INIT;
+
+int hash_file(const char *path, uint64_t *h) {
+    FILE *f = fopen(path, "rb");
+    uint64_t acc = *h;
+    char buf[65536];
+    size_t n;
+    int ok;
+    if (!f) return -1;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) acc = hash_bytes(buf, n, acc);
+    ok = !ferror(f);
+    fclose(f);
+    if (!ok) return -1;
+    *h = acc;
+    return 0;
+}
+
+static void compute_compiler_identity(void) {
+    uint64_t h = HASH_SEED;
+    if (hash_file("/proc/self/exe", &h) != 0) {
+        /* No /proc: fall back to the build time. */
+        h = hash_str(__DATE__ " " __TIME__, h);
+    }
+    compiler_identity = h;
+}
+
+uint64_t hash_compiler_identity(void) {
+    pthread_once(&compiler_identity_once, compute_compiler_identity);
+    return compiler_identity;
+}
+
+void hash_hex(uint64_t h, char out[17]) {
+    static const char digits[] = "0123456789abcdef";
+    int i;
+    for (i = 15; i >= 0; i--) {
+        out[i] = digits[h & 0xF];
+        h >>= 4;
+    }
+    out[16] = '\0';
+}
@@ -17,6 +17,25 @@ void ir_init(IrCtx *ir, StrBuf *out) {
     sl_init(&ir->selected_test_names);
     sl_init(&ir->selected_tags);
     ir->saw_expect = 0;
+    ir->jit_sites = 0;
+    ir->strings = 0;
+    ir->allow_untested = 0;
+    ir->strict_names = 0;
+    ir->const_evals = NULL;
+    ir->const_eval_inline = 0;
+    ir->inline_llvm_jit = 0;
+    sl_init(&ir->inline_jit_irs);
+    sl_init(&ir->inline_jit_fns);
+    sl_init(&ir->inline_jit_syms);
+    ir->fn_cache = NULL;
+    ir->string_scope = NULL;
+    ir->module_ccalls = 0;
+    ir->nsw = 0;
+    ir->strict_aliasing = 0;
+    ir->tbaa = NULL;
+    sb_init(&ir->metadata);
+    ir->metadata_ids = 0;
+    ir->entry_allocas = NULL;
 }
 
 int ir_fresh_temp(IrCtx *ir) {
@@ -46,3 +65,13 @@ void ir_emit_label_def(StrBuf *out, int lbl) {
     sb_printf_i32(out, lbl);
     sb_append(out, ":\n");
 }
+
+void ir_emit_string_name(StrBuf *out, const IrCtx *ir, const char *prefix, int id) {
+    sb_append(out, prefix);
+    if (ir->string_scope) {
+        sb_append(out, ".");
+        sb_append(out, ir->string_scope);
+        sb_append(out, ".");
+    }
+    sb_printf_i32(out, id);
+}
@@ -1,5 +1,7 @@
 #include "lexer.h"
 
+#include "mem_stats.h"
+
 #include <ctype.h>
 #include <string.h>
 
@@ -46,6 +48,7 @@ static int is_atom_char(int ch) {
 }
 
 static char *lex_read_while(Lexer *lx, int (*pred)(int)) {
+    MemCategory prev = mem_category_enter(MEM_LEXER);
     StrBuf b;
     sb_init(&b);
     while (1) {
@@ -53,11 +56,13 @@ static char *lex_read_while(Lexer *lx, int (*pred)(int)) {
         if (ch < 0 || !pred(ch)) break;
         sb_append_ch(&b, (char)lex_get(lx));
     }
-    if (!b.data) return xstrdup("");
+    if (!b.data) b.data = xstrdup("");
+    mem_category_leave(prev);
     return b.data;
 }
 
 static char *lex_read_string(Lexer *lx) {
+    MemCategory prev = mem_category_enter(MEM_LEXER);
     StrBuf b;
     sb_init(&b);
     if (lex_get(lx) != '"') die("expected '\"' to start string literal");
@@ -76,7 +81,8 @@ static char *lex_read_string(Lexer *lx) {
             sb_append_ch(&b, (char)ch);
         }
     }
-    if (!b.data) return xstrdup("");
+    if (!b.data) b.data = xstrdup("");
+    mem_category_leave(prev);
     return b.data;
 }
 
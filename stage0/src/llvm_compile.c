@@ -1,42 +1,23 @@
 #include "llvm_compile.h"
 
+#include "mem_stats.h"
+#include "timing.h"
+
 #include <llvm-c/Core.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Support.h>
 
-/* Optimization pass headers - may not be available in all LLVM versions */
-#ifdef __has_include
-  #if __has_include(<llvm-c/Transforms/Scalar.h>)
-    #include <llvm-c/Transforms/Scalar.h>
-    #define HAVE_LLVM_SCALAR_PASSES 1
-  #endif
-  #if __has_include(<llvm-c/Transforms/IPO.h>)
-    #include <llvm-c/Transforms/IPO.h>
-    #define HAVE_LLVM_IPO_PASSES 1
-  #endif
-  #if __has_include(<llvm-c/Transforms/Vectorize.h>)
-    #include <llvm-c/Transforms/Vectorize.h>
-    #define HAVE_LLVM_VECTORIZE_PASSES 1
-  #endif
-#else
-  /* Fallback for compilers without __has_include */
-  #include <llvm-c/Transforms/Scalar.h>
-  #include <llvm-c/Transforms/IPO.h>
-  #include <llvm-c/Transforms/Vectorize.h>
-  #define HAVE_LLVM_SCALAR_PASSES 1
-  #define HAVE_LLVM_IPO_PASSES 1
-  #define HAVE_LLVM_VECTORIZE_PASSES 1
-#endif
+#include <llvm-c/Linker.h>
+#include <llvm-c/Transforms/PassBuilder.h>
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <unistd.h>
-#include <sys/wait.h>
 
 /* Convert optimization level to LLVM codegen level */
 static LLVMCodeGenOptLevel get_opt_level(int opt_level) {
@@ -49,82 +30,50 @@ static LLVMCodeGenOptLevel get_opt_level(int opt_level) {
     }
 }
 
-/* Initialize LLVM targets (idempotent, safe to call multiple times) */
-static void init_llvm_targets(void) {
-    static int initialized = 0;
-    if (initialized) return;
-    
+static void init_llvm_targets_once(void) {
     LLVMInitializeAllTargetInfos();
     LLVMInitializeAllTargets();
     LLVMInitializeAllTargetMCs();
     LLVMInitializeAllAsmParsers();
     LLVMInitializeAllAsmPrinters();
-    
-    initialized = 1;
 }
 
-/* Run optimization passes on a module based on optimization level.
+/* Initialize LLVM targets (idempotent, safe to call from several threads) */
+static void init_llvm_targets(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, init_llvm_targets_once);
+}
+
+void llvm_compile_init(void) {
+    init_llvm_targets();
+}
+
+/* Run the standard -O<n> pipeline on a module.
  * Returns 0 on success, non-zero on error.
- * Note: Some LLVM versions may not have all pass functions available.
- * This function uses the legacy pass manager API which is widely supported.
+ * Uses the new pass manager (LLVMRunPasses); the legacy C pass API this used
+ * to call was removed in LLVM 17.
  */
-static int run_optimization_passes(LLVMModuleRef module, int opt_level) {
-    if (opt_level == 0) {
+static int run_optimization_passes(LLVMModuleRef module, LLVMTargetMachineRef target_machine, int opt_level) {
+    char pipeline[16];
+    LLVMPassBuilderOptionsRef options;
+    LLVMErrorRef err;
+
+    if (opt_level <= 0) {
         /* -O0: No optimizations */
         return 0;
     }
-    
-    LLVMPassManagerRef pm = LLVMCreatePassManager();
-    if (!pm) {
-        fprintf(stderr, "weavec: failed to create pass manager\n");
+    if (opt_level > 3) opt_level = 3;
+    snprintf(pipeline, sizeof(pipeline), "default<O%d>", opt_level);
+
+    options = LLVMCreatePassBuilderOptions();
+    err = LLVMRunPasses(module, pipeline, target_machine, options);
+    LLVMDisposePassBuilderOptions(options);
+    if (err) {
+        char *msg = LLVMGetErrorMessage(err);
+        fprintf(stderr, "weavec: optimization pipeline failed: %s\n", msg);
+        LLVMDisposeErrorMessage(msg);
         return 1;
     }
-    
-    /* Add standard optimization passes based on level */
-    /* Note: These functions may not be available in all LLVM versions.
-     * If compilation fails, some passes may need to be conditionally compiled.
-     */
-    if (opt_level >= 1) {
-        /* -O1: Basic optimizations */
-        LLVMAddConstantPropagationPass(pm);
-        LLVMAddInstructionCombiningPass(pm);
-        LLVMAddReassociatePass(pm);
-        LLVMAddGVNPass(pm);
-        LLVMAddCFGSimplificationPass(pm);
-        LLVMAddPromoteMemoryToRegisterPass(pm);
-    }
-    
-    if (opt_level >= 2) {
-        /* -O2: Standard optimizations (includes O1 passes) */
-        LLVMAddDeadStoreEliminationPass(pm);
-        LLVMAddAggressiveDCEPass(pm);
-        LLVMAddFunctionInliningPass(pm);
-        LLVMAddLoopUnrollPass(pm);
-        LLVMAddLoopUnswitchPass(pm);
-        LLVMAddLICMPass(pm);
-        LLVMAddLoopDeletionPass(pm);
-        LLVMAddLoopIdiomPass(pm);
-        LLVMAddIndVarSimplifyPass(pm);
-        LLVMAddLoopRotatePass(pm);
-    }
-    
-    if (opt_level >= 3) {
-        /* -O3: Aggressive optimizations (includes O2 passes) */
-        LLVMAddArgumentPromotionPass(pm);
-        LLVMAddFunctionAttrsPass(pm);
-        LLVMAddTailCallEliminationPass(pm);
-#ifdef HAVE_LLVM_VECTORIZE_PASSES
-        LLVMAddLoopVectorizePass(pm);
-        LLVMAddSLPVectorizePass(pm);
-#endif
-    }
-    
-    /* Run passes on the module */
-    LLVMRunPassManager(pm, module);
-    
-    /* Clean up */
-    LLVMDisposePassManager(pm);
-    
     return 0;
 }
 
@@ -141,6 +90,8 @@ int llvm_compile_ir_to_object_asan(const char *ir_string, size_t ir_len,
     LLVMModuleRef module = NULL;
     LLVMTargetMachineRef target_machine = NULL;
     int result = 1;
+    int rc;
+    size_t rss_before = mem_stats_active ? mem_current_rss() : 0;
     
     /* Initialize LLVM targets */
     init_llvm_targets();
@@ -161,7 +112,10 @@ int llvm_compile_ir_to_object_asan(const char *ir_string, size_t ir_len,
     }
     
     /* Parse IR - LLVMParseIRInContext returns 0 on success */
-    if (LLVMParseIRInContext(context, mem_buf, &module, &error) != 0) {
+    timing_push("parse IR");
+    rc = LLVMParseIRInContext(context, mem_buf, &module, &error);
+    timing_pop();
+    if (rc != 0) {
         if (error) {
             fprintf(stderr, "weavec: failed to parse LLVM IR: %s\n", error);
             LLVMDisposeMessage(error);
@@ -215,14 +169,20 @@ int llvm_compile_ir_to_object_asan(const char *ir_string, size_t ir_len,
     
     /* Run optimization passes before codegen if optimization level > 0 */
     if (opt_level > 0) {
-        if (run_optimization_passes(module, opt_level) != 0) {
+        int opt_rc;
+        timing_push("optimize");
+        opt_rc = run_optimization_passes(module, target_machine, opt_level);
+        timing_pop();
+        if (opt_rc != 0) {
             fprintf(stderr, "weavec: warning: optimization passes failed, continuing without optimizations\n");
         }
     }
     
     /* Emit object file */
-    if (LLVMTargetMachineEmitToFile(target_machine, module, output_path,
-                                     LLVMObjectFile, &error) != 0) {
+    timing_push("emit object");
+    rc = LLVMTargetMachineEmitToFile(target_machine, module, output_path, LLVMObjectFile, &error);
+    timing_pop();
+    if (rc != 0) {
         if (error) {
             fprintf(stderr, "weavec: failed to emit object file: %s\n", error);
             LLVMDisposeMessage(error);
@@ -235,6 +195,11 @@ int llvm_compile_ir_to_object_asan(const char *ir_string, size_t ir_len,
     result = 0;
     
 cleanup:
+    /* Sampled while the module and target machine are still alive. */
+    if (mem_stats_active) {
+        size_t rss_after = mem_current_rss();
+        mem_stats_note_in(MEM_LLVM, rss_after > rss_before ? rss_after - rss_before : 0);
+    }
     if (target_machine) {
         LLVMDisposeTargetMachine(target_machine);
     }
@@ -328,6 +293,8 @@ int llvm_compile_ir_to_assembly_internal(const char *ir_string, size_t ir_len,
     LLVMModuleRef module = NULL;
     LLVMTargetMachineRef target_machine = NULL;
     int result = 1;
+    int rc;
+    size_t rss_before = mem_stats_active ? mem_current_rss() : 0;
     
     /* Initialize LLVM targets */
     init_llvm_targets();
@@ -348,7 +315,10 @@ int llvm_compile_ir_to_assembly_internal(const char *ir_string, size_t ir_len,
     }
     
     /* Parse IR - LLVMParseIRInContext returns 0 on success */
-    if (LLVMParseIRInContext(context, mem_buf, &module, &error) != 0) {
+    timing_push("parse IR");
+    rc = LLVMParseIRInContext(context, mem_buf, &module, &error);
+    timing_pop();
+    if (rc != 0) {
         if (error) {
             fprintf(stderr, "weavec: failed to parse LLVM IR: %s\n", error);
             LLVMDisposeMessage(error);
@@ -402,14 +372,20 @@ int llvm_compile_ir_to_assembly_internal(const char *ir_string, size_t ir_len,
     
     /* Run optimization passes before codegen if optimization level > 0 */
     if (opt_level > 0) {
-        if (run_optimization_passes(module, opt_level) != 0) {
+        int opt_rc;
+        timing_push("optimize");
+        opt_rc = run_optimization_passes(module, target_machine, opt_level);
+        timing_pop();
+        if (opt_rc != 0) {
             fprintf(stderr, "weavec: warning: optimization passes failed, continuing without optimizations\n");
         }
     }
     
     /* Emit assembly file */
-    if (LLVMTargetMachineEmitToFile(target_machine, module, output_path,
-                                     LLVMAssemblyFile, &error) != 0) {
+    timing_push("emit assembly");
+    rc = LLVMTargetMachineEmitToFile(target_machine, module, output_path, LLVMAssemblyFile, &error);
+    timing_pop();
+    if (rc != 0) {
         if (error) {
             fprintf(stderr, "weavec: failed to emit assembly file: %s\n", error);
             LLVMDisposeMessage(error);
@@ -422,6 +398,11 @@ int llvm_compile_ir_to_assembly_internal(const char *ir_string, size_t ir_len,
     result = 0;
     
 cleanup:
+    /* Sampled while the module and target machine are still alive. */
+    if (mem_stats_active) {
+        size_t rss_after = mem_current_rss();
+        mem_stats_note_in(MEM_LLVM, rss_after > rss_before ? rss_after - rss_before : 0);
+    }
     if (target_machine) {
         LLVMDisposeTargetMachine(target_machine);
     }
@@ -443,67 +424,77 @@ cleanup:
     return result;
 }
 
-/* Link object files into an executable using clang as linker.
- * This replaces system() calls with a more controlled fork/exec approach.
- * Note: For full LLVM integration, this could use lld instead of clang.
- */
-int llvm_link_objects(const char *object_files, const char *extra_flags, const char *output_path) {
-    pid_t pid;
-    int status;
-    int result = 1;
-    
-    /* Build command string */
-    size_t cmd_size = 64; /* "clang " */
-    if (extra_flags) cmd_size += strlen(extra_flags);
-    if (output_path) cmd_size += strlen(output_path) + 4; /* " -o " */
-    if (object_files) cmd_size += strlen(object_files);
-    
-    char *cmd = (char *)malloc(cmd_size);
-    if (!cmd) {
-        fprintf(stderr, "weavec: failed to allocate memory for link command\n");
-        return 1;
-    }
-    
-    /* Construct command string */
-    strcpy(cmd, "clang");
-    if (extra_flags && strlen(extra_flags) > 0) {
-        strcat(cmd, " ");
-        strcat(cmd, extra_flags);
+/* Make every definition in MODULE except KEEP internal, so linking several
+ * IR literals cannot clash on helper names. */
+static void internalize_except(LLVMModuleRef module, LLVMValueRef keep) {
+    LLVMValueRef v;
+    for (v = LLVMGetFirstFunction(module); v; v = LLVMGetNextFunction(v)) {
+        if (v != keep && !LLVMIsDeclaration(v)) LLVMSetLinkage(v, LLVMInternalLinkage);
     }
-    if (output_path && strlen(output_path) > 0) {
-        strcat(cmd, " -o ");
-        strcat(cmd, output_path);
+    for (v = LLVMGetFirstGlobal(module); v; v = LLVMGetNextGlobal(v)) {
+        if (!LLVMIsDeclaration(v)) LLVMSetLinkage(v, LLVMInternalLinkage);
     }
-    if (object_files && strlen(object_files) > 0) {
-        strcat(cmd, " ");
-        strcat(cmd, object_files);
+}
+
+int llvm_link_ir_literals(const char *module_ir, size_t module_len, int count,
+                          const char *const *irs, const char *const *fns,
+                          const char *const *syms, char **out_ir) {
+    char *error = NULL;
+    LLVMContextRef context;
+    LLVMMemoryBufferRef mem_buf;
+    LLVMModuleRef module = NULL;
+    int result = 1;
+    int i;
+
+    *out_ir = NULL;
+    context = LLVMContextCreate();
+    mem_buf = LLVMCreateMemoryBufferWithMemoryRangeCopy(module_ir, module_len, "weave_module");
+    if (LLVMParseIRInContext(context, mem_buf, &module, &error) != 0) {
+        fprintf(stderr, "weavec: failed to parse module IR: %s\n", error ? error : "unknown error");
+        goto cleanup;
     }
-    
-    /* Fork and execute via sh -c for proper argument handling */
-    pid = fork();
-    if (pid == 0) {
-        /* Child process */
-        execlp("sh", "sh", "-c", cmd, NULL);
-        fprintf(stderr, "weavec: failed to execute linker command\n");
-        exit(1);
-    } else if (pid > 0) {
-        /* Parent process: wait for child */
-        if (waitpid(pid, &status, 0) == pid) {
-            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-                result = 0;
-            } else {
-                fprintf(stderr, "weavec: linker failed with exit code %d\n", 
-                        WIFEXITED(status) ? WEXITSTATUS(status) : -1);
-            }
-        } else {
-            fprintf(stderr, "weavec: failed to wait for linker process\n");
+
+    for (i = 0; i < count; i++) {
+        LLVMModuleRef lit = NULL;
+        LLVMValueRef fn;
+
+        if (error) {
+            LLVMDisposeMessage(error);
+            error = NULL;
         }
-    } else {
-        /* Fork failed */
-        fprintf(stderr, "weavec: failed to fork linker process\n");
+        mem_buf = LLVMCreateMemoryBufferWithMemoryRangeCopy(irs[i], strlen(irs[i]), "llvm_jit_literal");
+        if (LLVMParseIRInContext(context, mem_buf, &lit, &error) != 0) {
+            fprintf(stderr, "weavec: failed to parse llvm-jit IR for '%s': %s\n", fns[i],
+                    error ? error : "unknown error");
+            goto cleanup;
+        }
+        fn = LLVMGetNamedFunction(lit, fns[i]);
+        if (!fn || LLVMIsDeclaration(fn)) {
+            fprintf(stderr, "weavec: llvm-jit IR does not define function '%s'\n", fns[i]);
+            LLVMDisposeModule(lit);
+            goto cleanup;
+        }
+        internalize_except(lit, fn);
+        LLVMSetValueName2(fn, syms[i], strlen(syms[i]));
+        /* LLVMLinkModules2 takes ownership of lit; errors go to stderr. */
+        if (LLVMLinkModules2(module, lit) != 0) {
+            fprintf(stderr, "weavec: failed to link llvm-jit IR for '%s'\n", fns[i]);
+            goto cleanup;
+        }
+        fn = LLVMGetNamedFunction(module, syms[i]);
+        if (fn) LLVMSetLinkage(fn, LLVMInternalLinkage);
     }
-    
-    free(cmd);
+
+    {
+        char *text = LLVMPrintModuleToString(module);
+        *out_ir = strdup(text);
+        LLVMDisposeMessage(text);
+        result = *out_ir ? 0 : 1;
+    }
+
+cleanup:
+    if (error) LLVMDisposeMessage(error);
+    if (module) LLVMDisposeModule(module);
+    LLVMContextDispose(context);
     return result;
 }
-
@@ -5,51 +5,580 @@
 
 #ifdef USE_LLVM_API
 
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA1.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/Error.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace llvm;
 using namespace llvm::orc;
 
+// Module identifiers carrying this prefix are content-addressed cache keys.
+static const char *const kCacheKeyPrefix = "weave-jit-";
+
+#if LLVM_VERSION_MAJOR >= 18
+static CodeGenOptLevel jit_codegen_opt_level(int opt_level) {
+    switch (opt_level) {
+        case 0: return CodeGenOptLevel::None;
+        case 1: return CodeGenOptLevel::Less;
+        case 3: return CodeGenOptLevel::Aggressive;
+        default: return CodeGenOptLevel::Default;
+    }
+}
+#else
+static CodeGenOpt::Level jit_codegen_opt_level(int opt_level) {
+    switch (opt_level) {
+        case 0: return CodeGenOpt::None;
+        case 1: return CodeGenOpt::Less;
+        case 3: return CodeGenOpt::Aggressive;
+        default: return CodeGenOpt::Default;
+    }
+}
+#endif
+
+#if LLVM_VERSION_MAJOR >= 17
+static void *jit_symbol_address(const ExecutorAddr &addr) {
+    return addr.toPtr<void *>();
+}
+#else
+static void *jit_symbol_address(const JITEvaluatedSymbol &sym) {
+    return reinterpret_cast<void *>(static_cast<uintptr_t>(sym.getAddress()));
+}
+#endif
+
+// On-disk object cache. Objects are stored as <dir>/<key>.o where the key is
+// the SHA1 of the module IR, the target triple and the codegen opt level, so
+// any change to the input or the code generator configuration misses.
+class WeaveObjectCache : public ObjectCache {
+public:
+    explicit WeaveObjectCache(std::string dir) : dir_(std::move(dir)) {}
+
+    void notifyObjectCompiled(const Module *M, MemoryBufferRef obj) override {
+        std::string path;
+        if (!cache_path(M, path)) return;
+        if (sys::fs::create_directories(dir_)) return;
+        // Write to a private temporary and rename so concurrent sessions never
+        // observe a partially written object.
+        std::string tmp = path + ".tmp" + std::to_string(sys::Process::getProcessId());
+        {
+            std::error_code ec;
+            raw_fd_ostream os(tmp, ec, sys::fs::OF_None);
+            if (ec) return;
+            os << obj.getBuffer();
+            os.close();
+            if (os.has_error()) {
+                os.clear_error();
+                sys::fs::remove(tmp);
+                return;
+            }
+        }
+        if (sys::fs::rename(tmp, path)) sys::fs::remove(tmp);
+    }
+
+    std::unique_ptr<MemoryBuffer> getObject(const Module *M) override {
+        std::string path;
+        if (!cache_path(M, path)) return nullptr;
+        auto buf = MemoryBuffer::getFile(path, /*IsText=*/false,
+                                         /*RequiresNullTerminator=*/false);
+        if (!buf) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        return std::move(*buf);
+    }
+
+    unsigned hits() const { return hits_; }
+    unsigned misses() const { return misses_; }
+
+private:
+    bool cache_path(const Module *M, std::string &out) const {
+        StringRef id = M->getModuleIdentifier();
+        StringRef rest = id;
+        if (!rest.consume_front(kCacheKeyPrefix)) return false;
+        SmallString<256> p(dir_);
+        sys::path::append(p, id + ".o");
+        out = std::string(p.str());
+        return true;
+    }
+
+    std::string dir_;
+    std::atomic<unsigned> hits_{0};
+    std::atomic<unsigned> misses_{0};
+};
+
+// Module flag carrying a per-module codegen opt level. Tiered compilation
+// tags tier-0 modules with 0 and recompiled functions with the tier-up level;
+// untagged modules use the session's level.
+static const char *const kCodegenOptFlag = "weave.codegen-opt";
+
+// IR compiler honouring kCodegenOptFlag. Otherwise equivalent to
+// ConcurrentIRCompiler: a fresh TargetMachine per compile, so it is safe to
+// call from the tier-up thread and the main thread at once.
+class WeaveIRCompiler : public IRCompileLayer::IRCompiler {
+public:
+    WeaveIRCompiler(JITTargetMachineBuilder jtmb, ObjectCache *cache)
+        : IRCompiler(irManglingOptionsFromTargetOptions(jtmb.getOptions())),
+          jtmb_(std::move(jtmb)), cache_(cache) {}
+
+    Expected<std::unique_ptr<MemoryBuffer>> operator()(Module &M) override {
+        JITTargetMachineBuilder jtmb = jtmb_;
+        if (auto *level = mdconst::extract_or_null<ConstantInt>(M.getModuleFlag(kCodegenOptFlag))) {
+            jtmb.setCodeGenOptLevel(jit_codegen_opt_level((int)level->getZExtValue()));
+        }
+        auto tm = jtmb.createTargetMachine();
+        if (!tm) return tm.takeError();
+        SimpleCompiler compile(**tm, cache_);
+        return compile(M);
+    }
+
+private:
+    JITTargetMachineBuilder jtmb_;
+    ObjectCache *cache_;
+};
+
+// Writes /tmp/perf-<pid>.map, the plain-text symbol map `perf report` reads
+// for anonymous executable memory. One map per process, shared by sessions.
+class PerfMapListener : public JITEventListener {
+public:
+    void notifyObjectLoaded(ObjectKey, const object::ObjectFile &obj,
+                            const RuntimeDyld::LoadedObjectInfo &info) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_) {
+            std::string path = "/tmp/perf-" + std::to_string(sys::Process::getProcessId()) + ".map";
+            file_ = std::fopen(path.c_str(), "a");
+            if (!file_) return;
+        }
+        for (auto &entry : object::computeSymbolSizes(obj)) {
+            const object::SymbolRef &sym = entry.first;
+            auto type = sym.getType();
+            auto name = sym.getName();
+            auto sec = sym.getSection();
+            auto offset = sym.getAddress();
+            if (!type || !name || !sec || !offset) {
+                if (!type) consumeError(type.takeError());
+                if (!name) consumeError(name.takeError());
+                if (!sec) consumeError(sec.takeError());
+                if (!offset) consumeError(offset.takeError());
+                continue;
+            }
+            if (*type != object::SymbolRef::ST_Function || *sec == obj.section_end()) continue;
+            // Relocatable objects: symbol addresses are section offsets.
+            uint64_t addr = info.getSectionLoadAddress(**sec) + *offset - (*sec)->getAddress();
+            std::fprintf(file_, "%llx %llx %s\n", (unsigned long long)addr,
+                         (unsigned long long)entry.second, name->str().c_str());
+        }
+        std::fflush(file_);
+    }
+
+private:
+    std::mutex mutex_;
+    std::FILE *file_ = nullptr;
+};
+
+// Profiler listeners selected by $WEAVE_JIT_PERF: "map" writes the perf map,
+// "jitdump" uses LLVM's jitdump writer (consumed by `perf inject --jit`), and
+// any other non-empty value other than "0" enables both.
+static std::vector<JITEventListener *> perf_listeners_from_env() {
+    std::vector<JITEventListener *> out;
+    const char *mode = std::getenv("WEAVE_JIT_PERF");
+    if (!mode || !*mode || std::strcmp(mode, "0") == 0) return out;
+    bool want_map = std::strcmp(mode, "jitdump") != 0;
+    bool want_dump = std::strcmp(mode, "map") != 0;
+    if (want_dump) {
+        if (JITEventListener *l = JITEventListener::createPerfJITEventListener()) {
+            out.push_back(l);
+        } else if (!want_map) {
+            // LLVM built without LLVM_USE_PERF: fall back to the perf map.
+            want_map = true;
+        }
+    }
+    if (want_map) {
+        static PerfMapListener perf_map;
+        out.push_back(&perf_map);
+    }
+    return out;
+}
+
+struct JITSession;
+
+// A function under tiered compilation. Its tier-0 body is renamed NAME$t0 and
+// NAME becomes a stub that counts calls and jumps through NAME$tier.slot;
+// tier-up compiles NAME$t2 from the original IR and repoints the slot.
+struct TierFn {
+    JITSession *session;
+    std::string name;
+    std::shared_ptr<const std::string> ir; // Module text NAME came from
+    std::string local_suffix;              // Appended to IR's local symbols
+    JITDylib *jd;                          // Dylib holding the stub and slot
+    std::atomic<int> state{0};             // 0 = tier 0, 1 = queued, 2 = done
+};
+
+static void tier_up_request(uint64_t fn);
+
 // JIT Session wrapper
 struct JITSession {
     std::unique_ptr<LLJIT> jit;
     ThreadSafeContext tsc;
+    std::string triple;
+    int opt_level;
+    std::unique_ptr<WeaveObjectCache> cache;
+    // Layers added by llvm_jit_add_module_layer, oldest first.
+    std::vector<JITDylib *> layers;
+
+    // Tiered compilation; disabled while tier_threshold is 0.
+    unsigned tier_threshold = 0;
+    int tier_opt_level = 2;
+    std::deque<std::unique_ptr<TierFn>> tier_fns;
+    std::deque<TierFn *> tier_queue;
+    std::mutex tier_mutex;
+    std::condition_variable tier_cv;
+    std::thread tier_worker;
+    bool tier_stop = false;
+    bool tier_busy = false;
+    unsigned tier_dylibs = 0;
+    unsigned tier_modules = 0;
+    std::atomic<unsigned> tier_promoted{0};
     
-    JITSession() : tsc(std::make_unique<LLVMContext>()) {
+    JITSession(int level, const char *cache_dir)
+        : tsc(std::make_unique<LLVMContext>()), opt_level(level) {
         // Initialize LLVM targets
         InitializeNativeTarget();
         InitializeNativeTargetAsmPrinter();
         InitializeNativeTargetAsmParser();
-        
+
+        auto jtmb = JITTargetMachineBuilder::detectHost();
+        if (!jtmb) {
+            consumeError(jtmb.takeError());
+            return;
+        }
+        jtmb->setCodeGenOptLevel(jit_codegen_opt_level(opt_level));
+        triple = jtmb->getTargetTriple().str();
+
+        if (!cache_dir || !*cache_dir) cache_dir = std::getenv("WEAVE_JIT_CACHE_DIR");
+        if (cache_dir && *cache_dir) cache = std::make_unique<WeaveObjectCache>(cache_dir);
+
+        LLJITBuilder builder;
+        builder.setJITTargetMachineBuilder(std::move(*jtmb));
+        // Event listeners only hook RuntimeDyld, so profiling selects the
+        // RTDyld linking layer even where LLJIT would default to JITLink.
+        std::vector<JITEventListener *> listeners = perf_listeners_from_env();
+        if (!listeners.empty()) {
+            builder.setObjectLinkingLayerCreator(
+                [listeners](ExecutionSession &es, const Triple &)
+                    -> Expected<std::unique_ptr<ObjectLayer>> {
+                    auto layer = std::make_unique<RTDyldObjectLinkingLayer>(
+                        es,
+#if LLVM_VERSION_MAJOR >= 19
+                        [](const MemoryBuffer &) { return std::make_unique<SectionMemoryManager>(); });
+#else
+                        []() { return std::make_unique<SectionMemoryManager>(); });
+#endif
+                    for (JITEventListener *l : listeners) layer->registerJITEventListener(*l);
+                    return std::move(layer);
+                });
+        }
+        WeaveObjectCache *oc = cache.get();
+        builder.setCompileFunctionCreator(
+            [oc](JITTargetMachineBuilder jtmb)
+                -> Expected<std::unique_ptr<IRCompileLayer::IRCompiler>> {
+                return std::make_unique<WeaveIRCompiler>(std::move(jtmb), oc);
+            });
+
         // Create JIT
-        auto jit_or_error = LLJITBuilder().create();
-        if (jit_or_error) {
-            jit = std::move(*jit_or_error);
+        auto jit_or_error = builder.create();
+        if (!jit_or_error) {
+            consumeError(jit_or_error.takeError());
+            return;
+        }
+        jit = std::move(*jit_or_error);
+
+        // Let JIT'd code call into libc (malloc, puts, ...) and the host.
+        auto process_syms = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit->getDataLayout().getGlobalPrefix());
+        if (process_syms) {
+            jit->getMainJITDylib().addGenerator(std::move(*process_syms));
+        } else {
+            consumeError(process_syms.takeError());
+        }
+
+        if (const char *tier = std::getenv("WEAVE_JIT_TIER")) {
+            set_tiering((unsigned)std::strtoul(tier, nullptr, 10), 2);
+        }
+    }
+
+    void set_tiering(unsigned threshold, int level) {
+        tier_threshold = threshold;
+        tier_opt_level = level;
+        if (threshold && !tier_worker.joinable()) {
+            tier_worker = std::thread([this] { tier_worker_loop(); });
+        }
+    }
+
+    void tier_worker_loop() {
+        for (;;) {
+            TierFn *fn;
+            {
+                std::unique_lock<std::mutex> lock(tier_mutex);
+                tier_busy = false;
+                tier_cv.notify_all();
+                tier_cv.wait(lock, [this] { return tier_stop || !tier_queue.empty(); });
+                if (tier_stop) return;
+                fn = tier_queue.front();
+                tier_queue.pop_front();
+                tier_busy = true;
+            }
+            if (tier_up(fn)) tier_promoted++;
+            fn->state = 2;
+        }
+    }
+
+    // Instrument every externally visible definition in M for tiering.
+    // Called before M is handed to the JIT; JD is the dylib M is added to.
+    void instrument_tier0(Module &M, JITDylib &jd, std::shared_ptr<const std::string> ir) {
+        std::vector<Function *> candidates;
+        for (Function &F : M) {
+            StringRef name = F.getName();
+            if (F.isDeclaration() || F.hasLocalLinkage() || F.isVarArg()) continue;
+            // Compiler-generated entry points (REPL thunks, ...) run once.
+            if (name.substr(0, 7) == "__weave") continue;
+            candidates.push_back(&F);
+        }
+
+        // Tier-2 code is compiled from IR into another dylib, where a local
+        // symbol would be a fresh copy: a counter would restart on promotion.
+        // Export locals under names unique to this module so tier_up can
+        // declare them instead.
+        std::string local_suffix = "$local." + std::to_string(tier_modules++);
+        for (GlobalValue &G : M.global_values()) {
+            if (!G.hasLocalLinkage() || !G.hasName()) continue;
+            G.setName(G.getName() + local_suffix);
+            G.setLinkage(GlobalValue::ExternalLinkage);
+        }
+
+        LLVMContext &ctx = M.getContext();
+        FunctionType *up_ty = FunctionType::get(Type::getVoidTy(ctx), {Type::getInt64Ty(ctx)}, false);
+        Constant *up_fn = ConstantExpr::getIntToPtr(
+            ConstantInt::get(Type::getInt64Ty(ctx), (uint64_t)(uintptr_t)&tier_up_request),
+            PointerType::getUnqual(up_ty));
+        for (Function *F : candidates) {
+            std::string name = F->getName().str();
+            auto fn = std::make_unique<TierFn>();
+            fn->session = this;
+            fn->name = name;
+            fn->ir = ir;
+            fn->local_suffix = local_suffix;
+            fn->jd = &jd;
+
+            FunctionType *fty = F->getFunctionType();
+            F->setName(name + "$t0");
+            F->setLinkage(GlobalValue::InternalLinkage);
+            Function *stub = Function::Create(fty, GlobalValue::ExternalLinkage, name, &M);
+            stub->setCallingConv(F->getCallingConv());
+            F->replaceAllUsesWith(stub);
+
+            auto *count = new GlobalVariable(M, Type::getInt32Ty(ctx), false, GlobalValue::InternalLinkage,
+                                             ConstantInt::get(Type::getInt32Ty(ctx), 0), name + "$tier.count");
+            auto *slot = new GlobalVariable(M, PointerType::getUnqual(fty), false, GlobalValue::ExternalLinkage,
+                                            F, name + "$tier.slot");
+            slot->setAlignment(Align(8));
+
+            BasicBlock *entry = BasicBlock::Create(ctx, "entry", stub);
+            BasicBlock *up = BasicBlock::Create(ctx, "tier_up", stub);
+            BasicBlock *call = BasicBlock::Create(ctx, "call", stub);
+            IRBuilder<> b(entry);
+            Value *prev = b.CreateAtomicRMW(AtomicRMWInst::Add, count, b.getInt32(1), MaybeAlign(4),
+                                            AtomicOrdering::Monotonic);
+            b.CreateCondBr(b.CreateICmpEQ(prev, b.getInt32(tier_threshold - 1)), up, call,
+                           MDBuilder(ctx).createBranchWeights(1, 1u << 20));
+            b.SetInsertPoint(up);
+            b.CreateCall(up_ty, up_fn, {b.getInt64((uint64_t)(uintptr_t)fn.get())});
+            b.CreateBr(call);
+            b.SetInsertPoint(call);
+            LoadInst *target = b.CreateAlignedLoad(slot->getValueType(), slot, Align(8));
+            target->setAtomic(AtomicOrdering::Acquire);
+            std::vector<Value *> args;
+            for (Argument &arg : stub->args()) args.push_back(&arg);
+            CallInst *result = b.CreateCall(fty, target, args);
+            result->setCallingConv(F->getCallingConv());
+            result->setTailCall();
+            if (fty->getReturnType()->isVoidTy()) b.CreateRetVoid();
+            else b.CreateRet(result);
+
+            tier_fns.push_back(std::move(fn));
+        }
+        M.addModuleFlag(Module::Warning, kCodegenOptFlag, (uint32_t)0);
+    }
+
+    // Recompile one hot function from its original IR at tier_opt_level and
+    // publish it through the function's slot. Runs on the tier-up thread.
+    bool tier_up(TierFn *fn) {
+        auto ctx = std::make_unique<LLVMContext>();
+        SMDiagnostic diag;
+        auto M = parseIR(MemoryBufferRef(*fn->ir, "jit_tier_up"), diag, *ctx);
+        if (!M) return false;
+        Function *F = M->getFunction(fn->name);
+        if (!F || F->isDeclaration()) return false;
+        F->setName(fn->name + "$t2");
+        // Bind locals to the storage instrument_tier0 exported.
+        for (GlobalValue &G : M->global_values()) {
+            if (!G.hasLocalLinkage() || !G.hasName()) continue;
+            G.setName(G.getName() + fn->local_suffix);
+            G.setLinkage(GlobalValue::ExternalLinkage);
+            G.setDSOLocal(false);
         }
+        // Other definitions stay visible to the inliner but are not emitted:
+        // calls left after optimization bind to the tier-0 stubs.
+        for (Function &G : *M) {
+            if (&G != F && !G.isDeclaration()) {
+                G.setLinkage(GlobalValue::AvailableExternallyLinkage);
+            }
+        }
+        for (GlobalVariable &G : M->globals()) {
+            if (!G.isDeclaration()) {
+                G.setInitializer(nullptr);
+                G.setLinkage(GlobalValue::ExternalLinkage);
+            }
+        }
+        M->setDataLayout(jit->getDataLayout());
+        M->setTargetTriple(triple);
+        M->addModuleFlag(Module::Warning, kCodegenOptFlag, (uint32_t)tier_opt_level);
+
+        {
+            LoopAnalysisManager lam;
+            FunctionAnalysisManager fam;
+            CGSCCAnalysisManager cgam;
+            ModuleAnalysisManager mam;
+            PassBuilder pb;
+            pb.registerModuleAnalyses(mam);
+            pb.registerCGSCCAnalyses(cgam);
+            pb.registerFunctionAnalyses(fam);
+            pb.registerLoopAnalyses(lam);
+            pb.crossRegisterProxies(lam, fam, cgam, mam);
+            OptimizationLevel level = tier_opt_level >= 3 ? OptimizationLevel::O3
+                                    : tier_opt_level == 1 ? OptimizationLevel::O1
+                                    : OptimizationLevel::O2;
+            pb.buildPerModuleDefaultPipeline(level).run(*M, mam);
+        }
+
+        // The new dylib searches exactly what the tier-0 code saw.
+        ExecutionSession &es = jit->getExecutionSession();
+        auto jd = es.createJITDylib("weave.tier." + std::to_string(tier_dylibs++));
+        if (!jd) {
+            consumeError(jd.takeError());
+            return false;
+        }
+        JITDylibSearchOrder order;
+        fn->jd->withLinkOrderDo([&](const JITDylibSearchOrder &o) { order = o; });
+        jd->setLinkOrder(std::move(order));
+        if (auto err = jit->addIRModule(*jd, ThreadSafeModule(std::move(M), std::move(ctx)))) {
+            consumeError(std::move(err));
+            return false;
+        }
+        auto code = jit->lookup(*jd, fn->name + "$t2");
+        if (!code) {
+            consumeError(code.takeError());
+            return false;
+        }
+        auto slot = jit->lookup(*fn->jd, fn->name + "$tier.slot");
+        if (!slot) {
+            consumeError(slot.takeError());
+            return false;
+        }
+        reinterpret_cast<std::atomic<void *> *>(jit_symbol_address(*slot))
+            ->store(jit_symbol_address(*code), std::memory_order_release);
+        return true;
+    }
+
+    // Wait until no tier-up is queued or running.
+    void tier_sync() {
+        std::unique_lock<std::mutex> lock(tier_mutex);
+        tier_cv.wait(lock, [this] { return tier_queue.empty() && !tier_busy; });
+    }
+    
+    // Cache key for a module: hash of everything that determines the object.
+    std::string cache_key(StringRef ir) const {
+        SHA1 hasher;
+        hasher.update(ir);
+        hasher.update(StringRef("\0", 1));
+        hasher.update(triple);
+        hasher.update(StringRef("\0", 1));
+        hasher.update(std::to_string(opt_level));
+        return std::string(kCacheKeyPrefix) + toHex(hasher.final(), /*LowerCase=*/true);
     }
     
     ~JITSession() {
-        // Cleanup handled by unique_ptr
+        // Stop the tier-up thread before the JIT it compiles into goes away.
+        if (tier_worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(tier_mutex);
+                tier_stop = true;
+            }
+            tier_cv.notify_all();
+            tier_worker.join();
+        }
     }
 };
 
+// Called from tier-0 stubs when a function reaches the call threshold.
+static void tier_up_request(uint64_t p) {
+    TierFn *fn = reinterpret_cast<TierFn *>((uintptr_t)p);
+    int expected = 0;
+    if (!fn->state.compare_exchange_strong(expected, 1)) return;
+    JITSession *session = fn->session;
+    {
+        std::lock_guard<std::mutex> lock(session->tier_mutex);
+        session->tier_queue.push_back(fn);
+    }
+    session->tier_cv.notify_all();
+}
+
 extern "C" {
 
 LLVMJITSessionRef llvm_jit_create_session(void) {
+    return llvm_jit_create_session_ex(2, NULL);
+}
+
+LLVMJITSessionRef llvm_jit_create_session_ex(int opt_level, const char *cache_dir) {
     try {
-        auto session = new JITSession();
+        auto session = new JITSession(opt_level, cache_dir);
         if (!session->jit) {
             delete session;
             return NULL;
@@ -60,6 +589,39 @@ LLVMJITSessionRef llvm_jit_create_session(void) {
     }
 }
 
+// Parse IR text into a thread-safe module tagged with its cache key.
+static Expected<ThreadSafeModule> parse_jit_module(JITSession *session, const char *ir_string, size_t ir_len) {
+    auto mem_buf = MemoryBuffer::getMemBufferCopy(
+        StringRef(ir_string, ir_len), "jit_module");
+    
+    // Parse IR - create a new context for this module
+    auto ctx = std::make_unique<LLVMContext>();
+    SMDiagnostic err;
+    auto module = parseIR(mem_buf->getMemBufferRef(), err, *ctx);
+    if (!module) {
+        std::string msg;
+        raw_string_ostream os(msg);
+        err.print("jit_module", os);
+        return make_error<StringError>(os.str(), inconvertibleErrorCode());
+    }
+    // Tier-0 code embeds addresses of this process, so it is never cached.
+    if (session->cache && !session->tier_threshold) {
+        module->setModuleIdentifier(session->cache_key(StringRef(ir_string, ir_len)));
+    }
+    
+    // Create thread-safe module with the context
+    return ThreadSafeModule(std::move(module), ThreadSafeContext(std::move(ctx)));
+}
+
+// Report an ORC error on stderr when WEAVEC0_DEBUG_JIT is set.
+static void report_jit_error(Error err) {
+    if (std::getenv("WEAVEC0_DEBUG_JIT")) {
+        logAllUnhandledErrors(std::move(err), errs(), "[jit] ");
+    } else {
+        consumeError(std::move(err));
+    }
+}
+
 int llvm_jit_add_module(LLVMJITSessionRef session_ref, const char *ir_string, size_t ir_len) {
     if (!session_ref || !ir_string) {
         return 1;
@@ -67,33 +629,86 @@ int llvm_jit_add_module(LLVMJITSessionRef session_ref, const char *ir_string, si
     
     try {
         JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+        auto tsm = parse_jit_module(session, ir_string, ir_len);
+        if (!tsm) {
+            report_jit_error(tsm.takeError());
+            return 1;
+        }
         
-        // Create memory buffer from IR string
-        auto mem_buf = MemoryBuffer::getMemBufferCopy(
-            StringRef(ir_string, ir_len), "jit_module");
-        
-        // Parse IR - create a new context for this module
-        auto ctx = std::make_unique<LLVMContext>();
-        SMDiagnostic err;
-        auto module = parseIR(mem_buf->getMemBufferRef(), err, *ctx);
-        if (!module) {
+        if (session->tier_threshold) {
+            auto ir = std::make_shared<const std::string>(ir_string, ir_len);
+            tsm->withModuleDo([&](Module &M) {
+                session->instrument_tier0(M, session->jit->getMainJITDylib(), ir);
+            });
+        }
+
+        // Add module to JIT
+        if (auto err = session->jit->addIRModule(std::move(*tsm))) {
+            report_jit_error(std::move(err));
             return 1;
         }
         
-        // Create thread-safe module with the context
-        ThreadSafeModule tsm(std::move(module), ThreadSafeContext(std::move(ctx)));
+        return 0;
+    } catch (...) {
+        return 1;
+    }
+}
+
+int llvm_jit_add_module_layer(LLVMJITSessionRef session_ref, const char *ir_string, size_t ir_len) {
+    if (!session_ref || !ir_string) {
+        return 1;
+    }
+    
+    try {
+        JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+        auto tsm = parse_jit_module(session, ir_string, ir_len);
+        if (!tsm) {
+            report_jit_error(tsm.takeError());
+            return 1;
+        }
         
-        // Add module to JIT
-        if (auto err = session->jit->addIRModule(std::move(tsm))) {
+        // Each layer is its own JITDylib. Link order is not transitive, so a
+        // new layer lists every earlier layer explicitly, newest first, and
+        // then the main dylib (which resolves process symbols).
+        ExecutionSession &es = session->jit->getExecutionSession();
+        std::string name = "weave.layer." + std::to_string(session->layers.size());
+        auto jd = es.createJITDylib(name);
+        if (!jd) {
+            report_jit_error(jd.takeError());
             return 1;
         }
+        JITDylibSearchOrder order;
+        for (auto it = session->layers.rbegin(); it != session->layers.rend(); ++it) {
+            order.push_back({*it, JITDylibLookupFlags::MatchExportedSymbolsOnly});
+        }
+        order.push_back({&session->jit->getMainJITDylib(), JITDylibLookupFlags::MatchExportedSymbolsOnly});
+        jd->setLinkOrder(std::move(order));
+        if (session->tier_threshold) {
+            auto ir = std::make_shared<const std::string>(ir_string, ir_len);
+            tsm->withModuleDo([&](Module &M) { session->instrument_tier0(M, *jd, ir); });
+        }
         
+        if (auto err = session->jit->addIRModule(*jd, std::move(*tsm))) {
+            report_jit_error(std::move(err));
+            return 1;
+        }
+        session->layers.push_back(&*jd);
         return 0;
     } catch (...) {
         return 1;
     }
 }
 
+int llvm_jit_drop_last_layer(LLVMJITSessionRef session_ref) {
+    if (!session_ref) return 1;
+    JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+    if (session->layers.empty()) return 1;
+    // The dylib itself stays until the session is disposed: tier-up records
+    // may point into it, and nothing links against it any more.
+    session->layers.pop_back();
+    return 0;
+}
+
 void* llvm_jit_lookup_function(LLVMJITSessionRef session_ref, const char *function_name) {
     if (!session_ref || !function_name) {
         return NULL;
@@ -102,19 +717,53 @@ void* llvm_jit_lookup_function(LLVMJITSessionRef session_ref, const char *functi
     try {
         JITSession *session = reinterpret_cast<JITSession*>(session_ref);
         
-        // Look up symbol
-        auto sym = session->jit->lookup(function_name);
+        // Look up symbol, starting from the newest layer if there are any
+        auto sym = session->layers.empty()
+            ? session->jit->lookup(function_name)
+            : session->jit->lookup(*session->layers.back(), function_name);
         if (!sym) {
+            report_jit_error(sym.takeError());
             return NULL;
         }
         
-        // Get address - in newer LLVM, ExecutorAddr can be converted directly
-        return reinterpret_cast<void*>(sym->getValue());
+        return jit_symbol_address(*sym);
     } catch (...) {
         return NULL;
     }
 }
 
+int llvm_jit_cache_stats(LLVMJITSessionRef session_ref, unsigned *hits, unsigned *misses) {
+    JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+    if (!session || !session->cache) {
+        return 1;
+    }
+    if (hits) *hits = session->cache->hits();
+    if (misses) *misses = session->cache->misses();
+    return 0;
+}
+
+int llvm_jit_set_tiering(LLVMJITSessionRef session_ref, unsigned threshold, int opt_level) {
+    JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+    if (!session) {
+        return 1;
+    }
+    try {
+        session->set_tiering(threshold, opt_level);
+        return 0;
+    } catch (...) {
+        return 1;
+    }
+}
+
+unsigned llvm_jit_tier_sync(LLVMJITSessionRef session_ref) {
+    JITSession *session = reinterpret_cast<JITSession*>(session_ref);
+    if (!session) {
+        return 0;
+    }
+    session->tier_sync();
+    return session->tier_promoted;
+}
+
 void llvm_jit_dispose_session(LLVMJITSessionRef session_ref) {
     if (session_ref) {
         delete reinterpret_cast<JITSession*>(session_ref);
@@ -133,8 +782,12 @@ void* llvm_jit_compile_and_lookup(const char *ir_string, size_t ir_len, const ch
     }
     
     void *func_ptr = llvm_jit_lookup_function(session, function_name);
-    llvm_jit_dispose_session(session);
-    
+    if (!func_ptr) {
+        llvm_jit_dispose_session(session);
+        return NULL;
+    }
+    // The session owns the code func_ptr points into, so it must outlive
+    // every call through the pointer; it is intentionally never disposed.
     return func_ptr;
 }
 
@@ -146,7 +799,13 @@ void* llvm_jit_compile_and_lookup(const char *ir_string, size_t ir_len, const ch
 extern "C" {
 
 LLVMJITSessionRef llvm_jit_create_session(void) { return NULL; }
+LLVMJITSessionRef llvm_jit_create_session_ex(int, const char *) { return NULL; }
+int llvm_jit_cache_stats(LLVMJITSessionRef, unsigned *, unsigned *) { return 1; }
 int llvm_jit_add_module(LLVMJITSessionRef, const char *, size_t) { return 1; }
+int llvm_jit_add_module_layer(LLVMJITSessionRef, const char *, size_t) { return 1; }
+int llvm_jit_drop_last_layer(LLVMJITSessionRef) { return 1; }
+int llvm_jit_set_tiering(LLVMJITSessionRef, unsigned, int) { return 1; }
+unsigned llvm_jit_tier_sync(LLVMJITSessionRef) { return 0; }
 void* llvm_jit_lookup_function(LLVMJITSessionRef, const char *) { return NULL; }
 void llvm_jit_dispose_session(LLVMJITSessionRef) {}
 void* llvm_jit_compile_and_lookup(const char *, size_t, const char *) { return NULL; }
@@ -1,9 +1,73 @@
 // Helper functions for JIT that can be called from Weave via ccall
 #include "llvm_compile.h"
 #include "common.h"
+#include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdio.h>
+
+/* Sessions backing llvm-jit call sites, one per distinct IR module. They are
+ * never disposed: generated code caches the returned function pointers for
+ * the lifetime of the process. Guarded by jit_cache_lock, since weavec0 -j
+ * may evaluate const-eval forms on several threads. */
+static pthread_mutex_t jit_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static char **jit_cache_irs = NULL;
+static LLVMJITSessionRef *jit_cache_sessions = NULL;
+static int jit_cache_len = 0;
+static int jit_cache_cap = 0;
+
+static LLVMJITSessionRef jit_cache_session(const char *ir_string) {
+    LLVMJITSessionRef session;
+    int i;
+    for (i = 0; i < jit_cache_len; i++) {
+        if (strcmp(jit_cache_irs[i], ir_string) == 0) return jit_cache_sessions[i];
+    }
+    session = llvm_jit_create_session();
+    if (!session) return NULL;
+    if (llvm_jit_add_module(session, ir_string, strlen(ir_string)) != 0) {
+        llvm_jit_dispose_session(session);
+        return NULL;
+    }
+    if (jit_cache_len == jit_cache_cap) {
+        jit_cache_cap = jit_cache_cap ? jit_cache_cap * 2 : 8;
+        jit_cache_irs = (char **)xrealloc(jit_cache_irs, (size_t)jit_cache_cap * sizeof(char *));
+        jit_cache_sessions = (LLVMJITSessionRef *)xrealloc(jit_cache_sessions, (size_t)jit_cache_cap * sizeof(LLVMJITSessionRef));
+    }
+    jit_cache_irs[jit_cache_len] = xstrdup(ir_string);
+    jit_cache_sessions[jit_cache_len] = session;
+    jit_cache_len++;
+    return session;
+}
+
+static void *jit_cache_lookup(const char *ir_string, const char *function_name) {
+    LLVMJITSessionRef session;
+    void *fn = NULL;
+    if (!ir_string || !function_name) return NULL;
+    pthread_mutex_lock(&jit_cache_lock);
+    session = jit_cache_session(ir_string);
+    if (session) fn = llvm_jit_lookup_function(session, function_name);
+    pthread_mutex_unlock(&jit_cache_lock);
+    return fn;
+}
+
+/* Resolve the function behind an llvm-jit / llvm-jit-batch call site.
+ * Generated code calls this once per site and caches the result, then calls
+ * the pointer with the signature declared at the site.
+ * 
+ * Returns: Function pointer (never NULL)
+ *          Aborts with a diagnostic if the IR fails to compile or does not
+ *          define function_name, since the call site cannot continue.
+ */
+void *llvm_jit_lookup_cached(const char *ir_string, const char *function_name) {
+    void *func_ptr = jit_cache_lookup(ir_string, function_name);
+    if (!func_ptr) {
+        fprintf(stderr, "weave: llvm-jit: failed to compile or find function '%s'\n",
+                function_name ? function_name : "<null>");
+        abort();
+    }
+    return func_ptr;
+}
 
 /* JIT compile LLVM IR and return function pointer as integer.
  * This is a wrapper that can be called from Weave via ccall.
@@ -20,7 +84,7 @@ int llvm_jit_compile_and_get_ptr(const char *ir_string, const char *function_nam
         return 0;
     }
     
-    void *func_ptr = llvm_jit_compile_and_lookup(ir_string, strlen(ir_string), function_name);
+    void *func_ptr = jit_cache_lookup(ir_string, function_name);
     return (int)(intptr_t)func_ptr;
 }
 
@@ -42,7 +106,7 @@ int llvm_jit_call_i32_i32_i32(const char *ir_string, const char *function_name,
     }
     
     typedef int (*FuncPtr)(int, int);
-    FuncPtr func = (FuncPtr)llvm_jit_compile_and_lookup(ir_string, strlen(ir_string), function_name);
+    FuncPtr func = (FuncPtr)jit_cache_lookup(ir_string, function_name);
     
     if (!func) {
         return -1;
@@ -3,14 +3,27 @@
 #include "compiler.h"
 #include "stats.h"
 #include "builtins.h"
+#include "ast_cache.h"
+#include "ast_store.h"
+#include "fn_cache.h"
+#include "hash.h"
+#include "mem_stats.h"
+#include "result_cache.h"
+#include "server.h"
+#include "timing.h"
 #ifdef USE_LLVM_API
 #include "llvm_compile.h"
+#include "repl.h"
 #endif
 
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
 /* Output mode */
@@ -107,155 +120,350 @@ static void list_tests_in(Node *form) {
     }
 }
 
-int main(int argc, char **argv) {
-    const char *input = get_arg_value(argc, argv, "input");
-    const char *output = get_arg_value(argc, argv, "output");
-    const char *runtime_path = getenv("WEAVE_RUNTIME");
-    OutputMode mode = OUTPUT_EXECUTABLE;
-    int use_static = 0;
-    int optimize = 0;
-    int generate_tests_mode = 0;
-    int list_tests_only = 0;
-    int print_stats = 0;
+typedef struct {
+    const char *input;
+    const char *output;
+    const char *runtime_path;
+    OutputMode mode;
+    int use_static;
+    int optimize;
+    int generate_tests_mode;
+    int list_tests_only;
+    int print_stats;
+    int mem_report;          /* --mem-report: allocation totals per subsystem */
+    int repl_mode;
+    CodegenOptions cg_opts;
     StrList selected_test_names;
     StrList selected_tags;
-    sl_init(&selected_test_names);
-    sl_init(&selected_tags);
-    
-    /* Initialize compiler subsystems */
-    stats_init();
-    builtins_init();
-    /* clang-style: we accept -I dir, -Idir, -o outfile, and positional input. */
+    StrList inputs;          /* every positional input, in order */
+    const char *out_dir;     /* batch mode: outputs go here, named after inputs */
+    const char *ast_cache_dir; /* on-disk parsed-file cache (ast_store.h) */
+    const char *cache_dir;   /* whole-compilation result cache (result_cache.h) */
+    int time_report;         /* 0 off, 1 table (-ftime-report), 2 JSON (--time-report=json) */
+    const char *time_report_file; /* append reports here instead of stderr */
+    const char *trace_path;  /* --trace: Chrome trace-event file */
+    int jobs;                /* batch mode: worker threads */
+} CliOptions;
+
+/* clang-style: we accept -I dir, -Idir, -o outfile, and positional input. */
+static void parse_cli(int argc, char **argv, CliOptions *o) {
     int i;
+    memset(o, 0, sizeof(*o));
+    o->input = get_arg_value(argc, argv, "input");
+    o->output = get_arg_value(argc, argv, "output");
+    o->runtime_path = getenv("WEAVE_RUNTIME");
+    o->ast_cache_dir = getenv("WEAVEC0_AST_CACHE_DIR");
+    o->cg_opts.incremental_dir = getenv("WEAVEC0_INCREMENTAL_DIR");
+    o->cache_dir = getenv("WEAVEC0_CACHE_DIR");
+    o->mode = OUTPUT_EXECUTABLE;
+    sl_init(&o->selected_test_names);
+    sl_init(&o->selected_tags);
+    sl_init(&o->inputs);
+    o->jobs = 1;
     for (i = 1; i < argc; i++) {
         const char *a = argv[i];
         if (strcmp(a, "-o") == 0 && i + 1 < argc) {
-            output = argv[i + 1];
+            o->output = argv[i + 1];
             i++;
         } else if (strncmp(a, "-o", 2) == 0 && a[2] != '\0') {
-            output = a + 2;
+            o->output = a + 2;
         } else if (strcmp(a, "--output") == 0 && i + 1 < argc) {
-            output = argv[i + 1];
+            o->output = argv[i + 1];
             i++;
         } else if (strncmp(a, "--output=", 9) == 0) {
-            output = a + 9;
+            o->output = a + 9;
         } else if (strcmp(a, "--input") == 0 && i + 1 < argc) {
-            input = argv[i + 1];
+            o->input = argv[i + 1];
             i++;
         } else if (strncmp(a, "--input=", 8) == 0) {
-            input = a + 8;
+            o->input = a + 8;
         } else if (strcmp(a, "-S") == 0 || strcmp(a, "--emit-llvm") == 0 || strcmp(a, "-emit-llvm") == 0) {
-            mode = OUTPUT_LLVM_IR;
+            o->mode = OUTPUT_LLVM_IR;
         } else if (strcmp(a, "-c") == 0) {
-            mode = OUTPUT_OBJECT;
+            o->mode = OUTPUT_OBJECT;
         } else if (strcmp(a, "--static") == 0) {
-            use_static = 1;
+            o->use_static = 1;
         } else if (strcmp(a, "-O") == 0 || strcmp(a, "-O2") == 0 || strcmp(a, "--optimize") == 0) {
-            optimize = 1;
+            o->optimize = 1;
         } else if ((strcmp(a, "--runtime") == 0 || strcmp(a, "-runtime") == 0) && i + 1 < argc) {
-            runtime_path = argv[i + 1];
+            o->runtime_path = argv[i + 1];
             i++;
         } else if (strncmp(a, "--runtime=", 10) == 0) {
-            runtime_path = a + 10;
+            o->runtime_path = a + 10;
         } else if (strcmp(a, "--run-tests") == 0 || strcmp(a, "-run-tests") == 0 || strcmp(a, "-generate-tests") == 0) {
-            generate_tests_mode = 1;
+            o->generate_tests_mode = 1;
             /* In test generation mode, default to executable output to run tests. */
-            mode = OUTPUT_EXECUTABLE;
+            o->mode = OUTPUT_EXECUTABLE;
         } else if (strcmp(a, "--list-tests") == 0 || strcmp(a, "-list-tests") == 0) {
-            list_tests_only = 1;
+            o->list_tests_only = 1;
         } else if (strcmp(a, "--stats") == 0 || strcmp(a, "-stats") == 0 || strcmp(a, "--print-stats") == 0) {
-            print_stats = 1;
+            o->print_stats = 1;
+        } else if (strcmp(a, "--mem-report") == 0) {
+            o->mem_report = 1;
+        } else if (strcmp(a, "--repl") == 0) {
+            o->repl_mode = 1;
+        } else if (strcmp(a, "--inline-llvm-jit") == 0) {
+            o->cg_opts.inline_llvm_jit = 1;
+        } else if (strcmp(a, "--nsw") == 0) {
+            o->cg_opts.nsw = 1;
+        } else if (strcmp(a, "-fstrict-aliasing") == 0 || strcmp(a, "--strict-aliasing") == 0) {
+            o->cg_opts.strict_aliasing = 1;
+        } else if (strcmp(a, "-fno-strict-aliasing") == 0) {
+            o->cg_opts.strict_aliasing = 0;
         } else if (strcmp(a, "-test") == 0 && i + 1 < argc) {
-            sl_push(&selected_test_names, argv[i + 1]);
+            sl_push(&o->selected_test_names, argv[i + 1]);
             i++;
         } else if (strncmp(a, "-test=", 6) == 0) {
-            sl_push(&selected_test_names, a + 6);
+            sl_push(&o->selected_test_names, a + 6);
         } else if (strcmp(a, "-tag") == 0 && i + 1 < argc) {
-            sl_push(&selected_tags, argv[i + 1]);
+            sl_push(&o->selected_tags, argv[i + 1]);
             i++;
         } else if (strncmp(a, "-tag=", 5) == 0) {
-            sl_push(&selected_tags, a + 5);
+            sl_push(&o->selected_tags, a + 5);
+        } else if (strcmp(a, "-j") == 0 && i + 1 < argc) {
+            o->jobs = atoi(argv[i + 1]);
+            i++;
+        } else if (strncmp(a, "-j", 2) == 0 && a[2] != '\0') {
+            o->jobs = atoi(a + 2);
+        } else if (strncmp(a, "--jobs=", 7) == 0) {
+            o->jobs = atoi(a + 7);
+        } else if (strcmp(a, "--out-dir") == 0 && i + 1 < argc) {
+            o->out_dir = argv[i + 1];
+            i++;
+        } else if (strncmp(a, "--out-dir=", 10) == 0) {
+            o->out_dir = a + 10;
+        } else if (strcmp(a, "--ast-cache-dir") == 0 && i + 1 < argc) {
+            o->ast_cache_dir = argv[i + 1];
+            i++;
+        } else if (strncmp(a, "--ast-cache-dir=", 16) == 0) {
+            o->ast_cache_dir = a + 16;
+        } else if (strcmp(a, "-ftime-report") == 0 || strcmp(a, "--time-report") == 0 ||
+                   strcmp(a, "--time-report=table") == 0) {
+            o->time_report = 1;
+        } else if (strcmp(a, "--time-report=json") == 0) {
+            o->time_report = 2;
+        } else if (strncmp(a, "--time-report-file=", 19) == 0) {
+            o->time_report_file = a + 19;
+        } else if (strcmp(a, "--time-report-file") == 0 && i + 1 < argc) {
+            o->time_report_file = argv[i + 1];
+            i++;
+        } else if (strncmp(a, "--trace=", 8) == 0) {
+            o->trace_path = a + 8;
+        } else if (strcmp(a, "--trace") == 0 && i + 1 < argc) {
+            o->trace_path = argv[i + 1];
+            i++;
+        } else if (strcmp(a, "--cache-dir") == 0 && i + 1 < argc) {
+            o->cache_dir = argv[i + 1];
+            i++;
+        } else if (strncmp(a, "--cache-dir=", 12) == 0) {
+            o->cache_dir = a + 12;
+        } else if (strcmp(a, "--incremental-dir") == 0 && i + 1 < argc) {
+            o->cg_opts.incremental_dir = argv[i + 1];
+            i++;
+        } else if (strncmp(a, "--incremental-dir=", 18) == 0) {
+            o->cg_opts.incremental_dir = a + 18;
+        } else if ((strcmp(a, "-I") == 0 || strcmp(a, "--include-dir") == 0) && i + 1 < argc) {
+            /* Collected by parse_include_dirs; skip the directory operand. */
+            i++;
         } else if (a[0] != '-') {
-            input = a;
+            o->input = a;
+            sl_push(&o->inputs, a);
         }
     }
-    char *src;
+}
+
+/* Compile server hook: parse the request's input and includes into the AST
+ * cache so the forked worker starts warm. */
+static int prefetch_main(int argc, char **argv) {
+    CliOptions o;
+    StrList include_dirs;
+    parse_cli(argc, argv, &o);
+    if (!o.input || o.repl_mode) return 0;
+    ast_store_set_dir(o.ast_cache_dir);
+    parse_include_dirs(argc, argv, &include_dirs);
+    prefetch_includes(o.input, &include_dirs);
+    return 0;
+}
+
+/* Temp file name unique per process and call, so parallel compiles (-j) in
+ * one process do not collide. */
+static void temp_path(char *buf, size_t n, const char *ext) {
+    static unsigned seq = 0;
+    snprintf(buf, n, "/tmp/weavec_%d_%u%s", (int)getpid(), __sync_fetch_and_add(&seq, 1u), ext);
+}
+
+static int uses_const_eval(Node *n) {
+    int i;
+    if (!n) return 0;
+    if (n->kind == N_ATOM) return is_atom(n, "const-eval");
+    for (i = 0; n->kind == N_LIST && i < n->count; i++) {
+        if (uses_const_eval(n->items[i])) return 1;
+    }
+    return 0;
+}
+
+static void key_list(const StrList *l, StrBuf *key) {
+    int i;
+    sb_append_n(key, (const char *)&l->len, sizeof(l->len));
+    for (i = 0; i < l->len; i++) sb_append_n(key, l->items[i], strlen(l->items[i]) + 1);
+}
+
+/* Result cache key for compiling the merged program TOP, appended to KEY:
+ * the program, the compiler and every option that changes the output file. */
+static void result_key(const CliOptions *o, Node *top, StrBuf *key) {
+    const char *use_asan_env = getenv("WEAVE_ASAN");
+    uint64_t compiler = hash_compiler_identity();
+    uint64_t runtime = HASH_SEED;
+    int flags[8];
+
+    sb_append_n(key, (const char *)&compiler, sizeof(compiler));
+    flags[0] = (int)o->mode;
+    flags[1] = o->optimize;
+    flags[2] = o->use_static;
+    flags[3] = o->generate_tests_mode;
+    flags[4] = o->cg_opts.inline_llvm_jit;
+    flags[5] = use_asan_env && use_asan_env[0] == '1';
+    flags[6] = o->cg_opts.nsw;
+    flags[7] = o->cg_opts.strict_aliasing;
+    sb_append_n(key, (const char *)flags, sizeof(flags));
+    key_list(&o->selected_test_names, key);
+    key_list(&o->selected_tags, key);
+    if (!o->runtime_path) {
+        sb_append_ch(key, '-');
+    } else if (hash_file(o->runtime_path, &runtime) == 0) {
+        sb_append_ch(key, 'h');
+        sb_append_n(key, (const char *)&runtime, sizeof(runtime));
+    } else {
+        sb_append_ch(key, 'p');
+        sb_append_n(key, o->runtime_path, strlen(o->runtime_path) + 1);
+    }
+    node_key(top, key);
+}
+
+/* --stats and --mem-report output for INPUT.
+ * RESULT_CACHE: 1 for a hit, 0 for a miss, -1 when the compile was not cacheable. */
+static void print_compile_stats(CliOptions *o, const char *input, int result_cache) {
+    int hits, misses;
+    flockfile(stdout);
+    if (o->inputs.len > 1) printf("\n%s:", input);
+    if (o->mem_report) mem_stats_print();
+    if (!o->print_stats) {
+        funlockfile(stdout);
+        return;
+    }
+    stats_print();
+    ast_cache_stats(&hits, &misses);
+    if (hits + misses > 0) printf("AST cache: %d hit(s), %d miss(es)\n", hits, misses);
+    ast_store_stats(&hits, &misses);
+    if (hits + misses > 0) printf("AST store: %d hit(s), %d miss(es)\n", hits, misses);
+    {
+        int uncacheable;
+        fn_cache_stats(&hits, &misses, &uncacheable);
+        if (hits + misses + uncacheable > 0) {
+            printf("Functions: %d reused, %d recompiled, %d not cacheable\n", hits, misses, uncacheable);
+        }
+    }
+    if (o->cache_dir) printf("Result cache: %s\n", result_cache > 0 ? "hit" : result_cache == 0 ? "miss" : "not cacheable");
+    funlockfile(stdout);
+}
+
+/* Writes the time report for INPUT. */
+static void print_time_report(CliOptions *o, const char *input) {
+    FILE *out = stderr;
+    if (o->time_report_file) {
+        out = fopen(o->time_report_file, "a");
+        if (!out) {
+            fprintf(stderr, "weavec: cannot write time report: %s\n", o->time_report_file);
+            return;
+        }
+    }
+    timing_report(out, input, o->time_report == 2);
+    if (out != stderr) fclose(out);
+}
+
+/* Compile one INPUT to OUTPUT according to O. Returns the exit code. */
+static int compile_one(CliOptions *o, const char *input, const char *output, StrList *include_dirs) {
     Node *top;
     StrList included;
-    StrList include_dirs;
     char *base_dir;
     StrBuf ir;
     FILE *f;
+    int use_result_cache;
+    int cache_status = -1; /* for --stats: 1 hit, 0 miss, -1 not cacheable */
+    StrBuf key;
+    MemCategory mem_prev;
+    int exit_code = 0;
 
-    if (!input) {
-        fprintf(stderr, "Usage: weavec [options] INPUT\n");
-        fprintf(stderr, "       weavec [options] -o OUTPUT INPUT\n");
-        fprintf(stderr, "Options:\n");
-        fprintf(stderr, "  -o <file>         Output file (default: a.out)\n");
-        fprintf(stderr, "  -S, -emit-llvm    Emit LLVM IR instead of executable\n");
-        fprintf(stderr, "  -c                Emit object file\n");
-        fprintf(stderr, "  -O, --optimize    Enable optimizations\n");
-        fprintf(stderr, "  --static          Produce static executable\n");
-        fprintf(stderr, "  --runtime PATH    Optional path to runtime.c (for backward compatibility, not required)\n");
-        fprintf(stderr, "  -generate-tests   Generate & run embedded tests (emit synthetic main)\n");
-        fprintf(stderr, "  -run-tests        Alias for -generate-tests\n");
-        fprintf(stderr, "  -list-tests       List embedded tests by name (one per line)\n");
-        fprintf(stderr, "  -test NAME        Select test(s) by name (repeatable)\n");
-        fprintf(stderr, "  -tag TAG          Select test(s) by tag (repeatable)\n");
-        fprintf(stderr, "  --stats           Print compiler statistics\n");
-        fprintf(stderr, "  -I<dir>           Add include directory\n");
-        fprintf(stderr, "\nEnvironment:\n");
-        fprintf(stderr, "  WEAVE_RUNTIME     Optional default path to runtime.c (for backward compatibility)\n");
-        return 2;
-    }
-    
-    /* Default output to a.out if not specified */
-    if (!output) {
-        output = "a.out";
-    }
-
-    src = read_file_all(input);
-    top = parse_top(src, input);
-    free(src);
+    sb_init(&ir);
+    timing_enable(o->time_report != 0);
+    mem_stats_enable(o->mem_report);
+    timing_push_detail("total", input);
+    timing_push("load input");
+    top = ast_cache_load(input);
+    timing_pop();
 
     sl_init(&included);
-    parse_include_dirs(argc, argv, &include_dirs);
     base_dir = compute_base_dir(input);
-    merge_includes(top, &included, base_dir, &include_dirs, input);
+    timing_push("merge includes");
+    mem_prev = mem_category_enter(MEM_AST);
+    merge_includes(top, &included, base_dir, include_dirs, input);
+    mem_category_leave(mem_prev);
+    timing_pop();
     free(base_dir);
 
-    sb_init(&ir);
-    if (list_tests_only) {
+    /* (const-eval ...) may observe the build environment: never cached. */
+    use_result_cache = o->cache_dir && !o->list_tests_only && !uses_const_eval(top);
+    if (use_result_cache) {
+        int hit;
+        timing_push("result cache");
+        sb_init(&key);
+        result_key(o, top, &key);
+        hit = result_cache_fetch(o->cache_dir, &key, output);
+        timing_pop();
+        cache_status = hit;
+        if (hit) goto done;
+    }
+
+    if (o->list_tests_only) {
         int i;
         Node *decls = top;
         for (i = 0; decls && i < decls->count; i++) list_tests_in(list_nth(decls, i));
         /* No IR generation in list mode */
     } else {
-        compile_to_llvm_ir(top, &ir, generate_tests_mode, &selected_test_names, &selected_tags);
+        timing_push("codegen");
+        mem_prev = mem_category_enter(MEM_CODEGEN);
+        compile_to_llvm_ir(top, &ir, o->generate_tests_mode, &o->selected_test_names, &o->selected_tags, &o->cg_opts);
+        mem_category_leave(mem_prev);
+        timing_pop();
     }
 
-    if (list_tests_only) {
+    if (o->list_tests_only) {
         /* Listing mode prints to stdout only */
-        return 0;
-    } else if (mode == OUTPUT_LLVM_IR) {
+        goto done;
+    } else if (o->mode == OUTPUT_LLVM_IR) {
         /* Just write the IR */
+        timing_push("write output");
         f = fopen(output, "wb");
         if (!f) {
             fprintf(stderr, "weavec: cannot write output: %s\n", output);
-            return 1;
+            timing_pop();
+            exit_code = 1;
+            goto done;
         }
         fwrite(ir.data ? ir.data : "", 1, ir.len, f);
         fclose(f);
+        timing_pop();
     } else {
 #ifdef USE_LLVM_API
         /* Compile to object or executable using LLVM directly */
-        int opt_level = optimize ? 2 : 0;
+        int opt_level = o->optimize ? 2 : 0;
         const char *use_asan_env = getenv("WEAVE_ASAN");
         int use_asan = (use_asan_env && use_asan_env[0] == '1');
         
-        if (mode == OUTPUT_OBJECT) {
+        if (o->mode == OUTPUT_OBJECT) {
             /* Compile to object file using LLVM */
             int rc;
+            timing_push("backend");
             if (use_asan) {
                 rc = llvm_compile_ir_to_object_asan(ir.data ? ir.data : "", ir.len,
                                                     output, opt_level, 1);
@@ -263,11 +471,13 @@ int main(int argc, char **argv) {
                 rc = llvm_compile_ir_to_object_internal(ir.data ? ir.data : "", ir.len,
                                                         output, opt_level);
             }
+            timing_pop();
             if (rc != 0) {
                 fprintf(stderr, "weavec: LLVM compilation failed\n");
-                return 1;
+                exit_code = 1;
+                goto done;
             }
-        } else if (mode == OUTPUT_EXECUTABLE) {
+        } else if (o->mode == OUTPUT_EXECUTABLE) {
             /* For executables, we still need to link.
              * First compile to object file, then link with system linker.
              * TODO: In future, we could use lld for full LLVM integration.
@@ -279,8 +489,9 @@ int main(int argc, char **argv) {
             /* Runtime no longer required - Weave programs define main() directly */
             
             /* Compile IR to object file using LLVM */
-            snprintf(obj_tmp, sizeof(obj_tmp), "/tmp/weavec_%d.o", getpid());
+            temp_path(obj_tmp, sizeof(obj_tmp), ".o");
             int rc;
+            timing_push("backend");
             if (use_asan) {
                 rc = llvm_compile_ir_to_object_asan(ir.data ? ir.data : "", ir.len,
                                                      obj_tmp, opt_level, 1);
@@ -288,12 +499,15 @@ int main(int argc, char **argv) {
                 rc = llvm_compile_ir_to_object_internal(ir.data ? ir.data : "", ir.len,
                                                         obj_tmp, opt_level);
             }
+            timing_pop();
             if (rc != 0) {
                 fprintf(stderr, "weavec: LLVM compilation failed\n");
-                return 1;
+                exit_code = 1;
+                goto done;
             }
             
             /* Link object file to executable using system linker */
+            timing_push("link");
             pid = fork();
             if (pid == 0) {
                 /* Child process - exec linker */
@@ -305,15 +519,15 @@ int main(int argc, char **argv) {
                     linker_args[arg_idx++] = "-fsanitize=address";
                     linker_args[arg_idx++] = "-fno-omit-frame-pointer";
                 }
-                if (use_static) {
+                if (o->use_static) {
                     linker_args[arg_idx++] = "-static";
                 }
                 linker_args[arg_idx++] = "-o";
                 linker_args[arg_idx++] = output;
                 linker_args[arg_idx++] = obj_tmp;
                 /* Runtime no longer needed - Weave programs define main() directly */
-                if (runtime_path) {
-                    linker_args[arg_idx++] = runtime_path;
+                if (o->runtime_path) {
+                    linker_args[arg_idx++] = o->runtime_path;
                 }
                 linker_args[arg_idx++] = "-lm";
                 linker_args[arg_idx] = NULL;
@@ -324,15 +538,19 @@ int main(int argc, char **argv) {
             } else if (pid > 0) {
                 /* Parent - wait for linker */
                 waitpid(pid, &status, 0);
+                timing_pop();
                 unlink(obj_tmp);  /* Clean up temp file */
                 if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
                     fprintf(stderr, "weavec: linking failed\n");
-                    return 1;
+                    exit_code = 1;
+                    goto done;
                 }
             } else {
                 fprintf(stderr, "weavec: fork failed\n");
+                timing_pop();
                 unlink(obj_tmp);
-                return 1;
+                exit_code = 1;
+                goto done;
             }
         }
 #else
@@ -344,16 +562,18 @@ int main(int argc, char **argv) {
         /* Runtime no longer required - Weave programs define main() directly */
         
         /* Write IR to temp file */
-        snprintf(ll_tmp, sizeof(ll_tmp), "/tmp/weavec_%d.ll", getpid());
+        temp_path(ll_tmp, sizeof(ll_tmp), ".ll");
         f = fopen(ll_tmp, "wb");
         if (!f) {
             fprintf(stderr, "weavec: cannot write temp file: %s\n", ll_tmp);
-            return 1;
+            exit_code = 1;
+            goto done;
         }
         fwrite(ir.data ? ir.data : "", 1, ir.len, f);
         fclose(f);
         
         /* Build clang command */
+        timing_push("backend and link (clang)");
         pid = fork();
         if (pid == 0) {
             /* Child process - exec clang */
@@ -363,7 +583,7 @@ int main(int argc, char **argv) {
             clang_args[arg_idx++] = "clang";
             const char *use_asan_env = getenv("WEAVE_ASAN");
             int use_asan = (use_asan_env && use_asan_env[0] == '1');
-            if (optimize) {
+            if (o->optimize) {
                 clang_args[arg_idx++] = "-O2";
             }
             /* Silence external runtime null-char literal warnings */
@@ -372,17 +592,17 @@ int main(int argc, char **argv) {
                 clang_args[arg_idx++] = "-fsanitize=address";
                 clang_args[arg_idx++] = "-fno-omit-frame-pointer";
             }
-            if (mode == OUTPUT_OBJECT) {
+            if (o->mode == OUTPUT_OBJECT) {
                 clang_args[arg_idx++] = "-c";
             }
-            if (use_static && mode == OUTPUT_EXECUTABLE) {
+            if (o->use_static && o->mode == OUTPUT_EXECUTABLE) {
                 clang_args[arg_idx++] = "-static";
             }
             clang_args[arg_idx++] = "-o";
             clang_args[arg_idx++] = output;
             clang_args[arg_idx++] = ll_tmp;
-            if (mode == OUTPUT_EXECUTABLE && runtime_path) {
-                clang_args[arg_idx++] = runtime_path;
+            if (o->mode == OUTPUT_EXECUTABLE && o->runtime_path) {
+                clang_args[arg_idx++] = o->runtime_path;
             }
             clang_args[arg_idx++] = "-lm";
             clang_args[arg_idx] = NULL;
@@ -393,22 +613,286 @@ int main(int argc, char **argv) {
         } else if (pid > 0) {
             /* Parent - wait for clang */
             waitpid(pid, &status, 0);
+            timing_pop();
             unlink(ll_tmp);  /* Clean up temp file */
             if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
                 fprintf(stderr, "weavec: clang failed\n");
-                return 1;
+                exit_code = 1;
+                goto done;
             }
         } else {
             fprintf(stderr, "weavec: fork failed\n");
-            return 1;
+            timing_pop();
+            unlink(ll_tmp);
+            exit_code = 1;
+            goto done;
         }
 #endif
     }
 
+    if (use_result_cache) result_cache_store(o->cache_dir, &key, output);
+
+done:
+    if (use_result_cache) free(key.data);
+    free(ir.data);
+    timing_pop(); /* total */
     /* Print statistics if requested */
-    if (print_stats) {
-        stats_print();
+    if (o->print_stats || o->mem_report) print_compile_stats(o, input, cache_status);
+    if (o->time_report) print_time_report(o, input);
+
+    return exit_code;
+}
+
+/* Batch mode: inputs are handed out to worker threads from a shared cursor.
+ * Each compile builds its own IrCtx/FnTable/TypeEnv; included files are
+ * parsed once into the shared AST cache. */
+typedef struct {
+    CliOptions *o;
+    StrList *include_dirs;
+    pthread_mutex_t lock;
+    int next;
+    int *status;
+} BatchQueue;
+
+static __thread jmp_buf batch_recover;
+
+static void batch_fatal(void) {
+    longjmp(batch_recover, 1);
+}
+
+/* DIR/<input basename without extension>, plus .ll or .o for -S / -c. */
+static char *batch_output_path(const CliOptions *o, const char *input) {
+    const char *base = strrchr(input, '/');
+    const char *ext = o->mode == OUTPUT_LLVM_IR ? ".ll" : o->mode == OUTPUT_OBJECT ? ".o" : "";
+    const char *dot;
+    size_t stem;
+    char *out;
+    base = base ? base + 1 : input;
+    dot = strrchr(base, '.');
+    stem = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+    out = (char *)xmalloc(strlen(o->out_dir) + 1 + stem + strlen(ext) + 1);
+    sprintf(out, "%s/%.*s%s", o->out_dir, (int)stem, base, ext);
+    return out;
+}
+
+static void *batch_worker(void *arg) {
+    BatchQueue *q = (BatchQueue *)arg;
+    set_fatal_handler(batch_fatal);
+    for (;;) {
+        char *output;
+        int k;
+        pthread_mutex_lock(&q->lock);
+        k = q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (k >= q->o->inputs.len) break;
+
+        output = batch_output_path(q->o, q->o->inputs.items[k]);
+        stats_reset();
+        if (setjmp(batch_recover) == 0) {
+            q->status[k] = compile_one(q->o, q->o->inputs.items[k], output, q->include_dirs);
+        } else {
+            /* The diagnostic is already printed; move on to the next input. */
+            timing_unwind();
+            q->status[k] = 1;
+        }
+        free(output);
     }
+    set_fatal_handler(NULL);
+    return NULL;
+}
 
-    return 0;
+static int compile_batch(CliOptions *o, StrList *include_dirs) {
+    BatchQueue q;
+    pthread_t *threads;
+    int nthreads = o->jobs > 0 ? o->jobs : 1;
+    int started = 0;
+    int failed = 0;
+    int i;
+
+    if (o->output && o->inputs.len > 1) {
+        fprintf(stderr, "weavec: -o cannot be used with multiple inputs; use --out-dir\n");
+        return 2;
+    }
+    if (!o->out_dir) o->out_dir = ".";
+    if (mkdir(o->out_dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "weavec: cannot create output directory %s: %s\n", o->out_dir, strerror(errno));
+        return 1;
+    }
+    if (nthreads > o->inputs.len) nthreads = o->inputs.len;
+
+    ast_cache_enable(1);
+#ifdef USE_LLVM_API
+    llvm_compile_init();
+#endif
+    q.o = o;
+    q.include_dirs = include_dirs;
+    pthread_mutex_init(&q.lock, NULL);
+    q.next = 0;
+    q.status = (int *)xmalloc((size_t)o->inputs.len * sizeof(int));
+
+    threads = (pthread_t *)xmalloc((size_t)nthreads * sizeof(pthread_t));
+    for (i = 0; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &q) != 0) break;
+        started++;
+    }
+    if (started == 0) batch_worker(&q);
+    for (i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    for (i = 0; i < o->inputs.len; i++) {
+        if (q.status[i] != 0) failed++;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "weavec: %d of %d input(s) failed\n", failed, o->inputs.len);
+    }
+    pthread_mutex_destroy(&q.lock);
+    free(threads);
+    free(q.status);
+    return failed > 0 ? 1 : 0;
+}
+
+static int compile_main(int argc, char **argv) {
+    CliOptions o;
+    StrList include_dirs;
+    int rc;
+
+    /* Initialize compiler subsystems */
+    stats_init();
+    builtins_init();
+    parse_cli(argc, argv, &o);
+    ast_store_set_dir(o.ast_cache_dir);
+    if (o.cache_dir && (!*o.cache_dir || ensure_dir(o.cache_dir, "cache directory") != 0)) {
+        o.cache_dir = NULL;
+    }
+    if (o.cg_opts.incremental_dir && (!*o.cg_opts.incremental_dir ||
+                                      ensure_dir(o.cg_opts.incremental_dir, "incremental directory") != 0)) {
+        o.cg_opts.incremental_dir = NULL;
+    }
+
+    if (o.repl_mode) {
+#ifdef USE_LLVM_API
+        parse_include_dirs(argc, argv, &include_dirs);
+        return repl_main(&include_dirs, o.optimize ? 2 : 0);
+#else
+        fprintf(stderr, "weavec: --repl requires a build with the LLVM API (USE_LLVM_API)\n");
+        return 2;
+#endif
+    }
+
+    if (!o.input) {
+        fprintf(stderr, "Usage: weavec [options] INPUT\n");
+        fprintf(stderr, "       weavec [options] -o OUTPUT INPUT\n");
+        fprintf(stderr, "       weavec [options] [-j N] --out-dir DIR INPUT...\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  -o <file>         Output file (default: a.out)\n");
+        fprintf(stderr, "  -S, -emit-llvm    Emit LLVM IR instead of executable\n");
+        fprintf(stderr, "  -c                Emit object file\n");
+        fprintf(stderr, "  -O, --optimize    Enable optimizations\n");
+        fprintf(stderr, "  --static          Produce static executable\n");
+        fprintf(stderr, "  --runtime PATH    Optional path to runtime.c (for backward compatibility, not required)\n");
+        fprintf(stderr, "  -generate-tests   Generate & run embedded tests (emit synthetic main)\n");
+        fprintf(stderr, "  -run-tests        Alias for -generate-tests\n");
+        fprintf(stderr, "  -list-tests       List embedded tests by name (one per line)\n");
+        fprintf(stderr, "  -test NAME        Select test(s) by name (repeatable)\n");
+        fprintf(stderr, "  -tag TAG          Select test(s) by tag (repeatable)\n");
+        fprintf(stderr, "  --stats           Print compiler statistics\n");
+        fprintf(stderr, "  --mem-report      Print bytes allocated per subsystem and peak RSS\n");
+        fprintf(stderr, "  --repl            Interactive read-eval-print loop (JIT; needs LLVM API)\n");
+        fprintf(stderr, "  --inline-llvm-jit Link llvm-jit IR into the program at compile time (needs LLVM API)\n");
+        fprintf(stderr, "  --nsw             Treat signed Int32 overflow in + - * as undefined (emit nsw)\n");
+        fprintf(stderr, "  -fstrict-aliasing Emit struct-path TBAA: different scalar types and struct fields never alias\n");
+        fprintf(stderr, "  -I<dir>           Add include directory\n");
+        fprintf(stderr, "  --out-dir DIR     Compile every INPUT to DIR/<name>[.ll|.o] (implied by several inputs)\n");
+        fprintf(stderr, "  -j N              Compile up to N inputs in parallel (with --out-dir)\n");
+        fprintf(stderr, "  --ast-cache-dir DIR  Keep parsed files in DIR and reuse them while unchanged\n");
+        fprintf(stderr, "  -ftime-report     Print wall/CPU time per compiler phase (to stderr)\n");
+        fprintf(stderr, "  --time-report=json  Same, as one JSON object per compiled input\n");
+        fprintf(stderr, "  --time-report-file FILE  Append time reports to FILE instead of stderr\n");
+        fprintf(stderr, "  --trace=FILE      Write a Chrome/Perfetto trace of phases, files and functions to FILE\n");
+        fprintf(stderr, "  --cache-dir DIR   Reuse finished outputs of identical compiles (same sources, flags, compiler)\n");
+        fprintf(stderr, "  --incremental-dir DIR  Keep per-function IR in DIR and regenerate only changed functions\n");
+        fprintf(stderr, "  --server SOCKET   Serve compile requests on a Unix socket, keeping includes parsed\n");
+        fprintf(stderr, "  --connect SOCKET  Compile through a --server (falls back to compiling locally)\n");
+        fprintf(stderr, "\nEnvironment:\n");
+        fprintf(stderr, "  WEAVE_RUNTIME     Optional default path to runtime.c (for backward compatibility)\n");
+        fprintf(stderr, "  WEAVEC0_SERVER    Socket to use as if --connect SOCKET were given\n");
+        fprintf(stderr, "  WEAVEC0_AST_CACHE_DIR  Default for --ast-cache-dir\n");
+        fprintf(stderr, "  WEAVEC0_INCREMENTAL_DIR  Default for --incremental-dir\n");
+        fprintf(stderr, "  WEAVEC0_CACHE_DIR  Default for --cache-dir\n");
+        return 2;
+    }
+    
+    if (o.trace_path && timing_trace_open(o.trace_path) != 0) {
+        fprintf(stderr, "weavec: cannot write trace: %s\n", o.trace_path);
+        return 1;
+    }
+
+    parse_include_dirs(argc, argv, &include_dirs);
+    if (o.inputs.len > 1 || o.out_dir) {
+        rc = compile_batch(&o, &include_dirs);
+    } else {
+        /* Default output to a.out if not specified */
+        if (!o.output) {
+            o.output = "a.out";
+        }
+        rc = compile_one(&o, o.input, o.output, &include_dirs);
+    }
+    timing_trace_close();
+    return rc;
+}
+
+/* Value of "--NAME SOCKET" or "--NAME=SOCKET"; *skip is how many argv
+ * entries it spans (0 when absent). */
+static const char *socket_arg(int argc, char **argv, const char *name, int *at, int *skip) {
+    size_t nlen = strlen(name);
+    int i;
+    *skip = 0;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0 && i + 1 < argc) {
+            *at = i;
+            *skip = 2;
+            return argv[i + 1];
+        }
+        if (strncmp(argv[i], name, nlen) == 0 && argv[i][nlen] == '=') {
+            *at = i;
+            *skip = 1;
+            return argv[i] + nlen + 1;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *sock;
+    int at = 0, skip = 0;
+    int i;
+
+    sock = socket_arg(argc, argv, "--server", &at, &skip);
+    if (sock) {
+#ifdef USE_LLVM_API
+        llvm_compile_init();
+#endif
+        return server_main(sock, compile_main, prefetch_main);
+    }
+
+    sock = socket_arg(argc, argv, "--connect", &at, &skip);
+    if (!sock) sock = getenv("WEAVEC0_SERVER");
+    for (i = 1; sock && i < argc; i++) {
+        /* The REPL needs our stdin, which is not forwarded. */
+        if (strcmp(argv[i], "--repl") == 0) sock = NULL;
+    }
+    if (sock && *sock) {
+        /* Forward our argv minus the --connect option itself. */
+        char **fwd = (char **)xmalloc((size_t)(argc + 1) * sizeof(char *));
+        int n = 0, rc;
+        for (i = 0; i < argc; i++) {
+            if (skip && i >= at && i < at + skip) continue;
+            fwd[n++] = argv[i];
+        }
+        fwd[n] = NULL;
+        rc = server_client_run(sock, n, fwd);
+        if (rc >= 0) return rc;
+        argc = n;
+        argv = fwd;
+    }
+    return compile_main(argc, argv);
 }
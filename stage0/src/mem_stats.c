@@ -0,0 +1,83 @@
+#include "mem_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+typedef struct {
+    size_t bytes;
+    size_t count;
+} MemCounter;
+
+__thread int mem_stats_active = 0;
+static __thread MemCategory current_category = MEM_OTHER;
+static __thread MemCounter counters[MEM_CATEGORY_COUNT];
+
+static const char *const category_names[MEM_CATEGORY_COUNT] = {
+    "Other", "Lexer", "AST", "Types", "Env", "Codegen", "IR buffers", "LLVM (RSS growth)",
+};
+
+void mem_stats_enable(int on) {
+    mem_stats_active = on;
+    current_category = MEM_OTHER;
+    memset(counters, 0, sizeof(counters));
+}
+
+MemCategory mem_category_enter(MemCategory c) {
+    MemCategory prev = current_category;
+    current_category = c;
+    return prev;
+}
+
+void mem_category_leave(MemCategory prev) {
+    current_category = prev;
+}
+
+void mem_stats_note(size_t bytes, int strbuf) {
+    MemCategory c = current_category;
+    if (strbuf && c == MEM_CODEGEN) c = MEM_IR;
+    counters[c].bytes += bytes;
+    counters[c].count++;
+}
+
+void mem_stats_note_in(MemCategory c, size_t bytes) {
+    if (!mem_stats_active) return;
+    counters[c].bytes += bytes;
+    counters[c].count++;
+}
+
+size_t mem_current_rss(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    if (!f) return 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(f);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void print_kib(const char *label, size_t bytes, size_t count) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s:", label);
+    printf("  %-20s %10.1f KiB  %9lu\n", name, (double)bytes / 1024.0, (unsigned long)count);
+}
+
+void mem_stats_print(void) {
+    struct rusage ru;
+    size_t total_bytes = 0, total_count = 0;
+    int i;
+
+    printf("\n=== Memory ===\n\n");
+    printf("  %-20s %14s  %9s\n", "Category", "Allocated", "Count");
+    for (i = 0; i < MEM_LLVM; i++) {
+        print_kib(category_names[i], counters[i].bytes, counters[i].count);
+        total_bytes += counters[i].bytes;
+        total_count += counters[i].count;
+    }
+    print_kib("Total (xmalloc)", total_bytes, total_count);
+    /* Not part of the total: measured as resident growth, not allocations. */
+    print_kib(category_names[MEM_LLVM], counters[MEM_LLVM].bytes, counters[MEM_LLVM].count);
+    /* ru_maxrss is in KiB on Linux. */
+    if (getrusage(RUSAGE_SELF, &ru) == 0) printf("\nPeak RSS:              %10.1f MiB\n", (double)ru.ru_maxrss / 1024.0);
+    printf("\n");
+}
@@ -1,16 +1,357 @@
 #include "codegen.h"
 
 #include "diagnostics.h"
+#include "fn_cache.h"
 #include "fn_table.h"
+#include "hash.h"
+#include "stats.h"
+#include "tbaa.h"
+#include "timing.h"
 #include "type_env.h"
+#ifdef USE_LLVM_API
+#include "llvm_compile.h"
+#endif
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *ret_type, Node *params_form) {
+/* Names that N sets or takes the address of. Their lets and params need an
+ * alloca; every other binding is used directly as an SSA value. */
+static void collect_in_memory(Node *n, StrList *out) {
+    Node *h;
+    Node *target = NULL;
     int i;
+    if (!n || n->kind != N_LIST) return;
+    h = list_nth(n, 0);
+    if (is_atom(h, "set") || is_atom(h, "addr")) target = list_nth(n, 1);
+    else if (is_atom(h, "addr-of")) target = list_nth(n, 2);
+    if (target && target->kind == N_ATOM && !sl_contains(out, target->text)) sl_push(out, target->text);
+    for (i = 0; i < n->count; i++) collect_in_memory(n->items[i], out);
+}
+
+/* Lets in N, with names bound more than once in REBOUND and those
+ * initialised by (make ...) in MAKES. */
+static void collect_make_lets(Node *n, StrList *lets, StrList *rebound, StrList *makes) {
+    Node *init;
+    int i;
+    if (!n || n->kind != N_LIST) return;
+    if (is_atom(list_nth(n, 0), "let") && list_nth(n, 1) && list_nth(n, 1)->kind == N_ATOM) {
+        const char *name = list_nth(n, 1)->text;
+        if (sl_contains(lets, name)) {
+            if (!sl_contains(rebound, name)) sl_push(rebound, name);
+        } else {
+            sl_push(lets, name);
+        }
+        init = list_nth(n, 3);
+        if (init && init->kind == N_LIST && is_atom(list_nth(init, 0), "make") && !sl_contains(makes, name)) {
+            sl_push(makes, name);
+        }
+    }
+    for (i = 0; i < n->count; i++) collect_make_lets(n->items[i], lets, rebound, makes);
+}
+
+/* Names in MAKES used anywhere in N other than as the struct operand of
+ * get-field/set-field: passed, returned, stored, compared, ... */
+static void collect_escapes(Node *n, StrList *makes, StrList *escaped) {
+    Node *h;
+    int i;
+    if (!n) return;
+    if (n->kind == N_ATOM) {
+        if (sl_contains(makes, n->text) && !sl_contains(escaped, n->text)) sl_push(escaped, n->text);
+        return;
+    }
+    if (n->kind != N_LIST) return;
+    h = list_nth(n, 0);
+    if (is_atom(h, "let")) {
+        for (i = 3; i < n->count; i++) collect_escapes(n->items[i], makes, escaped);
+    } else if (is_atom(h, "get-field") || is_atom(h, "set-field")) {
+        if (list_nth(n, 1) && list_nth(n, 1)->kind != N_ATOM) collect_escapes(n->items[1], makes, escaped);
+        for (i = 3; i < n->count; i++) collect_escapes(n->items[i], makes, escaped);
+    } else if (is_atom(h, "make") || is_atom(h, "make-in")) {
+        int first = is_atom(h, "make") ? 2 : 3;
+        if (first == 3) collect_escapes(list_nth(n, 1), makes, escaped);
+        for (i = first; i < n->count; i++) collect_escapes(list_nth(n->items[i], 1), makes, escaped);
+    } else {
+        for (i = 1; i < n->count; i++) collect_escapes(n->items[i], makes, escaped);
+    }
+}
+
+/* Escape check for the function body BODY: lets bound once to a (make ...)
+ * whose pointer is only ever dereferenced by get-field/set-field. Their
+ * structs can live in the frame instead of the heap. */
+static void collect_stack_makes(Node *body, const StrList *in_memory, StrList *out) {
+    StrList lets, rebound, makes, escaped;
+    int i;
+    sl_init(&lets);
+    sl_init(&rebound);
+    sl_init(&makes);
+    sl_init(&escaped);
+    collect_make_lets(body, &lets, &rebound, &makes);
+    collect_escapes(body, &makes, &escaped);
+    for (i = 0; i < makes.len; i++) {
+        const char *name = makes.items[i];
+        if (sl_contains(&rebound, name) || sl_contains(&escaped, name)) continue;
+        if (sl_contains((StrList *)in_memory, name)) continue;
+        sl_push(out, name);
+    }
+}
+
+/* Inserts the hoisted allocas in ALLOCAS at offset AT of OUT (fn_entry). */
+static void splice_entry_allocas(StrBuf *out, size_t at, StrBuf *allocas) {
+    if (allocas->len == 0) return;
+    sb_reserve(out, out->len + allocas->len + 1);
+    memmove(out->data + at + allocas->len, out->data + at, out->len - at + 1);
+    memcpy(out->data + at, allocas->data, allocas->len);
+    out->len += allocas->len;
+}
+
+/* ---- function attributes ----
+ * Facts LLVM cannot see through our IR: Weave has no unwinding, loop- and
+ * call-free bodies always return, functions that only return fresh makes
+ * return unaliased memory, and a struct pointer parameter dereferenced
+ * before any branch or call can be neither null nor short. */
+
+static int is_call_form(IrCtx *ir, Node *h) {
+    const char *name = atom_text(h);
+    if (!name) return 0;
+    if (strcmp(name, "ccall") == 0 || strncmp(name, "llvm-jit", 8) == 0) return 1;
+    return ir->fn_table && fn_table_find((FnTable *)ir->fn_table, name) >= 0;
+}
+
+/* No loops and no calls, so nothing can keep N from finishing. */
+static int always_returns(IrCtx *ir, Node *n) {
+    Node *h;
+    int i;
+    if (!n || n->kind != N_LIST) return 1;
+    h = list_nth(n, 0);
+    if (is_atom(h, "while") || is_atom(h, "for") || is_call_form(ir, h)) return 0;
+    for (i = 0; i < n->count; i++) {
+        if (!always_returns(ir, n->items[i])) return 0;
+    }
+    return 1;
+}
+
+static int returns_only_makes(Node *n) {
+    int i;
+    if (!n || n->kind != N_LIST) return 1;
+    if (is_atom(list_nth(n, 0), "return")) {
+        Node *v = list_nth(n, 1);
+        if (!v || v->kind != N_LIST || !is_atom(list_nth(v, 0), "make")) return 0;
+    }
+    for (i = 0; i < n->count; i++) {
+        if (!returns_only_makes(n->items[i])) return 0;
+    }
+    return 1;
+}
+
+/* Every return of BODY is a (make ...) and there is no implicit one. */
+static int returns_fresh_memory(Node *body) {
+    Node *last;
+    if (!body || body->kind != N_LIST || body->count < 2) return 0;
+    last = list_nth(body, body->count - 1);
+    while (last && is_atom(list_nth(last, 0), "do") && last->count > 1) last = list_nth(last, last->count - 1);
+    if (!last || !is_atom(list_nth(last, 0), "return")) return 0;
+    return returns_only_makes(body);
+}
+
+static int let_binds(Node *n, const char *name) {
+    int i;
+    if (!n || n->kind != N_LIST) return 0;
+    if (is_atom(list_nth(n, 0), "let") && is_atom(list_nth(n, 1), name)) return 1;
+    for (i = 0; i < n->count; i++) {
+        if (let_binds(n->items[i], name)) return 1;
+    }
+    return 0;
+}
+
+/* Scans N in evaluation order for get-field/set-field through PNAME that
+ * always execute, raising *BYTES (-1 = none seen) to the furthest field
+ * end. Returns 0 once control may leave the straight line: a branch, loop,
+ * return or call (which might not return). */
+static int scan_entry_derefs(IrCtx *ir, Node *n, const char *pname, StructDef *sd, int *bytes) {
+    Node *h;
+    int i;
+    if (!n || n->kind != N_LIST) return 1;
+    h = list_nth(n, 0);
+    if (is_atom(h, "get-field") || is_atom(h, "set-field")) {
+        Node *base = list_nth(n, 1);
+        /* The base, then a set-field's value, run before the access. */
+        if (!is_atom(base, pname) && !scan_entry_derefs(ir, base, pname, sd, bytes)) return 0;
+        for (i = 3; i < n->count; i++) {
+            if (!scan_entry_derefs(ir, n->items[i], pname, sd, bytes)) return 0;
+        }
+        if (is_atom(base, pname)) {
+            int size = 0;
+            int off = struct_field_offset(sd, struct_field_index(sd, atom_text(list_nth(n, 2))), &size);
+            if (*bytes < 0) *bytes = 0;
+            if (off >= 0 && off + size > *bytes) *bytes = off + size;
+        }
+        return 1;
+    }
+    if (is_atom(h, "&&") || is_atom(h, "||")) {
+        /* The right operand may be skipped: its accesses do not count, and
+         * one that might not return ends the straight line. */
+        if (!scan_entry_derefs(ir, list_nth(n, 1), pname, sd, bytes)) return 0;
+        return always_returns(ir, list_nth(n, 2));
+    }
+    if (is_atom(h, "if-stmt") || is_atom(h, "while") || is_atom(h, "return")) {
+        scan_entry_derefs(ir, list_nth(n, 1), pname, sd, bytes);
+        return 0;
+    }
+    if (is_atom(h, "for")) return 0;
+    for (i = 1; i < n->count; i++) {
+        if (!scan_entry_derefs(ir, n->items[i], pname, sd, bytes)) return 0;
+    }
+    return !is_call_form(ir, h);
+}
+
+/* Dereferenceable bytes of parameter PNAME of type PT, 0 when it is only
+ * known non-null, -1 when nothing is known. */
+static int param_deref_bytes(IrCtx *ir, VarEnv *env, Node *body, const char *pname, TypeRef *pt) {
+    StructDef *sd;
+    int bytes = -1;
+    int i;
+    if (!env || !body || env_kind(env, pname) != 2) return -1;
+    if (!pt || pt->kind != TY_PTR || !pt->pointee || pt->pointee->kind != TY_STRUCT) return -1;
+    sd = type_env_find_struct((TypeEnv *)ir->type_env, pt->pointee->name);
+    if (!sd || let_binds(body, pname)) return -1;
+    for (i = 1; i < body->count; i++) {
+        if (!scan_entry_derefs(ir, body->items[i], pname, sd, &bytes)) break;
+    }
+    return bytes;
+}
+
+/* ---- (attrs ...) ----
+ * Hints the author gives on a fn form, after its name and next to its doc:
+ * (attrs inline noinline hot cold pure). pure promises the function has no
+ * side effects; it becomes readnone, or readonly when the body reads
+ * memory or calls out. */
+
+enum {
+    FN_ATTR_INLINE = 1,
+    FN_ATTR_NOINLINE = 2,
+    FN_ATTR_HOT = 4,
+    FN_ATTR_COLD = 8,
+    FN_ATTR_PURE = 16
+};
+
+/* Index of the first item at or after IDX that is not a (doc ...) or
+ * (attrs ...) clause; either may come first. */
+static int skip_fn_clauses(Node *form, int idx) {
+    while (idx < form->count) {
+        Node *c = list_nth(form, idx);
+        if (!c || c->kind != N_LIST) break;
+        if (!is_atom(list_nth(c, 0), "doc") && !is_atom(list_nth(c, 0), "attrs")) break;
+        idx++;
+    }
+    return idx;
+}
+
+static void attrs_error(Node *at, const char *msg, const char *hint) {
+    diag_fatal(at && at->filename ? at->filename : NULL, at ? at->line : 0, at ? at->col : 0, "invalid-attrs", msg,
+               hint);
+}
+
+/* FN_ATTR_* bits from the (attrs ...) clause among the items of FORM from
+ * IDX up to UNTIL. */
+static int parse_fn_attrs(Node *form, int idx, int until, const char *name) {
+    int bits = 0;
+    int i;
+    for (; idx < until; idx++) {
+        Node *c = list_nth(form, idx);
+        if (!is_atom(list_nth(c, 0), "attrs")) continue;
+        for (i = 1; i < c->count; i++) {
+            Node *a = list_nth(c, i);
+            int bit = 0;
+            if (is_atom(a, "inline")) bit = FN_ATTR_INLINE;
+            else if (is_atom(a, "noinline")) bit = FN_ATTR_NOINLINE;
+            else if (is_atom(a, "hot")) bit = FN_ATTR_HOT;
+            else if (is_atom(a, "cold")) bit = FN_ATTR_COLD;
+            else if (is_atom(a, "pure")) bit = FN_ATTR_PURE;
+            if (!bit) {
+                char msg[256];
+                snprintf(msg, sizeof(msg), "unknown attribute '%s' on function '%s'",
+                         a && a->text ? a->text : "<list>", name ? name : "<unknown>");
+                attrs_error(a ? a : c, msg, "Known attributes: inline noinline hot cold pure.");
+            }
+            bits |= bit;
+        }
+        if ((bits & FN_ATTR_INLINE) && (bits & FN_ATTR_NOINLINE)) {
+            attrs_error(c, "function cannot be both inline and noinline", NULL);
+        }
+        if ((bits & FN_ATTR_HOT) && (bits & FN_ATTR_COLD)) {
+            attrs_error(c, "function cannot be both hot and cold", NULL);
+        }
+    }
+    return bits;
+}
+
+/* First form in N that writes memory the caller can see, or NULL. A call
+ * counts unless its callee is itself declared pure. */
+static Node *find_memory_write(IrCtx *ir, Node *n) {
+    Node *h;
+    const char *name;
+    Node *w;
+    int i;
+    if (!n || n->kind != N_LIST) return NULL;
+    h = list_nth(n, 0);
+    name = atom_text(h);
+    if (name && (strcmp(name, "store") == 0 || strcmp(name, "set-field") == 0 || strcmp(name, "vec-store") == 0 ||
+                 strcmp(name, "make") == 0 || strcmp(name, "make-in") == 0)) {
+        return n;
+    }
+    if (is_call_form(ir, h) && !fn_table_is_pure((FnTable *)ir->fn_table, name)) return n;
+    for (i = 0; i < n->count; i++) {
+        if ((w = find_memory_write(ir, n->items[i])) != NULL) return w;
+    }
+    return NULL;
+}
+
+/* N loads through a pointer or calls a function (which may). */
+static int reads_memory(IrCtx *ir, Node *n) {
+    Node *h;
+    int i;
+    if (!n || n->kind != N_LIST) return 0;
+    h = list_nth(n, 0);
+    if (is_atom(h, "load") || is_atom(h, "get-field") || is_atom(h, "vec-load") || is_call_form(ir, h)) return 1;
+    for (i = 0; i < n->count; i++) {
+        if (reads_memory(ir, n->items[i])) return 1;
+    }
+    return 0;
+}
+
+static void emit_fn_attrs(IrCtx *ir, int attrs, Node *body_form, const char *name) {
+    if (attrs & FN_ATTR_INLINE) sb_append(ir->out, " alwaysinline");
+    if (attrs & FN_ATTR_NOINLINE) sb_append(ir->out, " noinline");
+    if (attrs & FN_ATTR_HOT) sb_append(ir->out, " hot");
+    if (attrs & FN_ATTR_COLD) sb_append(ir->out, " cold");
+    if (attrs & FN_ATTR_PURE) {
+        Node *w = find_memory_write(ir, body_form);
+        if (w && is_call_form(ir, list_nth(w, 0))) {
+            Node *callee = list_nth(w, is_atom(list_nth(w, 0), "ccall") ? 1 : 0);
+            char msg[256];
+            snprintf(msg, sizeof(msg), "pure function '%s' calls '%s', which is not pure", name ? name : "<unknown>",
+                     atom_text(callee));
+            attrs_error(w, msg, "Mark the callee (attrs pure) if it writes no memory, or drop pure from the caller.");
+        } else if (w) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "pure function '%s' writes memory with (%s ...)", name ? name : "<unknown>",
+                     atom_text(list_nth(w, 0)));
+            attrs_error(w, msg, "Drop pure from the (attrs ...) clause, or move the write to the caller.");
+        }
+        sb_append(ir->out, reads_memory(ir, body_form) ? " readonly" : " readnone");
+    }
+}
+
+static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *ret_type, Node *params_form,
+                           Node *body_form, int attrs) {
+    int i;
+    if (body_form && !(body_form->kind == N_LIST && is_atom(list_nth(body_form, 0), "body"))) body_form = NULL;
     sb_append(ir->out, "define ");
+    if (body_form && ret_type && ret_type->kind == TY_PTR && returns_fresh_memory(body_form)) {
+        sb_append(ir->out, "noalias ");
+    }
     emit_llvm_type(ir->out, ret_type);
     sb_append(ir->out, " @");
     sb_append(ir->out, name);
@@ -32,14 +373,27 @@ static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *re
             ssa_name = env ? env_ssa_name(env, pname) : pname;
             if (i != 1) sb_append(ir->out, ", ");
             emit_llvm_type(ir->out, pt);
-            /* Use a temporary name for the raw SSA parameter value */
-            sb_append(ir->out, " %p_");
+            {
+                int bytes = param_deref_bytes(ir, env, body_form, pname, pt);
+                if (bytes >= 0) sb_append(ir->out, " nonnull");
+                if (bytes > 0) {
+                    sb_append(ir->out, " dereferenceable(");
+                    sb_printf_i32(ir->out, bytes);
+                    sb_append(ir->out, ")");
+                }
+            }
+            /* Use a temporary name for the raw SSA parameter value; a
+             * by-value param is already bound to that name. */
+            sb_append(ir->out, env && env_kind(env, pname) == 2 ? " %" : " %p_");
             sb_append(ir->out, ssa_name ? ssa_name : pname);
         }
     }
-    sb_append(ir->out, ") {\n");
+    sb_append(ir->out, ") nounwind");
+    if (body_form && always_returns(ir, body_form)) sb_append(ir->out, " willreturn");
+    emit_fn_attrs(ir, attrs, body_form, name);
+    sb_append(ir->out, " {\n");
     sb_append(ir->out, "fn_entry:\n");
-    /* Emit allocas for all parameters so they can be mutated with set */
+    /* Emit allocas for parameters that are set or address-taken */
     if (params_form && params_form->kind == N_LIST && is_atom(list_nth(params_form, 0), "params")) {
         for (i = 1; i < params_form->count; i++) {
             Node *p = list_nth(params_form, i);
@@ -54,6 +408,7 @@ static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *re
                 pt = parse_type_node((TypeEnv *)ir->type_env, list_nth(p, 1));
             }
             if (!pname || !*pname) continue;
+            if (env && env_kind(env, pname) == 2) continue;
             ssa_name = env ? env_ssa_name(env, pname) : pname;
             /* Emit alloca for the parameter */
             sb_append(ir->out, "  %");
@@ -70,6 +425,7 @@ static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *re
             emit_llvm_type(ir->out, pt);
             sb_append(ir->out, "* %");
             sb_append(ir->out, ssa_name ? ssa_name : pname);
+            tbaa_emit_access(ir, ir->out, pt);
             sb_append(ir->out, "\n");
         }
     }
@@ -78,12 +434,35 @@ static void emit_fn_header(IrCtx *ir, VarEnv *env, const char *name, TypeRef *re
 static void emit_value_only(StrBuf *out, Value v) {
     if (v.kind == 0) sb_printf_i32(out, v.const_i32);
     else if (v.kind == 1) ir_emit_temp(out, v.temp);
+    else if (v.kind == 3) emit_const_literal(out, v);
     else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
     }
 }
 
+/* Expected value of expect-eq/expect-ne: literals take the type of an Int64
+ * or float actual value. */
+static Value expect_operand(IrCtx *ir, Value v, TypeRef *actual_ty, Node *at) {
+    if (actual_ty && (actual_ty->kind == TY_I64 || type_is_float(actual_ty))) {
+        return ensure_type_ctx_at(ir, v, actual_ty, "expect", at);
+    }
+    return v;
+}
+
+/* V as a printf vararg: Float32 is promoted to double, as in C. */
+static Value vararg_value(IrCtx *ir, Value v) {
+    int t;
+    if (!v.type || v.type->kind != TY_F32) return v;
+    t = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, t);
+    sb_append(ir->out, " = fpext float ");
+    emit_value_only(ir->out, v);
+    sb_append(ir->out, " to double\n");
+    return value_temp(type_f64(), t);
+}
+
 static void emit_default_return(IrCtx *ir, TypeRef *ret_type) {
     sb_append(ir->out, "  ret ");
     if (ret_type && ret_type->kind == TY_VOID) {
@@ -103,13 +482,11 @@ static void emit_default_return(IrCtx *ir, TypeRef *ret_type) {
 
 /* Minimal helper: emit a C string global and return a temp holding i8* to it. */
 static int emit_c_string_ptr(IrCtx *ir, const char *s) {
-    static int str_id = 0;
-    int id = str_id++;
+    int id = ir->strings++;
     int n = (int)strlen(s) + 1;
     int t = ir_fresh_temp(ir);
     /* Global */
-    sb_append(&ir->globals, "@.tstr");
-    sb_printf_i32(&ir->globals, id);
+    ir_emit_string_name(&ir->globals, ir, "@.tstr", id);
     sb_append(&ir->globals, " = private constant [");
     sb_printf_i32(&ir->globals, n);
     sb_append(&ir->globals, " x i8] c\"");
@@ -141,8 +518,8 @@ static int emit_c_string_ptr(IrCtx *ir, const char *s) {
     sb_printf_i32(ir->out, n);
     sb_append(ir->out, " x i8], [");
     sb_printf_i32(ir->out, n);
-    sb_append(ir->out, " x i8]* @.tstr");
-    sb_printf_i32(ir->out, id);
+    sb_append(ir->out, " x i8]* ");
+    ir_emit_string_name(ir->out, ir, "@.tstr", id);
     sb_append(ir->out, ", i32 0, i32 0\n");
     return t;
 }
@@ -150,18 +527,20 @@ static int emit_c_string_ptr(IrCtx *ir, const char *s) {
 static void compile_fn_form(IrCtx *ir, Node *fn_form, const char *override_name) {
     int idx = 1;
     Node *name_node = list_nth(fn_form, idx++);
-    Node *maybe_doc = list_nth(fn_form, idx);
     Node *fh = list_nth(fn_form, 0);
     int is_entry = (fh && fh->kind == N_ATOM && is_atom(fh, "entry"));
-    if (maybe_doc && maybe_doc->kind == N_LIST && is_atom(list_nth(maybe_doc, 0), "doc")) {
-        idx++;
-    }
+    idx = skip_fn_clauses(fn_form, idx);
+    int attrs = parse_fn_attrs(fn_form, 2, idx, atom_text(name_node));
     Node *params_form = list_nth(fn_form, idx++);
     Node *returns_form = list_nth(fn_form, idx++);
     Node *body_form = list_nth(fn_form, idx++);
     const char *name = override_name ? override_name : atom_text(name_node);
     TypeRef *ret_type = type_i32();
     VarEnv env;
+    StrList in_memory;
+    StrList stack_makes;
+    StrBuf entry_allocas;
+    size_t entry_at;
     Node *stmt;
     Value last_expr = {0};
     int has_last = 0;
@@ -169,7 +548,7 @@ static void compile_fn_form(IrCtx *ir, Node *fn_form, const char *override_name)
     int i;
 
     /* Check for required (tests ...) section - only for regular functions, not entry points */
-    if (!is_entry) {
+    if (!is_entry && !ir->allow_untested) {
         for (i = idx; i < fn_form->count; i++) {
             Node *extra = list_nth(fn_form, i);
             Node *eh = list_nth(extra, 0);
@@ -208,6 +587,12 @@ static void compile_fn_form(IrCtx *ir, Node *fn_form, const char *override_name)
     }
 
     env_init(&env);
+    sl_init(&in_memory);
+    collect_in_memory(body_form, &in_memory);
+    env.in_memory = &in_memory;
+    sl_init(&stack_makes);
+    collect_stack_makes(body_form, &in_memory, &stack_makes);
+    env.stack_makes = &stack_makes;
     /* Register parameters as SSA values. */
     if (params_form && params_form->kind == N_LIST && is_atom(list_nth(params_form, 0), "params")) {
         int i;
@@ -247,11 +632,23 @@ static void compile_fn_form(IrCtx *ir, Node *fn_form, const char *override_name)
                 }
             }
             env_add_param(&env, pname, pt);
+            if (!env_needs_memory(&env, pname)) {
+                StrBuf raw;
+                sb_init(&raw);
+                sb_append(&raw, "p_");
+                sb_append(&raw, env_ssa_name(&env, pname));
+                env_bind_value(&env, pname, raw.data);
+                free(raw.data);
+                STAT_INC(ssa_bindings);
+            }
         }
     }
 
     ir->current_fn = name;
-    emit_fn_header(ir, &env, name, ret_type, params_form);
+    emit_fn_header(ir, &env, name, ret_type, params_form, body_form, attrs);
+    entry_at = ir->out->len;
+    sb_init(&entry_allocas);
+    ir->entry_allocas = &entry_allocas;
 
     if (body_form && body_form->kind == N_LIST && is_atom(list_nth(body_form, 0), "body")) {
         int bi;
@@ -299,6 +696,9 @@ static void compile_fn_form(IrCtx *ir, Node *fn_form, const char *override_name)
         }
     }
     sb_append(ir->out, "}\n");
+    ir->entry_allocas = NULL;
+    splice_entry_allocas(ir->out, entry_at, &entry_allocas);
+    free(entry_allocas.data);
 }
 
 static void collect_signature_form(TypeEnv *tenv, FnTable *fns, Node *form) {
@@ -311,6 +711,7 @@ static void collect_signature_form(TypeEnv *tenv, FnTable *fns, Node *form) {
     int ri;
     TypeRef *ret_type = type_i32();
     int idx = 1;
+    int pure = 0;
 
     if (!form || form->kind != N_LIST || !h || h->kind != N_ATOM) return;
 
@@ -324,20 +725,14 @@ static void collect_signature_form(TypeEnv *tenv, FnTable *fns, Node *form) {
         }
         return;
     }
-    if (form->count > idx && list_nth(form, idx) && list_nth(form, idx)->kind == N_LIST &&
-        is_atom(list_nth(list_nth(form, idx), 0), "doc")) {
-        idx++;
-    }
+    idx = skip_fn_clauses(form, idx);
+    pure = (parse_fn_attrs(form, 2, idx, name) & FN_ATTR_PURE) != 0;
     params_form = list_nth(form, idx++);
     returns_form = list_nth(form, idx++);
     } else if (is_atom(h, "entry")) {
         int entry_idx = 2;
         name = "main";  // Emit as 'main' so C runtime can call it directly
-        if (form->count > entry_idx && list_nth(form, entry_idx) &&
-            list_nth(form, entry_idx)->kind == N_LIST &&
-            is_atom(list_nth(list_nth(form, entry_idx), 0), "doc")) {
-            entry_idx++;
-        }
+        entry_idx = skip_fn_clauses(form, entry_idx);
         params_form = list_nth(form, entry_idx++);
         returns_form = list_nth(form, entry_idx++);
     } else {
@@ -377,6 +772,7 @@ static void collect_signature_form(TypeEnv *tenv, FnTable *fns, Node *form) {
 
     if (name && *name) {
         fn_table_add(fns, name, ret_type, param_count, param_types ? param_types : NULL);
+        if (pure) fn_table_set_pure(fns, name);
     }
     if (param_types) free(param_types);
 }
@@ -445,13 +841,8 @@ static void collect_types_in(TypeEnv *tenv, Node *form) {
     collect_type_form(tenv, form);
 }
 
-static void collect_types(TypeEnv *tenv, IrCtx *ir, Node *decls) {
+static void emit_struct_typedefs(TypeEnv *tenv, IrCtx *ir) {
     int i;
-    for (i = 0; decls && i < decls->count; i++) {
-        collect_types_in(tenv, list_nth(decls, i));
-    }
-
-    /* Emit LLVM struct type defs. */
     for (i = 0; i < tenv->struct_count; i++) {
         StructDef *s = &tenv->structs[i];
         int fi;
@@ -466,17 +857,186 @@ static void collect_types(TypeEnv *tenv, IrCtx *ir, Node *decls) {
     }
 }
 
+static void collect_types(TypeEnv *tenv, IrCtx *ir, Node *decls) {
+    int i;
+    for (i = 0; decls && i < decls->count; i++) {
+        collect_types_in(tenv, list_nth(decls, i));
+    }
+
+    /* Emit LLVM struct type defs. */
+    emit_struct_typedefs(tenv, ir);
+}
+
+/* ---- incremental compilation (--incremental-dir) ----
+ * A function's IR is a pure function of its form, the definitions of the
+ * functions and types it names (transitively through their signatures and
+ * fields), and the codegen switches. The cache key hashes exactly that, so
+ * a cached function is pasted in verbatim and edits elsewhere in the
+ * program leave it alone. */
+
+/* Bumped whenever the IR emitted for a form changes shape. */
+#define FN_CACHE_FORMAT 1
+
+static uint64_t hash_i32(int v, uint64_t h) {
+    return hash_bytes(&v, sizeof(v), h);
+}
+
+static void hash_symbol(IrCtx *ir, const char *name, StrList *seen, uint64_t *h);
+
+static void hash_type(IrCtx *ir, TypeRef *t, StrList *seen, uint64_t *h) {
+    StrBuf text;
+    sb_init(&text);
+    emit_llvm_type(&text, t);
+    *h = hash_str(text.data ? text.data : "", *h);
+    free(text.data);
+    while (t && t->kind == TY_PTR) t = t->pointee;
+    if (t && t->kind == TY_STRUCT && t->name) hash_symbol(ir, t->name, seen, h);
+}
+
+/* Hashes what NAME denotes: a function signature, struct layout or alias,
+ * or nothing (so defining it later changes the key). */
+static void hash_symbol(IrCtx *ir, const char *name, StrList *seen, uint64_t *h) {
+    FnTable *fns = (FnTable *)ir->fn_table;
+    TypeEnv *tenv = (TypeEnv *)ir->type_env;
+    StructDef *sd;
+    TypeRef *alias;
+    int fi;
+    int i;
+
+    if (sl_contains(seen, name)) return;
+    sl_push(seen, name);
+    *h = hash_str(name, *h);
+    fi = fn_table_find(fns, name);
+    *h = hash_i32(fi >= 0 ? fns->param_counts[fi] : -1, *h);
+    if (fi >= 0) {
+        /* A pure caller's IR depends on whether its callees are. */
+        *h = hash_i32(fns->pure[fi], *h);
+        hash_type(ir, fns->ret_types[fi], seen, h);
+        for (i = 0; i < fns->param_counts[fi]; i++) hash_type(ir, fns->param_types[fi][i], seen, h);
+    }
+    sd = type_env_find_struct(tenv, name);
+    *h = hash_i32(sd ? sd->field_count : -1, *h);
+    for (i = 0; sd && i < sd->field_count; i++) {
+        *h = hash_str(sd->field_names[i], *h);
+        hash_type(ir, sd->field_types[i], seen, h);
+    }
+    alias = type_env_resolve_alias(tenv, name);
+    *h = hash_i32(alias != NULL, *h);
+    if (alias) hash_type(ir, alias, seen, h);
+}
+
+/* Hashes the form's structure (not its source positions, which only reach
+ * diagnostics) and every symbol it names. Clears *cacheable for forms whose
+ * IR depends on more than that. */
+static void hash_form(IrCtx *ir, Node *n, StrList *seen, uint64_t *h, int *cacheable) {
+    int i;
+    if (!n) {
+        *h = hash_i32(-1, *h);
+        return;
+    }
+    *h = hash_i32((int)n->kind, *h);
+    if (n->text) *h = hash_str(n->text, *h);
+    if (n->kind == N_ATOM && n->text) {
+        /* Compile-time evaluation results, llvm-jit sites and loop hint
+         * metadata (numbered module-wide) are not part of the form. */
+        if (strcmp(n->text, "const-eval") == 0 || strcmp(n->text, "llvm-jit") == 0 ||
+            strcmp(n->text, "llvm-jit-batch") == 0 || strcmp(n->text, "vectorize") == 0 ||
+            strcmp(n->text, "unroll") == 0) {
+            *cacheable = 0;
+        }
+        hash_symbol(ir, n->text, seen, h);
+    }
+    if (n->kind == N_LIST) {
+        *h = hash_i32(n->count, *h);
+        for (i = 0; i < n->count; i++) hash_form(ir, n->items[i], seen, h, cacheable);
+    }
+}
+
+static uint64_t fn_form_key(IrCtx *ir, Node *form, const char *name, int *cacheable) {
+    uint64_t compiler = hash_compiler_identity();
+    uint64_t h = hash_i32(FN_CACHE_FORMAT, HASH_SEED);
+    StrList seen;
+    int i;
+    h = hash_bytes(&compiler, sizeof(compiler), h);
+    /* Every switch that changes a function's IR belongs here. */
+    h = hash_i32(ir->allow_untested, h);
+    h = hash_i32(ir->nsw, h);
+    /* Tags are !N ids into the module's TBAA tree. */
+    h = hash_i32(ir->strict_aliasing, h);
+    if (ir->strict_aliasing) h = hash_bytes(ir->metadata.data, tbaa_tree_len(ir), h);
+    h = hash_str(name, h);
+    sl_init(&seen);
+    hash_form(ir, form, &seen, &h, cacheable);
+    for (i = 0; i < seen.len; i++) free(seen.items[i]);
+    free(seen.items);
+    return h;
+}
+
+/* Emits FORM through the function cache: a hit appends the stored IR; a
+ * miss compiles it with function-scoped string names and declarations (so
+ * the result is relocatable into any module) and records it. */
+static void compile_fn_form_cached(IrCtx *ir, Node *form, const char *override_name) {
+    FnCache *cache = (FnCache *)ir->fn_cache;
+    const char *name = override_name ? override_name : atom_text(list_nth(form, 1));
+    StrBuf *parts[FN_PART_COUNT];
+    size_t mark[FN_PART_COUNT];
+    FnCacheEntry e;
+    int saved_strings = ir->strings;
+    int cacheable = 1;
+    uint64_t key;
+    int i;
+
+    if (!name || !*name) {
+        compile_fn_form(ir, form, override_name);
+        return;
+    }
+    key = fn_form_key(ir, form, name, &cacheable);
+    if (!cacheable) {
+        fn_cache_note_uncacheable(cache);
+        compile_fn_form(ir, form, override_name);
+        return;
+    }
+    parts[FN_PART_FUNCS] = ir->out;
+    parts[FN_PART_GLOBALS] = &ir->globals;
+    parts[FN_PART_DECLS] = &ir->decls;
+    if (fn_cache_lookup(cache, key, &e)) {
+        for (i = 0; i < FN_PART_COUNT; i++) sb_append_n(parts[i], e.data[i], e.len[i]);
+        return;
+    }
+
+    for (i = 0; i < FN_PART_COUNT; i++) mark[i] = parts[i]->len;
+    /* Declare everything the function calls itself; assemble_module drops
+     * the duplicate lines this produces. */
+    while (ir->declared_ccalls.len > ir->module_ccalls) free(ir->declared_ccalls.items[--ir->declared_ccalls.len]);
+    ir->string_scope = name;
+    ir->strings = 0;
+    compile_fn_form(ir, form, override_name);
+    ir->string_scope = NULL;
+    ir->strings = saved_strings;
+
+    for (i = 0; i < FN_PART_COUNT; i++) {
+        e.data[i] = parts[i]->data ? parts[i]->data + mark[i] : "";
+        e.len[i] = parts[i]->len - mark[i];
+    }
+    fn_cache_add(cache, key, &e);
+}
+
 static void emit_fn_form(IrCtx *ir, Node *form) {
     Node *fh = list_nth(form, 0);
+    void (*compile)(IrCtx *, Node *, const char *) = ir->fn_cache ? compile_fn_form_cached : compile_fn_form;
     if (!form || form->kind != N_LIST || !fh || fh->kind != N_ATOM) return;
     if (is_atom(fh, "fn")) {
-        compile_fn_form(ir, form, NULL);
+        timing_push_detail("emit function", atom_text(list_nth(form, 1)));
+        compile(ir, form, NULL);
+        timing_pop();
     } else if (is_atom(fh, "entry")) {
         if (ir->run_tests_mode) {
             /* In test mode, skip user entry; synthetic main will be emitted. */
             return;
         }
-        compile_fn_form(ir, form, "main");
+        timing_push_detail("emit function", "main");
+        compile(ir, form, "main");
+        timing_pop();
     }
 }
 
@@ -528,7 +1088,7 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
         Node *expected_node = list_nth(form, 2);
         Node *debug_node = (form->count > 3) ? list_nth(form, 3) : NULL;
         Value actual_val = cg_expr(ir, env, actual_node);
-        Value expected_val = cg_expr(ir, env, expected_node);
+        Value expected_val = expect_operand(ir, cg_expr(ir, env, expected_node), actual_val.type, expected_node);
         int tcmp = ir_fresh_temp(ir);
         int tzext = ir_fresh_temp(ir);
         int tcond = ir_fresh_temp(ir);
@@ -551,7 +1111,7 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
         } else {
             sb_append(ir->out, "  ");
             ir_emit_temp(ir->out, tcmp);
-            sb_append(ir->out, " = icmp eq ");
+            sb_append(ir->out, type_is_float(actual_val.type) ? " = fcmp oeq " : " = icmp eq ");
             emit_llvm_type(ir->out, actual_val.type);
             sb_append(ir->out, " ");
             emit_value_only(ir->out, actual_val);
@@ -587,8 +1147,12 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
             const char *fmt_actual = "%p";
             if (expected_val.type && expected_val.type->kind == TY_I32) fmt_expected = "%d";
             else if (expected_val.type && expected_val.type->kind == TY_I8PTR) fmt_expected = "%s";
+            else if (expected_val.type && expected_val.type->kind == TY_I64) fmt_expected = "%lld";
+            else if (type_is_float(expected_val.type)) fmt_expected = "%g";
             if (actual_val.type && actual_val.type->kind == TY_I32) fmt_actual = "%d";
             else if (actual_val.type && actual_val.type->kind == TY_I8PTR) fmt_actual = "%s";
+            else if (actual_val.type && actual_val.type->kind == TY_I64) fmt_actual = "%lld";
+            else if (type_is_float(actual_val.type)) fmt_actual = "%g";
             snprintf(msgbuf, sizeof(msgbuf), "%s:%d:%d: %s: expect-eq failed: expected %s, got %s",
                      form && form->filename ? form->filename : "<unknown>",
                      form ? form->line : 0,
@@ -601,6 +1165,8 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
                 sl_push(&ir->declared_ccalls, "printf");
                 sb_append(&ir->decls, "declare i32 @printf(i8*, ...)\n");
             }
+            expected_val = vararg_value(ir, expected_val);
+            actual_val = vararg_value(ir, actual_val);
             sb_append(ir->out, "  call i32 (i8*, ...) @printf(i8* ");
             ir_emit_temp(ir->out, sptr);
             sb_append(ir->out, ", ");
@@ -628,7 +1194,7 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
         Node *expected_node = list_nth(form, 2);
         Node *debug_node = (form->count > 3) ? list_nth(form, 3) : NULL;
         Value actual_val = cg_expr(ir, env, actual_node);
-        Value expected_val = cg_expr(ir, env, expected_node);
+        Value expected_val = expect_operand(ir, cg_expr(ir, env, expected_node), actual_val.type, expected_node);
         int tcmp = ir_fresh_temp(ir);
         int tzext = ir_fresh_temp(ir);
         int tcond = ir_fresh_temp(ir);
@@ -651,7 +1217,7 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
         } else {
             sb_append(ir->out, "  ");
             ir_emit_temp(ir->out, tcmp);
-            sb_append(ir->out, " = icmp ne ");
+            sb_append(ir->out, type_is_float(actual_val.type) ? " = fcmp une " : " = icmp ne ");
             emit_llvm_type(ir->out, actual_val.type);
             sb_append(ir->out, " ");
             emit_value_only(ir->out, actual_val);
@@ -689,6 +1255,8 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
             const char *fmt_actual = "%p";
             if (actual_val.type && actual_val.type->kind == TY_I32) fmt_actual = "%d";
             else if (actual_val.type && actual_val.type->kind == TY_I8PTR) fmt_actual = "%s";
+            else if (actual_val.type && actual_val.type->kind == TY_I64) fmt_actual = "%lld";
+            else if (type_is_float(actual_val.type)) fmt_actual = "%g";
             snprintf(msgbuf, sizeof(msgbuf), "%s:%d:%d: %s: expect-ne failed: values should differ, both are %s",
                      form && form->filename ? form->filename : "<unknown>",
                      form ? form->line : 0,
@@ -700,6 +1268,7 @@ static int try_desugar_expect(IrCtx *ir, VarEnv *env, Node *form, const char *te
                 sl_push(&ir->declared_ccalls, "printf");
                 sb_append(&ir->decls, "declare i32 @printf(i8*, ...)\n");
             }
+            actual_val = vararg_value(ir, actual_val);
             sb_append(ir->out, "  call i32 (i8*, ...) @printf(i8* ");
             ir_emit_temp(ir->out, sptr);
             sb_append(ir->out, ", ");
@@ -821,7 +1390,6 @@ static void emit_tests_for_fn(IrCtx *ir, Node *fn_form) {
     */
     int idx = 1;
     const char *fn_name = NULL;
-    Node *maybe_doc;
     Node *params_form;
     Node *returns_form;
     Node *body_form;
@@ -829,10 +1397,7 @@ static void emit_tests_for_fn(IrCtx *ir, Node *fn_form) {
 
     if (!fn_form || fn_form->kind != N_LIST) return;
     fn_name = atom_text(list_nth(fn_form, idx++));
-    maybe_doc = list_nth(fn_form, idx);
-    if (maybe_doc && maybe_doc->kind == N_LIST && is_atom(list_nth(maybe_doc, 0), "doc")) {
-        idx++;
-    }
+    idx = skip_fn_clauses(fn_form, idx);
     params_form = list_nth(fn_form, idx++);
     returns_form = list_nth(fn_form, idx++);
     body_form = list_nth(fn_form, idx++);
@@ -891,7 +1456,7 @@ static void emit_tests_for_fn(IrCtx *ir, Node *fn_form) {
             snprintf(buf, sizeof(buf), "__test_%s_%d", fn_name ? fn_name : "fn", ti - 1);
             ir->current_fn = buf;
             /* Emit header for test function: define i32 @name() { */
-            emit_fn_header(ir, NULL, buf, ret_type, NULL);
+            emit_fn_header(ir, NULL, buf, ret_type, NULL, NULL, 0);
             /* Reset per-test expect flag */
             ir->saw_expect = 0;
 
@@ -957,6 +1522,7 @@ static void emit_tests_for_fn(IrCtx *ir, Node *fn_form) {
                         {
                             if (rv.kind == 0) sb_printf_i32(ir->out, rv.const_i32);
                             else if (rv.kind == 1) ir_emit_temp(ir->out, rv.temp);
+                            else if (rv.kind == 3) emit_const_literal(ir->out, rv);
                             else {
                                 sb_append(ir->out, "%");
                                 sb_append(ir->out, rv.ssa_name ? rv.ssa_name : "");
@@ -997,7 +1563,7 @@ static void emit_tests_main(IrCtx *ir) {
     int i;
     TypeRef *ret_type = type_i32();
     /* define i32 @main() { */
-    emit_fn_header(ir, NULL, "main", ret_type, NULL);
+    emit_fn_header(ir, NULL, "main", ret_type, NULL, NULL, 0);
     /* declare i32 @puts(i8*) once */
     if (!sl_contains(&ir->declared_ccalls, "puts")) {
         sl_push(&ir->declared_ccalls, "puts");
@@ -1057,7 +1623,533 @@ static void emit_tests_main(IrCtx *ir) {
     sb_append(ir->out, "}\n");
 }
 
-void compile_to_llvm_ir(Node *top, StrBuf *out, int run_tests_mode, StrList *selected_test_names, StrList *selected_tags) {
+/* Built-in signatures for functions used in tests but not declared in Weave code.
+ * Register these AFTER collect_signatures so they overwrite any incorrect collected signatures. */
+static void register_builtin_signatures(FnTable *fns) {
+    {
+        /* arena-create: returns ptr(Arena), takes Int32 size */
+        TypeRef *arena_ptr = type_ptr(type_struct("Arena"));
+        TypeRef *param_types[1];
+        param_types[0] = type_i32();
+        fn_table_add(fns, "arena-create", arena_ptr, 1, param_types);
+    }
+    
+    {
+        /* arena-kind: returns Int32, takes ptr(Arena) and Int32 id */
+        TypeRef *arena_kind_param_types[2];
+        TypeRef *arena_struct = type_struct("Arena");
+        arena_kind_param_types[0] = type_ptr(arena_struct);
+        arena_kind_param_types[1] = type_i32();
+        /* Debug: verify type structure */
+        if (getenv("WEAVEC0_DEBUG_SIGS")) {
+            fprintf(stderr, "[dbg] Registering arena-kind: param[0] type: kind=%d, pointee_kind=%d\n",
+                    arena_kind_param_types[0]->kind,
+                    arena_kind_param_types[0]->pointee ? arena_kind_param_types[0]->pointee->kind : -1);
+        }
+        fn_table_add(fns, "arena-kind", type_i32(), 2, arena_kind_param_types);
+    }
+    
+    {
+        /* Regions (emit_region_runtime): create, alloc, reset, destroy */
+        TypeRef *region_ptr = type_ptr(type_struct("Region"));
+        TypeRef *create_params[1];
+        TypeRef *alloc_params[2];
+        TypeRef *release_params[1];
+        create_params[0] = type_i32();
+        fn_table_add(fns, "region-create", region_ptr, 1, create_params);
+        alloc_params[0] = region_ptr;
+        alloc_params[1] = type_i32();
+        fn_table_add(fns, "region-alloc", type_i8ptr(), 2, alloc_params);
+        release_params[0] = region_ptr;
+        fn_table_add(fns, "region-reset", type_void(), 1, release_params);
+        fn_table_add(fns, "region-destroy", type_void(), 1, release_params);
+    }
+
+    /* JIT compilation functions - available via ccall */
+    {
+        /* llvm-jit-compile: returns Int32 (function pointer), takes String ir, String func_name */
+        TypeRef *str_type = type_i8ptr();  /* String is i8* in LLVM */
+        TypeRef *jit_param_types[2];
+        jit_param_types[0] = str_type;
+        jit_param_types[1] = str_type;
+        fn_table_add(fns, "llvm-jit-compile", type_i32(), 2, jit_param_types);
+        
+        /* llvm-jit-call: returns Int32, takes String ir, String func_name, Int32 arg1, Int32 arg2 */
+        TypeRef *jit_call_param_types[4];
+        jit_call_param_types[0] = str_type;
+        jit_call_param_types[1] = str_type;
+        jit_call_param_types[2] = type_i32();
+        jit_call_param_types[3] = type_i32();
+        fn_table_add(fns, "llvm-jit-call", type_i32(), 4, jit_call_param_types);
+    }
+    
+    /* LLVM compilation functions - available via ccall for stage1 */
+    {
+        TypeRef *str_type = type_i8ptr();
+        
+        /* llvm-compile-ir-to-assembly: returns Int32 (0=success), takes String ir, String output_path, Int32 opt_level */
+        TypeRef *asm_param_types[3];
+        asm_param_types[0] = str_type;  /* IR string */
+        asm_param_types[1] = str_type;    /* output path */
+        asm_param_types[2] = type_i32(); /* opt_level */
+        fn_table_add(fns, "llvm-compile-ir-to-assembly", type_i32(), 3, asm_param_types);
+        
+        /* llvm-compile-ir-to-object: returns Int32 (0=success), takes String ir, String output_path, Int32 opt_level */
+        TypeRef *obj_param_types[3];
+        obj_param_types[0] = str_type;  /* IR string */
+        obj_param_types[1] = str_type;   /* output path */
+        obj_param_types[2] = type_i32(); /* opt_level */
+        fn_table_add(fns, "llvm-compile-ir-to-object", type_i32(), 3, obj_param_types);
+        
+        /* llvm-link-objects: returns Int32 (0=success), takes String object_files, String extra_flags, String output_path */
+        TypeRef *link_param_types[3];
+        link_param_types[0] = str_type;  /* object files (space-separated) */
+        link_param_types[1] = str_type;   /* extra flags */
+        link_param_types[2] = str_type;   /* output path */
+        fn_table_add(fns, "llvm-link-objects", type_i32(), 3, link_param_types);
+    }
+}
+
+/* Type and function declarations every module needs: the Arena and Region
+ * structs, malloc and free (make, arena-create, the region runtime) and the JIT/LLVM helpers reachable via ccall. */
+static void emit_runtime_decls(IrCtx *ir, TypeEnv *tenv) {
+      /* Define Arena struct type only if not already defined by user code.
+          Arena has four i8* fields: kinds, values, first, next */
+    if (!type_env_find_struct(tenv, "Arena")) {
+        sb_append(&ir->typedefs, "%Arena = type { i8*, i8*, i8*, i8* }\n");
+    }
+
+    /* Region: cur, end, chunks, chunk_size (see emit_region_runtime). */
+    if (!type_env_find_struct(tenv, "Region")) {
+        sb_append(&ir->typedefs, "%Region = type { i8*, i8*, i8*, i32 }\n");
+    }
+
+    /* Ensure malloc is declared for arena-create */
+    if (!sl_contains(&ir->declared_ccalls, "malloc")) {
+        sl_push(&ir->declared_ccalls, "malloc");
+        sb_append(&ir->decls, "declare i8* @malloc(i32)\n");
+    }
+    /* ... and free for region-reset/region-destroy */
+    if (!sl_contains(&ir->declared_ccalls, "free")) {
+        sl_push(&ir->declared_ccalls, "free");
+        sb_append(&ir->decls, "declare void @free(i8*)\n");
+    }
+
+    /* Declare JIT helper functions for ccall */
+    if (!sl_contains(&ir->declared_ccalls, "llvm_jit_compile_and_get_ptr")) {
+        sl_push(&ir->declared_ccalls, "llvm_jit_compile_and_get_ptr");
+        sb_append(&ir->decls, "declare i32 @llvm_jit_compile_and_get_ptr(i8*, i8*)\n");
+    }
+    if (!sl_contains(&ir->declared_ccalls, "llvm_jit_call_i32_i32_i32")) {
+        sl_push(&ir->declared_ccalls, "llvm_jit_call_i32_i32_i32");
+        sb_append(&ir->decls, "declare i32 @llvm_jit_call_i32_i32_i32(i8*, i8*, i32, i32)\n");
+    }
+    
+    /* Declare LLVM compilation functions for ccall (used by stage1) */
+    if (!sl_contains(&ir->declared_ccalls, "llvm_compile_ir_to_assembly")) {
+        sl_push(&ir->declared_ccalls, "llvm_compile_ir_to_assembly");
+        sb_append(&ir->decls, "declare i32 @llvm_compile_ir_to_assembly(i8*, i8*, i32)\n");
+    }
+    if (!sl_contains(&ir->declared_ccalls, "llvm_compile_ir_to_object")) {
+        sl_push(&ir->declared_ccalls, "llvm_compile_ir_to_object");
+        sb_append(&ir->decls, "declare i32 @llvm_compile_ir_to_object(i8*, i8*, i32)\n");
+    }
+    if (!sl_contains(&ir->declared_ccalls, "llvm_link_objects")) {
+        sl_push(&ir->declared_ccalls, "llvm_link_objects");
+        sb_append(&ir->decls, "declare i32 @llvm_link_objects(i8*, i8*, i8*)\n");
+    }
+}
+
+/* Simplified arena-create: just allocate Arena struct, initialize fields to null.
+ * Stage0 tests don't actually use arenas, so this minimal implementation is sufficient.
+ * For full arena functionality, use stage1 which has proper Weave array implementations.
+ */
+static void emit_arena_create(StrBuf *funcs) {
+    sb_append(funcs, "define noalias %Arena* @arena-create(i32 %size) nounwind {\n");
+    sb_append(funcs, "  %raw = call i8* @malloc(i32 32)\n");
+    sb_append(funcs, "  %a = bitcast i8* %raw to %Arena*\n");
+    sb_append(funcs, "  %p0 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 0\n");
+    sb_append(funcs, "  store i8* null, i8** %p0\n");
+    sb_append(funcs, "  %p1 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 1\n");
+    sb_append(funcs, "  store i8* null, i8** %p1\n");
+    sb_append(funcs, "  %p2 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 2\n");
+    sb_append(funcs, "  store i8* null, i8** %p2\n");
+    sb_append(funcs, "  %p3 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 3\n");
+    sb_append(funcs, "  store i8* null, i8** %p3\n");
+    sb_append(funcs, "  ret %Arena* %a\n");
+    sb_append(funcs, "}\n");
+}
+
+/* Bump-allocator regions for (make-in r T ...). A Region is
+ * { cur, end, chunks, chunk_size }: allocation bumps cur until end, and
+ * chunks is the list of malloc'd blocks, each starting with a 16-byte
+ * header { next chunk, length }. make-in inlines the bump and calls
+ * region-alloc only when the current chunk is full; region-reset keeps the
+ * newest chunk for reuse and frees the rest. Sizes are rounded to 8. */
+static void emit_region_runtime(StrBuf *funcs) {
+    sb_append(funcs, "define noalias %Region* @region-create(i32 %chunk_size) nounwind {\n");
+    sb_append(funcs, "  %raw = call i8* @malloc(i32 32)\n");
+    sb_append(funcs, "  %r = bitcast i8* %raw to %Region*\n");
+    sb_append(funcs, "  %small = icmp slt i32 %chunk_size, 4096\n");
+    sb_append(funcs, "  %size = select i1 %small, i32 4096, i32 %chunk_size\n");
+    sb_append(funcs, "  %pcur = getelementptr inbounds %Region, %Region* %r, i32 0, i32 0\n");
+    sb_append(funcs, "  store i8* null, i8** %pcur\n");
+    sb_append(funcs, "  %pend = getelementptr inbounds %Region, %Region* %r, i32 0, i32 1\n");
+    sb_append(funcs, "  store i8* null, i8** %pend\n");
+    sb_append(funcs, "  %pchunks = getelementptr inbounds %Region, %Region* %r, i32 0, i32 2\n");
+    sb_append(funcs, "  store i8* null, i8** %pchunks\n");
+    sb_append(funcs, "  %psize = getelementptr inbounds %Region, %Region* %r, i32 0, i32 3\n");
+    sb_append(funcs, "  store i32 %size, i32* %psize\n");
+    sb_append(funcs, "  ret %Region* %r\n");
+    sb_append(funcs, "}\n");
+
+    sb_append(funcs, "define i8* @region-alloc(%Region* nonnull %r, i32 %n) nounwind {\n");
+    sb_append(funcs, "entry:\n");
+    sb_append(funcs, "  %n7 = add i32 %n, 7\n");
+    sb_append(funcs, "  %n8 = and i32 %n7, -8\n");
+    sb_append(funcs, "  %pcur = getelementptr inbounds %Region, %Region* %r, i32 0, i32 0\n");
+    sb_append(funcs, "  %pend = getelementptr inbounds %Region, %Region* %r, i32 0, i32 1\n");
+    sb_append(funcs, "  %cur = load i8*, i8** %pcur\n");
+    sb_append(funcs, "  %end = load i8*, i8** %pend\n");
+    sb_append(funcs, "  %next = getelementptr i8, i8* %cur, i32 %n8\n");
+    sb_append(funcs, "  %fits = icmp ule i8* %next, %end\n");
+    sb_append(funcs, "  %live = icmp ne i8* %cur, null\n");
+    sb_append(funcs, "  %fast = and i1 %fits, %live\n");
+    sb_append(funcs, "  br i1 %fast, label %bump, label %refill\n");
+    sb_append(funcs, "bump:\n");
+    sb_append(funcs, "  store i8* %next, i8** %pcur\n");
+    sb_append(funcs, "  ret i8* %cur\n");
+    sb_append(funcs, "refill:\n");
+    sb_append(funcs, "  %psize = getelementptr inbounds %Region, %Region* %r, i32 0, i32 3\n");
+    sb_append(funcs, "  %size = load i32, i32* %psize\n");
+    sb_append(funcs, "  %need = add i32 %n8, 16\n");
+    sb_append(funcs, "  %big = icmp sgt i32 %need, %size\n");
+    sb_append(funcs, "  %len = select i1 %big, i32 %need, i32 %size\n");
+    sb_append(funcs, "  %chunk = call i8* @malloc(i32 %len)\n");
+    sb_append(funcs, "  %link = bitcast i8* %chunk to i8**\n");
+    sb_append(funcs, "  %pchunks = getelementptr inbounds %Region, %Region* %r, i32 0, i32 2\n");
+    sb_append(funcs, "  %older = load i8*, i8** %pchunks\n");
+    sb_append(funcs, "  store i8* %older, i8** %link\n");
+    sb_append(funcs, "  store i8* %chunk, i8** %pchunks\n");
+    sb_append(funcs, "  %plen8 = getelementptr i8, i8* %chunk, i32 8\n");
+    sb_append(funcs, "  %plen = bitcast i8* %plen8 to i32*\n");
+    sb_append(funcs, "  store i32 %len, i32* %plen\n");
+    sb_append(funcs, "  %data = getelementptr i8, i8* %chunk, i32 16\n");
+    sb_append(funcs, "  %after = getelementptr i8, i8* %data, i32 %n8\n");
+    sb_append(funcs, "  %limit = getelementptr i8, i8* %chunk, i32 %len\n");
+    sb_append(funcs, "  store i8* %after, i8** %pcur\n");
+    sb_append(funcs, "  store i8* %limit, i8** %pend\n");
+    sb_append(funcs, "  ret i8* %data\n");
+    sb_append(funcs, "}\n");
+
+    sb_append(funcs, "define void @region-reset(%Region* nonnull %r) nounwind {\n");
+    sb_append(funcs, "entry:\n");
+    sb_append(funcs, "  %pchunks = getelementptr inbounds %Region, %Region* %r, i32 0, i32 2\n");
+    sb_append(funcs, "  %head = load i8*, i8** %pchunks\n");
+    sb_append(funcs, "  %empty = icmp eq i8* %head, null\n");
+    sb_append(funcs, "  br i1 %empty, label %done, label %keep\n");
+    sb_append(funcs, "keep:\n");
+    sb_append(funcs, "  %hlink = bitcast i8* %head to i8**\n");
+    sb_append(funcs, "  %first = load i8*, i8** %hlink\n");
+    sb_append(funcs, "  store i8* null, i8** %hlink\n");
+    sb_append(funcs, "  br label %loop\n");
+    sb_append(funcs, "loop:\n");
+    sb_append(funcs, "  %c = phi i8* [ %first, %keep ], [ %next, %release ]\n");
+    sb_append(funcs, "  %last = icmp eq i8* %c, null\n");
+    sb_append(funcs, "  br i1 %last, label %rewind, label %release\n");
+    sb_append(funcs, "release:\n");
+    sb_append(funcs, "  %clink = bitcast i8* %c to i8**\n");
+    sb_append(funcs, "  %next = load i8*, i8** %clink\n");
+    sb_append(funcs, "  call void @free(i8* %c)\n");
+    sb_append(funcs, "  br label %loop\n");
+    sb_append(funcs, "rewind:\n");
+    sb_append(funcs, "  %plen8 = getelementptr i8, i8* %head, i32 8\n");
+    sb_append(funcs, "  %plen = bitcast i8* %plen8 to i32*\n");
+    sb_append(funcs, "  %len = load i32, i32* %plen\n");
+    sb_append(funcs, "  %data = getelementptr i8, i8* %head, i32 16\n");
+    sb_append(funcs, "  %limit = getelementptr i8, i8* %head, i32 %len\n");
+    sb_append(funcs, "  %pcur = getelementptr inbounds %Region, %Region* %r, i32 0, i32 0\n");
+    sb_append(funcs, "  store i8* %data, i8** %pcur\n");
+    sb_append(funcs, "  %pend = getelementptr inbounds %Region, %Region* %r, i32 0, i32 1\n");
+    sb_append(funcs, "  store i8* %limit, i8** %pend\n");
+    sb_append(funcs, "  br label %done\n");
+    sb_append(funcs, "done:\n");
+    sb_append(funcs, "  ret void\n");
+    sb_append(funcs, "}\n");
+
+    sb_append(funcs, "define void @region-destroy(%Region* nonnull %r) nounwind {\n");
+    sb_append(funcs, "entry:\n");
+    sb_append(funcs, "  %pchunks = getelementptr inbounds %Region, %Region* %r, i32 0, i32 2\n");
+    sb_append(funcs, "  %head = load i8*, i8** %pchunks\n");
+    sb_append(funcs, "  br label %loop\n");
+    sb_append(funcs, "loop:\n");
+    sb_append(funcs, "  %c = phi i8* [ %head, %entry ], [ %next, %release ]\n");
+    sb_append(funcs, "  %last = icmp eq i8* %c, null\n");
+    sb_append(funcs, "  br i1 %last, label %done, label %release\n");
+    sb_append(funcs, "release:\n");
+    sb_append(funcs, "  %clink = bitcast i8* %c to i8**\n");
+    sb_append(funcs, "  %next = load i8*, i8** %clink\n");
+    sb_append(funcs, "  call void @free(i8* %c)\n");
+    sb_append(funcs, "  br label %loop\n");
+    sb_append(funcs, "done:\n");
+    sb_append(funcs, "  %raw = bitcast %Region* %r to i8*\n");
+    sb_append(funcs, "  call void @free(i8* %raw)\n");
+    sb_append(funcs, "  ret void\n");
+    sb_append(funcs, "}\n");
+}
+
+/* Appends the lines of TEXT[0..len) to OUT, skipping repeats. Cached
+ * functions carry their own declarations, so the same one can occur twice. */
+static void append_unique_lines(StrBuf *out, const char *text, size_t len) {
+    StrList seen;
+    const char *p = text;
+    const char *end = text + len;
+    int i;
+    sl_init(&seen);
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t n = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+        char *line = (char *)xmalloc(n + 1);
+        memcpy(line, p, n);
+        line[n] = '\0';
+        if (!sl_contains(&seen, line)) {
+            sl_push(&seen, line);
+            sb_append_n(out, p, n);
+        }
+        free(line);
+        p += n;
+    }
+    for (i = 0; i < seen.len; i++) free(seen.items[i]);
+    free(seen.items);
+}
+
+/* Concatenate the IR sections into a complete module. */
+static void assemble_module(IrCtx *ir, StrBuf *funcs, StrBuf *out) {
+    sb_init(out);
+    if (ir->typedefs.data && ir->typedefs.len) sb_append_n(out, ir->typedefs.data, ir->typedefs.len);
+    if (ir->globals.data && ir->globals.len) sb_append_n(out, ir->globals.data, ir->globals.len);
+    if (ir->decls.data && ir->decls.len) {
+        if (ir->fn_cache) {
+            append_unique_lines(out, ir->decls.data, ir->decls.len);
+        } else {
+            sb_append_n(out, ir->decls.data, ir->decls.len);
+        }
+    }
+    if (funcs->data && funcs->len) sb_append_n(out, funcs->data, funcs->len);
+    if (ir->metadata.len) sb_append_n(out, ir->metadata.data, ir->metadata.len);
+}
+
+/* Define NAME as a parameterless function returning the value of FORM.
+ * The body is generated first because the thunk's return type is the type of
+ * FORM's value: Int32, String and pointers are returned, anything else
+ * yields void. Returns that type. */
+static TypeRef *emit_value_thunk(IrCtx *ir, StrBuf *funcs, const char *name, Node *form) {
+    VarEnv env;
+    StrBuf body;
+    StrBuf *saved_out = ir->out;
+    const char *saved_fn = ir->current_fn;
+    Value last = {0};
+    TypeRef *ty;
+    int did_ret;
+
+    sb_init(&body);
+    ir->out = &body;
+    ir->current_fn = name;
+    env_init(&env);
+    if (form && form->kind == N_LIST) {
+        did_ret = cg_stmt(ir, &env, form, type_i32(), &last);
+    } else {
+        /* Bare atoms and string literals are not statements. */
+        did_ret = 0;
+        last = cg_expr(ir, &env, form);
+    }
+    ir->out = saved_out;
+    ir->current_fn = saved_fn;
+    ty = did_ret ? type_i32() : last.type;
+    if (!ty || (ty->kind != TY_I32 && ty->kind != TY_I8PTR && ty->kind != TY_PTR && ty->kind != TY_I64 &&
+                !type_is_float(ty)))
+        ty = type_void();
+
+    sb_append(funcs, "define ");
+    emit_llvm_type(funcs, ty);
+    sb_append(funcs, " @");
+    sb_append(funcs, name);
+    sb_append(funcs, "() {\nfn_entry:\n");
+    if (body.data && body.len) sb_append_n(funcs, body.data, body.len);
+    if (!did_ret) {
+        sb_append(funcs, "  ret ");
+        emit_llvm_type(funcs, ty);
+        if (ty->kind != TY_VOID) {
+            sb_append(funcs, " ");
+            emit_value_only(funcs, last);
+        }
+        sb_append(funcs, "\n");
+    }
+    sb_append(funcs, "}\n");
+    free(body.data);
+    return ty;
+}
+
+static void const_eval_push(ConstEvalTable *tab, Node *site) {
+    if (tab->count == tab->cap) {
+        tab->cap = tab->cap ? tab->cap * 2 : 8;
+        tab->sites = (Node **)xrealloc(tab->sites, (size_t)tab->cap * sizeof(Node *));
+        tab->is_string = (int *)xrealloc(tab->is_string, (size_t)tab->cap * sizeof(int));
+        tab->ints = (int *)xrealloc(tab->ints, (size_t)tab->cap * sizeof(int));
+        tab->strs = (char **)xrealloc(tab->strs, (size_t)tab->cap * sizeof(char *));
+    }
+    tab->sites[tab->count] = site;
+    tab->is_string[tab->count] = 0;
+    tab->ints[tab->count] = 0;
+    tab->strs[tab->count] = NULL;
+    tab->count++;
+}
+
+static void const_eval_free(ConstEvalTable *tab) {
+    int i;
+    for (i = 0; i < tab->count; i++) free(tab->strs[i]);
+    free(tab->sites);
+    free(tab->is_string);
+    free(tab->ints);
+    free(tab->strs);
+}
+
+/* Collect (const-eval e) sites. Sites nested inside another site's
+ * expression are compiled in place when the outer one is evaluated. */
+static void collect_const_evals(Node *n, ConstEvalTable *tab) {
+    int i;
+    if (!n || n->kind != N_LIST) return;
+    if (is_atom(list_nth(n, 0), "const-eval")) {
+        const_eval_push(tab, n);
+        return;
+    }
+    for (i = 0; i < n->count; i++) collect_const_evals(list_nth(n, i), tab);
+}
+
+/* Evaluate every const-eval site: compile the program once more with the
+ * sites compiled in place plus one thunk per site, JIT the module and call
+ * the thunks. Test bodies are emitted too so every site is checked against
+ * its enclosing scope. */
+static void evaluate_const_evals(Node *top, ConstEvalTable *tab) {
+#ifdef USE_LLVM_API
+    IrCtx ir;
+    StrBuf funcs;
+    StrBuf module;
+    FnTable fns;
+    TypeEnv tenv;
+    TypeRef **types = (TypeRef **)xmalloc((size_t)tab->count * sizeof(TypeRef *));
+    LLVMJITSessionRef jit;
+    int prev_warn = diag_suppress_warnings(1);
+    int i;
+
+    sb_init(&funcs);
+    ir_init(&ir, &funcs);
+    ir.run_tests_mode = 1;
+    ir.const_eval_inline = 1;
+    fn_table_init(&fns);
+    ir.fn_table = &fns;
+    type_env_init(&tenv);
+    ir.type_env = &tenv;
+
+    collect_types(&tenv, &ir, top);
+    collect_signatures(&tenv, &fns, top);
+    register_builtin_signatures(&fns);
+    emit_runtime_decls(&ir, &tenv);
+    emit_arena_create(&funcs);
+    emit_region_runtime(&funcs);
+    for (i = 0; top && i < top->count; i++) {
+        emit_fn_forms_in(&ir, list_nth(top, i));
+        emit_tests_in(&ir, list_nth(top, i));
+    }
+    for (i = 0; i < tab->count; i++) {
+        char name[64];
+        Node *site = tab->sites[i];
+        snprintf(name, sizeof(name), "__weave_const_%d", i);
+        types[i] = emit_value_thunk(&ir, &funcs, name, list_nth(site, 1));
+        if (types[i]->kind != TY_I32 && types[i]->kind != TY_I8PTR) {
+            diag_fatal(site->filename, site->line, site->col, "const-eval-type",
+                       "const-eval expression must produce Int32 or String", NULL);
+        }
+    }
+    assemble_module(&ir, &funcs, &module);
+    diag_suppress_warnings(prev_warn);
+
+    jit = llvm_jit_create_session_ex(0, NULL);
+    if (!jit || llvm_jit_add_module(jit, module.data ? module.data : "", module.len) != 0) {
+        diag_fatal(tab->sites[0]->filename, tab->sites[0]->line, tab->sites[0]->col, "const-eval-jit",
+                   "JIT compilation of const-eval expressions failed",
+                   "set WEAVEC0_DEBUG_JIT=1 for the LLVM error");
+    }
+    for (i = 0; i < tab->count; i++) {
+        char name[64];
+        Node *site = tab->sites[i];
+        void *fn;
+        snprintf(name, sizeof(name), "__weave_const_%d", i);
+        fn = llvm_jit_lookup_function(jit, name);
+        if (!fn) {
+            diag_fatal(site->filename, site->line, site->col, "const-eval-jit",
+                       "const-eval expression could not be linked",
+                       "every function it calls must be defined in the program or in the compiler's process");
+        }
+        if (types[i]->kind == TY_I8PTR) {
+            const char *str = ((const char *(*)(void))fn)();
+            tab->is_string[i] = 1;
+            tab->strs[i] = xstrdup(str ? str : "");
+        } else {
+            tab->ints[i] = ((int (*)(void))fn)();
+        }
+    }
+    llvm_jit_dispose_session(jit);
+    free(module.data);
+    free(types);
+#else
+    (void)top;
+    diag_fatal(tab->sites[0]->filename, tab->sites[0]->line, tab->sites[0]->col, "const-eval-unsupported",
+               "const-eval requires a weavec0 built with the LLVM JIT (USE_LLVM_API)", NULL);
+#endif
+}
+
+/* --inline-llvm-jit: replace OUT with the module linked against every IR
+ * literal the llvm-jit calls referenced. */
+static void link_inline_jit_literals(IrCtx *ir, StrBuf *out) {
+#ifdef USE_LLVM_API
+    char *linked = NULL;
+    if (llvm_link_ir_literals(out->data ? out->data : "", out->len, ir->inline_jit_syms.len,
+                              (const char *const *)ir->inline_jit_irs.items,
+                              (const char *const *)ir->inline_jit_fns.items,
+                              (const char *const *)ir->inline_jit_syms.items, &linked) != 0) {
+        diag_fatal(NULL, 0, 0, "llvm-jit-link", "failed to link llvm-jit IR into the module", NULL);
+    }
+    out->len = 0;
+    if (out->data) out->data[0] = '\0';
+    sb_append(out, linked);
+    free(linked);
+#else
+    (void)ir;
+    (void)out;
+    diag_fatal(NULL, 0, 0, "llvm-jit-link",
+               "--inline-llvm-jit requires a weavec0 built with the LLVM API (USE_LLVM_API)", NULL);
+#endif
+}
+
+/* The function cache of the compile of TOP: one per input file, and a
+ * separate one for its test builds (which have no entry but the same fns). */
+static FnCache *open_fn_cache(const char *dir, Node *top, int run_tests_mode) {
+    const char *path = top && top->filename ? top->filename : "-";
+    char *canon = realpath(path, NULL);
+    StrBuf unit;
+    FnCache *cache;
+    sb_init(&unit);
+    sb_append(&unit, canon ? canon : path);
+    if (run_tests_mode) sb_append(&unit, "#tests");
+    cache = fn_cache_open(dir, unit.data);
+    free(unit.data);
+    free(canon);
+    return cache;
+}
+
+void compile_to_llvm_ir(Node *top, StrBuf *out, int run_tests_mode, StrList *selected_test_names, StrList *selected_tags,
+                        const CodegenOptions *opts) {
     int i;
     IrCtx ir;
     StrBuf funcs;
@@ -1067,6 +2159,10 @@ void compile_to_llvm_ir(Node *top, StrBuf *out, int run_tests_mode, StrList *sel
     sb_init(&funcs);
     ir_init(&ir, &funcs);
     ir.run_tests_mode = run_tests_mode;
+    ir.inline_llvm_jit = opts ? opts->inline_llvm_jit : 0;
+    ir.nsw = opts ? opts->nsw : 0;
+    ir.strict_aliasing = opts ? opts->strict_aliasing : 0;
+    if (opts && opts->incremental_dir) ir.fn_cache = open_fn_cache(opts->incremental_dir, top, run_tests_mode);
     if (selected_test_names && selected_test_names->len > 0) {
         int si;
         for (si = 0; si < selected_test_names->len; si++) sl_push(&ir.selected_test_names, selected_test_names->items[si]);
@@ -1082,148 +2178,28 @@ void compile_to_llvm_ir(Node *top, StrBuf *out, int run_tests_mode, StrList *sel
 
     {
         Node *decls = top;
+        ConstEvalTable const_evals = {0};
 
-        collect_types(&tenv, &ir, decls);
-        collect_signatures(&tenv, &fns, decls);
-
-        /* Built-in signatures for functions used in tests but not declared in Weave code.
-         * Register these AFTER collect_signatures so they overwrite any incorrect collected signatures. */
-        {
-            /* arena-create: returns ptr(Arena), takes Int32 size */
-            TypeRef *arena_ptr = type_ptr(type_struct("Arena"));
-            TypeRef *param_types[1];
-            param_types[0] = type_i32();
-            fn_table_add(&fns, "arena-create", arena_ptr, 1, param_types);
-        }
-        
-        {
-            /* arena-kind: returns Int32, takes ptr(Arena) and Int32 id */
-            TypeRef *arena_kind_param_types[2];
-            TypeRef *arena_struct = type_struct("Arena");
-            arena_kind_param_types[0] = type_ptr(arena_struct);
-            arena_kind_param_types[1] = type_i32();
-            /* Debug: verify type structure */
-            if (getenv("WEAVEC0_DEBUG_SIGS")) {
-                fprintf(stderr, "[dbg] Registering arena-kind (1st): param[0] type: kind=%d, pointee_kind=%d\n",
-                        arena_kind_param_types[0]->kind,
-                        arena_kind_param_types[0]->pointee ? arena_kind_param_types[0]->pointee->kind : -1);
-            }
-            fn_table_add(&fns, "arena-kind", type_i32(), 2, arena_kind_param_types);
-        }
-        
-        /* JIT compilation functions - available via ccall */
-        {
-            /* llvm-jit-compile: returns Int32 (function pointer), takes String ir, String func_name */
-            TypeRef *str_type = type_i8ptr();  /* String is i8* in LLVM */
-            TypeRef *jit_param_types[2];
-            jit_param_types[0] = str_type;
-            jit_param_types[1] = str_type;
-            fn_table_add(&fns, "llvm-jit-compile", type_i32(), 2, jit_param_types);
-            
-            /* llvm-jit-call: returns Int32, takes String ir, String func_name, Int32 arg1, Int32 arg2 */
-            TypeRef *jit_call_param_types[4];
-            jit_call_param_types[0] = str_type;
-            jit_call_param_types[1] = str_type;
-            jit_call_param_types[2] = type_i32();
-            jit_call_param_types[3] = type_i32();
-            fn_table_add(&fns, "llvm-jit-call", type_i32(), 4, jit_call_param_types);
-        }
-        
-        /* LLVM compilation functions - available via ccall for stage1 */
-        {
-            TypeRef *str_type = type_i8ptr();
-            
-            /* llvm-compile-ir-to-assembly: returns Int32 (0=success), takes String ir, String output_path, Int32 opt_level */
-            TypeRef *asm_param_types[3];
-            asm_param_types[0] = str_type;  /* IR string */
-            asm_param_types[1] = str_type;    /* output path */
-            asm_param_types[2] = type_i32(); /* opt_level */
-            fn_table_add(&fns, "llvm-compile-ir-to-assembly", type_i32(), 3, asm_param_types);
-            
-            /* llvm-compile-ir-to-object: returns Int32 (0=success), takes String ir, String output_path, Int32 opt_level */
-            TypeRef *obj_param_types[3];
-            obj_param_types[0] = str_type;  /* IR string */
-            obj_param_types[1] = str_type;   /* output path */
-            obj_param_types[2] = type_i32(); /* opt_level */
-            fn_table_add(&fns, "llvm-compile-ir-to-object", type_i32(), 3, obj_param_types);
-            
-            /* llvm-link-objects: returns Int32 (0=success), takes String object_files, String extra_flags, String output_path */
-            TypeRef *link_param_types[3];
-            link_param_types[0] = str_type;  /* object files (space-separated) */
-            link_param_types[1] = str_type;   /* extra flags */
-            link_param_types[2] = str_type;   /* output path */
-            fn_table_add(&fns, "llvm-link-objects", type_i32(), 3, link_param_types);
-        }
-
-          /* Define Arena struct type only if not already defined by user code.
-              Arena has four i8* fields: kinds, values, first, next */
-        if (!type_env_find_struct(&tenv, "Arena")) {
-            sb_append(&ir.typedefs, "%Arena = type { i8*, i8*, i8*, i8* }\n");
-        }
-
-        /* Ensure malloc is declared for arena-create */
-        if (!sl_contains(&ir.declared_ccalls, "malloc")) {
-            sl_push(&ir.declared_ccalls, "malloc");
-            sb_append(&ir.decls, "declare i8* @malloc(i32)\n");
+        collect_const_evals(top, &const_evals);
+        if (const_evals.count > 0) {
+            timing_push("const-eval");
+            evaluate_const_evals(top, &const_evals);
+            timing_pop();
+            ir.const_evals = &const_evals;
         }
 
-        /* Simplified arena-create: just allocate Arena struct, initialize fields to null.
-         * Stage0 tests don't actually use arenas, so this minimal implementation is sufficient.
-         * For full arena functionality, use stage1 which has proper Weave array implementations.
-         */
-        sb_append(&funcs, "define %Arena* @arena-create(i32 %size) {\n");
-        sb_append(&funcs, "  %raw = call i8* @malloc(i32 32)\n");
-        sb_append(&funcs, "  %a = bitcast i8* %raw to %Arena*\n");
-        sb_append(&funcs, "  %p0 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 0\n");
-        sb_append(&funcs, "  store i8* null, i8** %p0\n");
-        sb_append(&funcs, "  %p1 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 1\n");
-        sb_append(&funcs, "  store i8* null, i8** %p1\n");
-        sb_append(&funcs, "  %p2 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 2\n");
-        sb_append(&funcs, "  store i8* null, i8** %p2\n");
-        sb_append(&funcs, "  %p3 = getelementptr inbounds %Arena, %Arena* %a, i32 0, i32 3\n");
-        sb_append(&funcs, "  store i8* null, i8** %p3\n");
-        sb_append(&funcs, "  ret %Arena* %a\n");
-        sb_append(&funcs, "}\n");
-        
-        /* Declare JIT helper functions for ccall */
-        if (!sl_contains(&ir.declared_ccalls, "llvm_jit_compile_and_get_ptr")) {
-            sl_push(&ir.declared_ccalls, "llvm_jit_compile_and_get_ptr");
-            sb_append(&ir.decls, "declare i32 @llvm_jit_compile_and_get_ptr(i8*, i8*)\n");
-        }
-        if (!sl_contains(&ir.declared_ccalls, "llvm_jit_call_i32_i32_i32")) {
-            sl_push(&ir.declared_ccalls, "llvm_jit_call_i32_i32_i32");
-            sb_append(&ir.decls, "declare i32 @llvm_jit_call_i32_i32_i32(i8*, i8*, i32, i32)\n");
-        }
-        
-        /* Declare LLVM compilation functions for ccall (used by stage1) */
-        if (!sl_contains(&ir.declared_ccalls, "llvm_compile_ir_to_assembly")) {
-            sl_push(&ir.declared_ccalls, "llvm_compile_ir_to_assembly");
-            sb_append(&ir.decls, "declare i32 @llvm_compile_ir_to_assembly(i8*, i8*, i32)\n");
-        }
-        if (!sl_contains(&ir.declared_ccalls, "llvm_compile_ir_to_object")) {
-            sl_push(&ir.declared_ccalls, "llvm_compile_ir_to_object");
-            sb_append(&ir.decls, "declare i32 @llvm_compile_ir_to_object(i8*, i8*, i32)\n");
-        }
-        if (!sl_contains(&ir.declared_ccalls, "llvm_link_objects")) {
-            sl_push(&ir.declared_ccalls, "llvm_link_objects");
-            sb_append(&ir.decls, "declare i32 @llvm_link_objects(i8*, i8*, i8*)\n");
-        }
-
-        /* Ensure built-in functions are registered with correct types before compilation */
-        {
-            /* arena-kind: returns Int32, takes ptr(Arena) and Int32 id */
-            TypeRef *arena_kind_param_types[2];
-            TypeRef *arena_struct = type_struct("Arena");
-            arena_kind_param_types[0] = type_ptr(arena_struct);
-            arena_kind_param_types[1] = type_i32();
-            /* Debug: verify type structure */
-            if (getenv("WEAVEC0_DEBUG_SIGS")) {
-                fprintf(stderr, "[dbg] Registering arena-kind (2nd): param[0] type: kind=%d, pointee_kind=%d\n",
-                        arena_kind_param_types[0]->kind,
-                        arena_kind_param_types[0]->pointee ? arena_kind_param_types[0]->pointee->kind : -1);
-            }
-            fn_table_add(&fns, "arena-kind", type_i32(), 2, arena_kind_param_types);
-        }
+        timing_push("collect types");
+        collect_types(&tenv, &ir, decls);
+        tbaa_init(&ir, &tenv);
+        timing_pop();
+        timing_push("collect signatures");
+        collect_signatures(&tenv, &fns, decls);
+        timing_pop();
+        register_builtin_signatures(&fns);
+        emit_runtime_decls(&ir, &tenv);
+        ir.module_ccalls = ir.declared_ccalls.len;
+        emit_arena_create(&funcs);
+        emit_region_runtime(&funcs);
         
         /* Emit function declarations/forms first */
         for (i = 0; decls && i < decls->count; i++) {
@@ -1231,16 +2207,166 @@ void compile_to_llvm_ir(Node *top, StrBuf *out, int run_tests_mode, StrList *sel
         }
         if (ir.run_tests_mode) {
             /* Emit tests and synthetic main */
+            timing_push("emit tests");
             for (i = 0; decls && i < decls->count; i++) {
                 emit_tests_in(&ir, list_nth(decls, i));
             }
             emit_tests_main(&ir);
+            timing_pop();
         }
+        /* Every site has been substituted. */
+        ir.const_evals = NULL;
+        const_eval_free(&const_evals);
     }
 
-    sb_init(out);
-    if (ir.typedefs.data && ir.typedefs.len) sb_append_n(out, ir.typedefs.data, ir.typedefs.len);
-    if (ir.globals.data && ir.globals.len) sb_append_n(out, ir.globals.data, ir.globals.len);
-    if (ir.decls.data && ir.decls.len) sb_append_n(out, ir.decls.data, ir.decls.len);
-    if (funcs.data && funcs.len) sb_append_n(out, funcs.data, funcs.len);
+    timing_push("assemble module");
+    assemble_module(&ir, &funcs, out);
+    fn_cache_close((FnCache *)ir.fn_cache);
+    timing_pop();
+    if (ir.inline_jit_syms.len > 0) {
+        timing_push("link llvm-jit literals");
+        link_inline_jit_literals(&ir, out);
+        timing_pop();
+    }
+}
+
+static void session_ir_init(CompileSession *cs, IrCtx *ir, StrBuf *funcs) {
+    TypeEnv *tenv = (TypeEnv *)cs->type_env;
+    sb_init(funcs);
+    ir_init(ir, funcs);
+    ir->fn_table = cs->fn_table;
+    ir->type_env = tenv;
+    ir->allow_untested = 1;
+    ir->strict_names = 1;
+    /* Forms are JIT-compiled right away; compile-time and run time coincide. */
+    ir->const_eval_inline = 1;
+    emit_struct_typedefs(tenv, ir);
+    emit_runtime_decls(ir, tenv);
+}
+
+void compile_session_init(CompileSession *cs) {
+    FnTable *fns = (FnTable *)xmalloc(sizeof(FnTable));
+    TypeEnv *tenv = (TypeEnv *)xmalloc(sizeof(TypeEnv));
+    fn_table_init(fns);
+    type_env_init(tenv);
+    register_builtin_signatures(fns);
+    cs->fn_table = fns;
+    cs->type_env = tenv;
+    cs->forms = 0;
+    sl_init(&cs->pending_fns);
+    cs->saved_fns = NULL;
+}
+
+void compile_session_commit(CompileSession *cs) {
+    int i;
+    for (i = 0; i < cs->pending_fns.len; i++) free(cs->pending_fns.items[i]);
+    cs->pending_fns.len = 0;
+    if (cs->saved_fns) {
+        fn_table_free((FnTable *)cs->saved_fns);
+        free(cs->saved_fns);
+        cs->saved_fns = NULL;
+    }
+}
+
+void compile_session_rollback(CompileSession *cs) {
+    FnTable *fns = (FnTable *)cs->fn_table;
+    if (cs->saved_fns) {
+        fn_table_free(fns);
+        *fns = *(FnTable *)cs->saved_fns;
+        free(cs->saved_fns);
+        cs->saved_fns = NULL;
+    }
+    compile_session_commit(cs);
+}
+
+void compile_session_prelude(CompileSession *cs, StrBuf *out) {
+    IrCtx ir;
+    StrBuf funcs;
+    session_ir_init(cs, &ir, &funcs);
+    emit_arena_create(&funcs);
+    emit_region_runtime(&funcs);
+    assemble_module(&ir, &funcs, out);
+}
+
+static void collect_defined_fns(Node *form, StrList *out) {
+    Node *head = list_nth(form, 0);
+    int i;
+    if (!form || form->kind != N_LIST || !head || head->kind != N_ATOM) return;
+    if (is_atom(head, "module") || is_atom(head, "program")) {
+        for (i = 1; i < form->count; i++) collect_defined_fns(list_nth(form, i), out);
+    } else if (is_atom(head, "fn")) {
+        const char *name = atom_text(list_nth(form, 1));
+        if (name && *name) sl_push(out, name);
+    } else if (is_atom(head, "entry")) {
+        sl_push(out, "main");
+    }
+}
+
+/* Declare every known function this module does not define itself; the JIT
+ * resolves them against earlier modules. */
+static void declare_session_fns(IrCtx *ir, FnTable *fns, StrList *defined) {
+    int i, pi;
+    for (i = 0; i < fns->count; i++) {
+        const char *name = fns->names[i];
+        if (sl_contains(defined, name) || sl_contains(&ir->declared_ccalls, name)) continue;
+        sb_append(&ir->decls, "declare ");
+        emit_llvm_type(&ir->decls, fns->ret_types[i]);
+        sb_append(&ir->decls, " @");
+        sb_append(&ir->decls, name);
+        sb_append(&ir->decls, "(");
+        for (pi = 0; pi < fns->param_counts[i]; pi++) {
+            if (pi != 0) sb_append(&ir->decls, ", ");
+            emit_llvm_type(&ir->decls, fns->param_types[i][pi]);
+        }
+        sb_append(&ir->decls, ")\n");
+    }
+}
+
+static int is_definition_form(Node *form) {
+    Node *head = list_nth(form, 0);
+    if (!form || form->kind != N_LIST || !head || head->kind != N_ATOM) return 0;
+    return is_atom(head, "fn") || is_atom(head, "entry") || is_atom(head, "type") ||
+           is_atom(head, "module") || is_atom(head, "program");
+}
+
+int compile_session_form(CompileSession *cs, Node *form, StrBuf *out,
+                         char *thunk_name, size_t thunk_cap, TypeRef **out_type) {
+    FnTable *fns = (FnTable *)cs->fn_table;
+    TypeEnv *tenv = (TypeEnv *)cs->type_env;
+    IrCtx ir;
+    StrBuf funcs;
+    StrList defined;
+    int idx = cs->forms++;
+
+    compile_session_commit(cs);
+    if (is_definition_form(form)) {
+        cs->saved_fns = xmalloc(sizeof(FnTable));
+        fn_table_copy((FnTable *)cs->saved_fns, fns);
+        collect_types_in(tenv, form);
+        collect_signatures_in(tenv, fns, form);
+        collect_defined_fns(form, &cs->pending_fns);
+        session_ir_init(cs, &ir, &funcs);
+        declare_session_fns(&ir, fns, &cs->pending_fns);
+        emit_fn_forms_in(&ir, form);
+        assemble_module(&ir, &funcs, out);
+        return cs->pending_fns.len > 0 ? 1 : 0;
+    }
+    if (is_atom(list_nth(form, 0), "let") && form->count <= 4) {
+        diag_fatal(form->filename, form->line, form->col, "repl-let", "a top-level let binds nothing in the session",
+                   "Wrap the let and the forms that use it in one (do ...), or define a fn.");
+    }
+
+    sl_init(&defined);
+
+    /* Anything else is evaluated: wrap it in a parameterless thunk. */
+    snprintf(thunk_name, thunk_cap, "__weave_repl_%d", idx);
+    sl_push(&defined, thunk_name);
+    session_ir_init(cs, &ir, &funcs);
+    declare_session_fns(&ir, fns, &defined);
+    {
+        TypeRef *ty = emit_value_thunk(&ir, &funcs, thunk_name, form);
+        assemble_module(&ir, &funcs, out);
+        if (out_type) *out_type = ty;
+    }
+    return 2;
 }
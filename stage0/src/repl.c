@@ -0,0 +1,182 @@
+#include "repl.h"
+
+#include "codegen.h"
+#include "fs.h"
+#include "llvm_compile.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static jmp_buf repl_recover;
+
+static void repl_fatal(void) {
+    longjmp(repl_recover, 1);
+}
+
+/* Paren depth of BUF, ignoring string literals and ; comments. Returns a
+ * negative value once a closing paren has no opener. */
+static int paren_depth(const char *buf) {
+    int depth = 0;
+    int in_str = 0;
+    const char *p;
+    for (p = buf; *p; p++) {
+        if (in_str) {
+            if (*p == '\\' && p[1]) p++;
+            else if (*p == '"') in_str = 0;
+        } else if (*p == '"') {
+            in_str = 1;
+        } else if (*p == ';') {
+            while (*p && *p != '\n') p++;
+            if (!*p) break;
+        } else if (*p == '(') {
+            depth++;
+        } else if (*p == ')') {
+            depth--;
+            if (depth < 0) return depth;
+        }
+    }
+    return depth;
+}
+
+/* Read one complete input (balanced parens) into BUF. Returns 0 at EOF. */
+static int read_input(StrBuf *buf, int interactive) {
+    char line[4096];
+    buf->len = 0;
+    if (buf->data) buf->data[0] = '\0';
+    for (;;) {
+        if (interactive) {
+            fputs(buf->len ? "....> " : "weave> ", stdout);
+            fflush(stdout);
+        }
+        if (!fgets(line, sizeof(line), stdin)) return buf->len > 0;
+        sb_append(buf, line);
+        if (paren_depth(buf->data) <= 0) return 1;
+    }
+}
+
+static void print_result(void *fn, TypeRef *ty) {
+    if (ty->kind == TY_I32) {
+        int (*f)(void) = (int (*)(void))fn;
+        printf("=> %d\n", f());
+    } else if (ty->kind == TY_I8PTR) {
+        const char *(*f)(void) = (const char *(*)(void))fn;
+        const char *s = f();
+        if (s) printf("=> \"%s\"\n", s);
+        else printf("=> null\n");
+    } else if (ty->kind == TY_PTR) {
+        void *(*f)(void) = (void *(*)(void))fn;
+        printf("=> %p\n", f());
+    } else if (ty->kind == TY_I64) {
+        long long (*f)(void) = (long long (*)(void))fn;
+        printf("=> %lld\n", f());
+    } else if (ty->kind == TY_F32) {
+        float (*f)(void) = (float (*)(void))fn;
+        printf("=> %g\n", (double)f());
+    } else if (ty->kind == TY_F64) {
+        double (*f)(void) = (double (*)(void))fn;
+        printf("=> %g\n", f());
+    } else {
+        void (*f)(void) = (void (*)(void))fn;
+        f();
+    }
+    fflush(stdout);
+}
+
+static void eval_form(CompileSession *cs, LLVMJITSessionRef jit, Node *form) {
+    StrBuf mod;
+    char thunk[64];
+    TypeRef *ty = NULL;
+    int kind;
+    int i;
+    void *fn;
+
+    sb_init(&mod);
+    kind = compile_session_form(cs, form, &mod, thunk, sizeof(thunk), &ty);
+    if (kind == 0) {
+        compile_session_commit(cs);
+        free(mod.data);
+        return;
+    }
+    if (llvm_jit_add_module_layer(jit, mod.data ? mod.data : "", mod.len) != 0) {
+        fprintf(stderr, "weavec: JIT rejected the module (set WEAVEC0_DEBUG_JIT=1 for details)\n");
+        compile_session_rollback(cs);
+        free(mod.data);
+        return;
+    }
+    free(mod.data);
+    if (kind == 1) {
+        /* The JIT links lazily: resolve the new functions now, so one that
+         * calls something undefined is dropped here instead of failing
+         * every later input that mentions it. */
+        for (i = 0; i < cs->pending_fns.len; i++) {
+            if (!llvm_jit_lookup_function(jit, cs->pending_fns.items[i])) {
+                fprintf(stderr, "weavec: '%s' could not be linked; the definition was dropped\n",
+                        cs->pending_fns.items[i]);
+                llvm_jit_drop_last_layer(jit);
+                compile_session_rollback(cs);
+                return;
+            }
+        }
+        compile_session_commit(cs);
+        return;
+    }
+    fn = llvm_jit_lookup_function(jit, thunk);
+    if (!fn) {
+        fprintf(stderr, "weavec: JIT lookup of %s failed\n", thunk);
+        llvm_jit_drop_last_layer(jit);
+        return;
+    }
+    print_result(fn, ty);
+}
+
+int repl_main(StrList *include_dirs, int opt_level) {
+    CompileSession cs;
+    LLVMJITSessionRef jit;
+    StrBuf input;
+    StrBuf prelude;
+    StrList included;
+    int interactive = isatty(0);
+
+    jit = llvm_jit_create_session_ex(opt_level, NULL);
+    if (!jit) {
+        fprintf(stderr, "weavec: failed to create JIT session\n");
+        return 1;
+    }
+    compile_session_init(&cs);
+    sb_init(&prelude);
+    compile_session_prelude(&cs, &prelude);
+    if (llvm_jit_add_module(jit, prelude.data ? prelude.data : "", prelude.len) != 0) {
+        fprintf(stderr, "weavec: failed to load REPL prelude\n");
+        llvm_jit_dispose_session(jit);
+        return 1;
+    }
+    free(prelude.data);
+
+    sl_init(&included);
+    sb_init(&input);
+    set_fatal_handler(repl_fatal);
+    while (read_input(&input, interactive)) {
+        int i;
+        Node *top;
+        if (setjmp(repl_recover) != 0) {
+            /* The diagnostic is already printed; drop the rest of this input
+             * and any definition it left half-registered. */
+            compile_session_rollback(&cs);
+            continue;
+        }
+        top = parse_top(input.data, "<repl>");
+        merge_includes(top, &included, ".", include_dirs, "<repl>");
+        for (i = 0; i < top->count; i++) {
+            eval_form(&cs, jit, list_nth(top, i));
+        }
+    }
+    set_fatal_handler(NULL);
+    if (interactive) fputc('\n', stdout);
+
+    free(input.data);
+    llvm_jit_dispose_session(jit);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "result_cache.h"
+
+#include "fs.h"
+#include "hash.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int cache_hits = 0;
+static int cache_misses = 0;
+
+void result_cache_stats(int *hits, int *misses) {
+    if (hits) *hits = cache_hits;
+    if (misses) *misses = cache_misses;
+}
+
+static char *entry_path(const char *dir, const StrBuf *key) {
+    char hex[17];
+    StrBuf path;
+    hash_hex(hash_bytes(key->data, key->len, HASH_SEED), hex);
+    sb_init(&path);
+    sb_append(&path, dir);
+    sb_append(&path, "/");
+    sb_append(&path, hex);
+    sb_append(&path, ".out");
+    return path.data;
+}
+
+/* Reads the key at the start of an entry (uint64 length, then the bytes)
+ * and compares it with KEY, leaving IN at the output that follows. Returns
+ * 1 when they match. */
+static int entry_key_matches(int in, const StrBuf *key) {
+    uint64_t len;
+    char buf[65536];
+    size_t off = 0;
+
+    if (read_full(in, &len, sizeof(len)) != 0 || len != (uint64_t)key->len) return 0;
+    while (off < key->len) {
+        size_t n = key->len - off < sizeof(buf) ? key->len - off : sizeof(buf);
+        if (read_full(in, buf, n) != 0 || memcmp(buf, key->data + off, n) != 0) return 0;
+        off += n;
+    }
+    return 1;
+}
+
+/* Copies the rest of the open file IN to OUT, giving a regular OUT IN's
+ * permissions (so cached executables stay executable). Returns 0 on success. */
+static int copy_fd(int in, int out) {
+    struct stat st;
+    struct stat dst_st;
+    char buf[65536];
+    ssize_t n = 0;
+
+    if (fstat(in, &st) != 0) return -1;
+    if (fstat(out, &dst_st) == 0 && S_ISREG(dst_st.st_mode) && fchmod(out, st.st_mode & 0777) != 0) return -1;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        char *p = buf;
+        while (n > 0) {
+            ssize_t w = write(out, p, (size_t)n);
+            if (w <= 0) return -1;
+            p += w;
+            n -= w;
+        }
+    }
+    return n < 0 ? -1 : 0;
+}
+
+typedef struct {
+    const StrBuf *key;
+    const char *output;
+} StoredOutput;
+
+/* write_file_atomic writer: the key, then a copy of the output file. */
+static int write_entry(FILE *f, void *ctx) {
+    StoredOutput *e = (StoredOutput *)ctx;
+    uint64_t len = (uint64_t)e->key->len;
+    int in;
+    int rc;
+
+    if (fwrite(&len, sizeof(len), 1, f) != 1) return -1;
+    if (e->key->len > 0 && fwrite(e->key->data, e->key->len, 1, f) != 1) return -1;
+    if (fflush(f) != 0) return -1;
+    in = open(e->output, O_RDONLY);
+    if (in < 0) return -1;
+    rc = copy_fd(in, fileno(f));
+    close(in);
+    return rc;
+}
+
+int result_cache_fetch(const char *dir, const StrBuf *key, const char *output) {
+    char *file = entry_path(dir, key);
+    int in = open(file, O_RDONLY);
+    int ok = 0;
+
+    free(file);
+    /* OUTPUT is only opened (and truncated) once the key is known to match. */
+    if (in >= 0 && entry_key_matches(in, key)) {
+        int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (out >= 0) {
+            ok = copy_fd(in, out) == 0;
+            if (close(out) != 0) ok = 0;
+        }
+    }
+    if (in >= 0) close(in);
+    __sync_fetch_and_add(ok ? &cache_hits : &cache_misses, 1);
+    return ok;
+}
+
+void result_cache_store(const char *dir, const StrBuf *key, const char *output) {
+    StoredOutput e;
+    char *file;
+    struct stat st;
+
+    /* Only regular files can be copied back (not e.g. /dev/stdout). */
+    if (stat(output, &st) != 0 || !S_ISREG(st.st_mode)) return;
+    e.key = key;
+    e.output = output;
+    file = entry_path(dir, key);
+    write_file_atomic(file, write_entry, &e);
+    free(file);
+}
@@ -0,0 +1,356 @@
+#include "server.h"
+
+#include "ast_cache.h"
+#include "fs.h"
+#include "timing.h"
+
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/* Wire format, client to server: a 4-byte magic sent together with the
+ * client's stdout/stderr (SCM_RIGHTS), then uint32 argc, uint32 envc,
+ * uint32 payload length and the payload: cwd, argv[] and environ[] as
+ * NUL-terminated strings. Server to client: the exit code as an int32. */
+static const char SERVER_MAGIC[4] = {'W', 'V', 'C', '1'};
+
+static int write_full(int fd, const void *buf, size_t n) {
+    const char *p = (const char *)buf;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int make_address(const char *socket_path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "weavec: socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return 0;
+}
+
+/* ---- client ---- */
+
+static void push_strings(StrBuf *payload, int count, char **strs) {
+    int i;
+    for (i = 0; i < count; i++) sb_append_n(payload, strs[i], strlen(strs[i]) + 1);
+}
+
+int server_client_run(const char *socket_path, int argc, char **argv) {
+    struct sockaddr_un addr;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    int fds[2] = {1, 2};
+    uint32_t header[3];
+    int envc = 0;
+    char *cwd;
+    StrBuf payload;
+    int32_t status;
+    int sock;
+
+    if (make_address(socket_path, &addr) != 0) return -1;
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = (void *)SERVER_MAGIC;
+    iov.iov_len = sizeof(SERVER_MAGIC);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    fflush(stdout);
+    fflush(stderr);
+    if (sendmsg(sock, &msg, 0) != (ssize_t)sizeof(SERVER_MAGIC)) {
+        close(sock);
+        return -1;
+    }
+
+    while (environ[envc]) envc++;
+    cwd = getcwd(NULL, 0);
+    sb_init(&payload);
+    sb_append_n(&payload, cwd ? cwd : ".", strlen(cwd ? cwd : ".") + 1);
+    free(cwd);
+    push_strings(&payload, argc, argv);
+    push_strings(&payload, envc, environ);
+    header[0] = (uint32_t)argc;
+    header[1] = (uint32_t)envc;
+    header[2] = (uint32_t)payload.len;
+    if (write_full(sock, header, sizeof(header)) != 0 ||
+        write_full(sock, payload.data, payload.len) != 0) {
+        free(payload.data);
+        close(sock);
+        return -1;
+    }
+    free(payload.data);
+
+    /* EOF without a status means the worker died: report failure. */
+    if (read_full(sock, &status, sizeof(status)) != 0) status = 1;
+    close(sock);
+    return (int)status;
+}
+
+/* ---- server ---- */
+
+typedef struct {
+    int out_fd;
+    int err_fd;
+    int argc;
+    int envc;
+    char *payload;
+    char *cwd;
+    char **argv;
+    char **envp;
+} ServerRequest;
+
+static int receive_request(int conn, ServerRequest *req) {
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    char magic[sizeof(SERVER_MAGIC)];
+    uint32_t header[3];
+    char *p;
+    char *end;
+    int i;
+
+    memset(req, 0, sizeof(*req));
+    req->out_fd = req->err_fd = -1;
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = magic;
+    iov.iov_len = sizeof(magic);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    if (recvmsg(conn, &msg, 0) != (ssize_t)sizeof(magic)) return -1;
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int))) {
+            int fds[2];
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+            req->out_fd = fds[0];
+            req->err_fd = fds[1];
+        }
+    }
+    if (req->out_fd < 0 || memcmp(magic, SERVER_MAGIC, sizeof(magic)) != 0) return -1;
+    if (read_full(conn, header, sizeof(header)) != 0) return -1;
+
+    req->argc = (int)header[0];
+    req->envc = (int)header[1];
+    req->payload = (char *)xmalloc((size_t)header[2] + 1);
+    if (read_full(conn, req->payload, header[2]) != 0) return -1;
+    req->payload[header[2]] = '\0';
+
+    /* Split the payload; every string must be NUL-terminated inside it. */
+    req->argv = (char **)xmalloc((size_t)(req->argc + 1) * sizeof(char *));
+    req->envp = (char **)xmalloc((size_t)(req->envc + 1) * sizeof(char *));
+    p = req->payload;
+    end = req->payload + header[2];
+    for (i = -1; i < req->argc + req->envc; i++) {
+        size_t n = strnlen(p, (size_t)(end - p));
+        if (p + n >= end) return -1;
+        if (i < 0) req->cwd = p;
+        else if (i < req->argc) req->argv[i] = p;
+        else req->envp[i - req->argc] = p;
+        p += n + 1;
+    }
+    req->argv[req->argc] = NULL;
+    req->envp[req->envc] = NULL;
+    return req->argc > 0 ? 0 : -1;
+}
+
+static void release_request(ServerRequest *req) {
+    if (req->out_fd >= 0) close(req->out_fd);
+    if (req->err_fd >= 0) close(req->err_fd);
+    free(req->payload);
+    free(req->argv);
+    free(req->envp);
+}
+
+static void apply_environment(char **envp) {
+    int i;
+    clearenv();
+    for (i = 0; envp[i]; i++) putenv(envp[i]);
+}
+
+static jmp_buf prefetch_recover;
+
+static void prefetch_fatal(void) {
+    longjmp(prefetch_recover, 1);
+}
+
+/* Runs PREFETCH in the server with stderr captured. Its diagnostics (e.g.
+ * long-file warnings from a cold parse) are passed on to the client only
+ * when it succeeds; on failure the worker reparses and reports them. */
+static void run_prefetch(ServerCommandFn prefetch, ServerRequest *req) {
+    FILE *capture = tmpfile();
+    int saved_err = dup(2);
+    volatile int ok = 0;
+
+    fflush(stderr);
+    if (capture) dup2(fileno(capture), 2);
+    set_fatal_handler(prefetch_fatal);
+    if (setjmp(prefetch_recover) == 0) {
+        prefetch(req->argc, req->argv);
+        ok = 1;
+    }
+    set_fatal_handler(NULL);
+    fflush(stderr);
+    dup2(saved_err, 2);
+    close(saved_err);
+    if (capture) {
+        if (ok) {
+            char buf[4096];
+            size_t n;
+            rewind(capture);
+            while ((n = fread(buf, 1, sizeof(buf), capture)) > 0) {
+                if (write_full(req->err_fd, buf, n) != 0) break;
+            }
+        }
+        fclose(capture);
+    }
+}
+
+/* Only the server's own user may submit compiles: a request runs with the
+ * server's privileges and writes wherever its argv says. */
+static int peer_is_owner(int conn) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || len != sizeof(cred)) return 0;
+    return cred.uid == getuid();
+}
+
+static int worker_conn = -1;
+
+static void worker_fatal(void) {
+    int32_t status = 1;
+    /* _exit skips atexit: finish a --trace here. */
+    timing_unwind();
+    timing_trace_close();
+    fflush(stdout);
+    fflush(stderr);
+    write_full(worker_conn, &status, sizeof(status));
+    _exit(1);
+}
+
+static void run_worker(ServerCommandFn compile, ServerRequest *req, int conn) {
+    int32_t status;
+    signal(SIGPIPE, SIG_DFL);
+    dup2(req->out_fd, 1);
+    dup2(req->err_fd, 2);
+    worker_conn = conn;
+    set_fatal_handler(worker_fatal);
+    status = compile(req->argc, req->argv);
+    fflush(stdout);
+    fflush(stderr);
+    write_full(conn, &status, sizeof(status));
+    _exit(status);
+}
+
+int server_main(const char *socket_path, ServerCommandFn compile, ServerCommandFn prefetch) {
+    struct sockaddr_un addr;
+    int listener;
+    char *server_cwd;
+
+    if (make_address(socket_path, &addr) != 0) return 1;
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("weavec: socket");
+        return 1;
+    }
+    unlink(socket_path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        fprintf(stderr, "weavec: cannot listen on %s: %s\n", socket_path, strerror(errno));
+        close(listener);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    ast_cache_enable(1);
+    server_cwd = getcwd(NULL, 0);
+
+    for (;;) {
+        ServerRequest req;
+        pid_t pid;
+        int conn;
+
+        while (waitpid(-1, NULL, WNOHANG) > 0) {
+        }
+        conn = accept(listener, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            perror("weavec: accept");
+            break;
+        }
+        if (!peer_is_owner(conn)) {
+            fprintf(stderr, "weavec: rejected connection from another user\n");
+            close(conn);
+            continue;
+        }
+        if (receive_request(conn, &req) != 0 || chdir(req.cwd) != 0) {
+            int32_t status = 1;
+            write_full(conn, &status, sizeof(status));
+            release_request(&req);
+            close(conn);
+            continue;
+        }
+        run_prefetch(prefetch, &req);
+
+        pid = fork();
+        if (pid == 0) {
+            close(listener);
+            apply_environment(req.envp);
+            run_worker(compile, &req, conn);
+        }
+        if (pid < 0) {
+            int32_t status = 1;
+            perror("weavec: fork");
+            write_full(conn, &status, sizeof(status));
+        }
+        release_request(&req);
+        close(conn);
+        if (server_cwd && chdir(server_cwd) != 0) {
+            /* Paths are resolved per request; a vanished cwd is harmless. */
+        }
+    }
+
+    free(server_cwd);
+    close(listener);
+    unlink(socket_path);
+    return 1;
+}
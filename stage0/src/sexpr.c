@@ -27,6 +27,44 @@ void node_list_push(Node *list, Node *child) {
     list->items[list->count++] = child;
 }
 
+Node *node_clone(const Node *n) {
+    Node *c;
+    int i;
+    if (!n) return NULL;
+    c = (Node *)xmalloc(sizeof(Node));
+    *c = *n;
+    if (n->kind == N_LIST) {
+        c->items = n->count > 0 ? (Node **)xmalloc((size_t)n->count * sizeof(Node *)) : NULL;
+        c->cap = n->count;
+        for (i = 0; i < n->count; i++) c->items[i] = node_clone(n->items[i]);
+    }
+    return c;
+}
+
+static void node_key_in(const Node *n, const char *parent_file, StrBuf *out) {
+    int loc[4];
+    int i;
+    if (!n) {
+        sb_append_n(out, "", 1);
+        return;
+    }
+    loc[0] = (int)n->kind;
+    loc[1] = n->line;
+    loc[2] = n->col;
+    loc[3] = n->kind == N_LIST ? n->count : -1;
+    sb_append_n(out, (const char *)loc, sizeof(loc));
+    if (n->text) sb_append_n(out, n->text, strlen(n->text) + 1);
+    /* Children almost always share their parent's file. */
+    if (n->filename && (!parent_file || strcmp(n->filename, parent_file) != 0)) {
+        sb_append_n(out, n->filename, strlen(n->filename) + 1);
+    }
+    for (i = 0; n->kind == N_LIST && i < n->count; i++) node_key_in(n->items[i], n->filename, out);
+}
+
+void node_key(const Node *n, StrBuf *out) {
+    node_key_in(n, NULL, out);
+}
+
 static Node *parse_list(Lexer *lx, ParseCtx *ctx, int start_line, int start_col) {
     Node *list = node_new(N_LIST);
     list->filename = ctx && ctx->filename ? xstrdup(ctx->filename) : NULL;
@@ -3,8 +3,8 @@
 #include <stdio.h>
 #include <string.h>
 
-/* Global statistics instance */
-CompilerStats compiler_stats = {0};
+/* Statistics instance; per thread so parallel compiles (-j) count separately */
+__thread CompilerStats compiler_stats = {0};
 
 void stats_init(void) {
     memset(&compiler_stats, 0, sizeof(compiler_stats));
@@ -21,6 +21,8 @@ void stats_print(void) {
     printf("  Intrinsics:        %d\n", compiler_stats.emitted_intrinsics);
     printf("  GEP:               %d\n", compiler_stats.emitted_gep);
     printf("  Bitcast:           %d\n", compiler_stats.emitted_bitcast);
+    printf("  Cast:              %d\n", compiler_stats.emitted_cast);
+    printf("  Vector Ops:        %d\n", compiler_stats.emitted_vec_ops);
     printf("  Ptr-Add:           %d\n", compiler_stats.emitted_ptr_add);
     printf("  Get-Field:         %d\n", compiler_stats.emitted_get_field);
     printf("\n");
@@ -45,12 +47,16 @@ void stats_print(void) {
     printf("Logical:\n");
     printf("  &&:                %d\n", compiler_stats.emitted_and);
     printf("  ||:                %d\n", compiler_stats.emitted_or);
+    printf("  Short-Circuit:     %d\n", compiler_stats.short_circuits);
     printf("\n");
     
     printf("Memory:\n");
     printf("  Load:              %d\n", compiler_stats.emitted_load);
     printf("  Store:             %d\n", compiler_stats.emitted_store);
     printf("  Alloca:            %d\n", compiler_stats.emitted_alloca);
+    printf("  SSA Bindings:      %d\n", compiler_stats.ssa_bindings);
+    printf("  Stack Makes:       %d\n", compiler_stats.stack_makes);
+    printf("  Region Makes:      %d\n", compiler_stats.region_makes);
     printf("\n");
     
     printf("Functions:\n");
@@ -67,11 +73,17 @@ void stats_print(void) {
     printf("Control Flow:\n");
     printf("  Branches:          %d\n", compiler_stats.emitted_branches);
     printf("  Returns:           %d\n", compiler_stats.emitted_returns);
+    printf("  Counted Loops:     %d\n", compiler_stats.counted_loops);
     printf("\n");
     
     printf("Other:\n");
     printf("  String Literals:   %d\n", compiler_stats.emitted_string_lits);
     printf("  Constants:        %d\n", compiler_stats.emitted_constants);
     printf("\n");
+
+    printf("Folding:\n");
+    printf("  Folded Ops:        %d\n", compiler_stats.folded_constants);
+    printf("  Dead Branches:     %d\n", compiler_stats.eliminated_branches);
+    printf("\n");
 }
 
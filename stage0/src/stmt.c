@@ -1,9 +1,16 @@
 #include "codegen.h"
+#include "diagnostics.h"
+#include "stats.h"
+#include "tbaa.h"
 #include "type_env.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+
 static void emit_i32_value(StrBuf *out, Value v) {
     if (v.kind == 0) sb_printf_i32(out, v.const_i32);
     else if (v.kind == 1) ir_emit_temp(out, v.temp);
+    else if (v.kind == 3) emit_const_literal(out, v);
     else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
@@ -13,12 +20,353 @@ static void emit_i32_value(StrBuf *out, Value v) {
 static void emit_value(StrBuf *out, Value v) {
     if (v.kind == 0) sb_printf_i32(out, v.const_i32);
     else if (v.kind == 1) ir_emit_temp(out, v.temp);
+    else if (v.kind == 3) emit_const_literal(out, v);
     else {
         sb_append(out, "%");
         sb_append(out, v.ssa_name ? v.ssa_name : "");
     }
 }
 
+/* A let can be kept in SSA form when its value already has the declared
+ * scalar type (or is an Int32 literal); anything else goes through the
+ * alloca, whose store accepts what it always has. */
+static int binds_as_value(Value v, TypeRef *ty) {
+    if (!ty || !v.type) return 0;
+    if (ty->kind != TY_I32 && ty->kind != TY_I8PTR && ty->kind != TY_PTR && ty->kind != TY_I64 &&
+        ty->kind != TY_VEC && !type_is_float(ty))
+        return 0;
+    if (v.kind == 0) return ty->kind == TY_I32 && v.type->kind == TY_I32;
+    if (v.kind == 3) return 0;
+    if (v.kind == 2 && !v.ssa_name) return 0;
+    return type_eq(v.type, ty);
+}
+
+/* Int64, float and vector slots get their value checked and literals
+ * converted (ensure_type); other types, and pointers a let loads through,
+ * keep the unchecked stores and returns they always had. */
+static Value convert_numeric(IrCtx *ir, Value v, TypeRef *ty, const char *ctx, Node *at) {
+    if (ty && (ty->kind == TY_I64 || ty->kind == TY_VEC || type_is_float(ty)) && !is_pointer_type(v.type)) {
+        return ensure_type_ctx_at(ir, v, ty, ctx, at);
+    }
+    return v;
+}
+
+/* ---- (for i start end [step] [(vectorize [N])] [(unroll [N])] stmt...) ---- */
+
+static void for_error(Node *at, const char *msg, const char *hint) {
+    diag_fatal(at && at->filename ? at->filename : NULL, at ? at->line : 0, at ? at->col : 0, "syntax-error", msg,
+               hint);
+}
+
+/* (set NAME ...) or (addr NAME) anywhere in N. */
+static int assigns_name(Node *n, const char *name) {
+    int i;
+    if (!n || n->kind != N_LIST) return 0;
+    if ((is_atom(list_nth(n, 0), "set") || is_atom(list_nth(n, 0), "addr")) && is_atom(list_nth(n, 1), name)) {
+        return 1;
+    }
+    for (i = 0; i < n->count; i++) {
+        if (assigns_name(n->items[i], name)) return 1;
+    }
+    return 0;
+}
+
+/* The optional step of a for loop: a literal, or arithmetic on literals
+ * such as (- 0 1). Any other list is the first body statement. */
+static int is_for_step(Node *n) {
+    Node *h = list_nth(n, 0);
+    if (!n) return 0;
+    if (n->kind == N_ATOM) return 1;
+    return n->kind == N_LIST && (is_atom(h, "+") || is_atom(h, "-") || is_atom(h, "*"));
+}
+
+/* N of a (vectorize N) / (unroll N) hint: 0 when absent, else a positive
+ * literal. */
+static int loop_hint_count(Node *hint) {
+    Node *n = list_nth(hint, 1);
+    char *endp;
+    long v;
+    if (hint->count == 1) return 0;
+    v = n && n->kind == N_ATOM && n->text ? strtol(n->text, &endp, 10) : 0;
+    if (hint->count > 2 || v <= 0 || v > 1024 || *endp != '\0') {
+        for_error(hint, "loop hint takes one positive Int32 literal", "Write (vectorize 4) or (unroll 8).");
+    }
+    return (int)v;
+}
+
+static void loop_property(IrCtx *ir, StrBuf *props, StrBuf *refs, const char *name, const char *value) {
+    int id = ++ir->metadata_ids;
+    sb_append(refs, ", !");
+    sb_printf_i32(refs, id);
+    sb_append(props, "!");
+    sb_printf_i32(props, id);
+    sb_append(props, " = !{!\"");
+    sb_append(props, name);
+    sb_append(props, "\"");
+    if (value) {
+        sb_append(props, ", ");
+        sb_append(props, value);
+    }
+    sb_append(props, "}\n");
+}
+
+/* The !llvm.loop node carrying VEC and UNROLL (either may be NULL).
+ * Without a count a hint just enables the transform; a count of 1 turns
+ * it off. */
+static int loop_metadata(IrCtx *ir, Node *vec, Node *unroll) {
+    StrBuf props, refs;
+    char num[32];
+    int id = ir->metadata_ids;
+    sb_init(&props);
+    sb_init(&refs);
+    if (vec) {
+        int n = loop_hint_count(vec);
+        if (n != 1) loop_property(ir, &props, &refs, "llvm.loop.vectorize.enable", "i1 true");
+        if (n > 0) {
+            snprintf(num, sizeof(num), "i32 %d", n);
+            loop_property(ir, &props, &refs, "llvm.loop.vectorize.width", num);
+        }
+    }
+    if (unroll) {
+        int n = loop_hint_count(unroll);
+        if (n == 0) loop_property(ir, &props, &refs, "llvm.loop.unroll.enable", NULL);
+        else if (n == 1) loop_property(ir, &props, &refs, "llvm.loop.unroll.disable", NULL);
+        else {
+            snprintf(num, sizeof(num), "i32 %d", n);
+            loop_property(ir, &props, &refs, "llvm.loop.unroll.count", num);
+        }
+    }
+    ir->metadata_ids++;
+    sb_append(&ir->metadata, "!");
+    sb_printf_i32(&ir->metadata, id);
+    sb_append(&ir->metadata, " = distinct !{!");
+    sb_printf_i32(&ir->metadata, id);
+    if (refs.len) sb_append_n(&ir->metadata, refs.data, refs.len);
+    sb_append(&ir->metadata, "}\n");
+    if (props.len) sb_append_n(&ir->metadata, props.data, props.len);
+    free(props.data);
+    free(refs.data);
+    return id;
+}
+
+/* Emits "OP i32 A, B" and returns its result. */
+static Value emit_i32_op(IrCtx *ir, const char *op, Value a, Value b) {
+    Value r = {0};
+    r.type = type_i32();
+    r.kind = 1;
+    r.temp = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, r.temp);
+    sb_append(ir->out, " = ");
+    sb_append(ir->out, op);
+    sb_append(ir->out, " i32 ");
+    emit_i32_value(ir->out, a);
+    sb_append(ir->out, ", ");
+    emit_i32_value(ir->out, b);
+    sb_append(ir->out, "\n");
+    return r;
+}
+
+/* Emits the trip count of a loop from START towards END by STEP (|STEP| >
+ * 1) and returns its temp. The distance is taken unsigned, so neither it
+ * nor the division can overflow wherever the bounds sit. */
+static int emit_for_trip_count(IrCtx *ir, Value startv, Value endv, int step) {
+    Value one = {0}, mag = {0};
+    Value dist, whole, enters;
+    int trips;
+    one.const_i32 = 1;
+    mag.const_i32 = step > 0 ? step : (int)(0u - (unsigned)step);
+    dist = step > 0 ? emit_i32_op(ir, "sub", endv, startv) : emit_i32_op(ir, "sub", startv, endv);
+    whole = emit_i32_op(ir, "udiv", emit_i32_op(ir, "sub", dist, one), mag);
+    whole = emit_i32_op(ir, "add nuw", whole, one);
+    enters = emit_i32_op(ir, step > 0 ? "icmp slt" : "icmp sgt", startv, endv);
+    trips = ir_fresh_temp(ir);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, trips);
+    sb_append(ir->out, " = select i1 ");
+    ir_emit_temp(ir->out, enters.temp);
+    sb_append(ir->out, ", i32 ");
+    ir_emit_temp(ir->out, whole.temp);
+    sb_append(ir->out, ", i32 0\n");
+    return trips;
+}
+
+/* Lowers a counted loop to the shape LLVM's loop passes expect: bounds
+ * evaluated once in a preheader, the counter a phi in the header, one
+ * latch that steps it. The counter is bound as an SSA value, so the body
+ * may read it but not set it. */
+static int cg_for(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type) {
+    Node *var = list_nth(stmt, 1);
+    const char *name = atom_text(var);
+    Node *vec = NULL;
+    Node *unroll = NULL;
+    Value startv, endv;
+    int step = 1;
+    int first = 4;
+    int pre_l, head_l, body_l, latch_l, end_l;
+    int iv, next, tcond;
+    int trips = 0, k = 0, knext = 0;
+    int scope;
+    int i;
+    char operand[32];
+
+    if (!name || !*name || stmt->count < 4) {
+        for_error(stmt, "malformed for loop", "Write (for i start end [step] stmt...).");
+    }
+    startv = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(stmt, 2)), type_i32(), "for-start", list_nth(stmt, 2));
+    endv = ensure_type_ctx_at(ir, cg_expr(ir, env, list_nth(stmt, 3)), type_i32(), "for-end", list_nth(stmt, 3));
+    if (is_for_step(list_nth(stmt, 4))) {
+        Value sv = cg_expr(ir, env, list_nth(stmt, 4));
+        if (sv.kind != 0 || sv.const_i32 == 0) {
+            for_error(list_nth(stmt, 4), "for step must be a non-zero Int32 constant",
+                      "The step's sign picks the exit test (< or >).");
+        }
+        step = sv.const_i32;
+        first = 5;
+    }
+    for (; first < stmt->count; first++) {
+        Node *h = list_nth(list_nth(stmt, first), 0);
+        if (is_atom(h, "vectorize")) vec = list_nth(stmt, first);
+        else if (is_atom(h, "unroll")) unroll = list_nth(stmt, first);
+        else break;
+    }
+    for (i = first; i < stmt->count; i++) {
+        if (assigns_name(list_nth(stmt, i), name)) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "for loop counter '%s' cannot be set or address-taken", name);
+            for_error(list_nth(stmt, i), msg, "Use a while loop for a counter the body changes.");
+        }
+    }
+    STAT_INC(counted_loops);
+
+    if (startv.kind == 0 && endv.kind == 0 &&
+        (step > 0 ? startv.const_i32 >= endv.const_i32 : startv.const_i32 <= endv.const_i32)) {
+        /* Constant bounds that never enter the loop. */
+        STAT_INC(eliminated_branches);
+        return 0;
+    }
+
+    pre_l = ir_fresh_label(ir);
+    head_l = ir_fresh_label(ir);
+    body_l = ir_fresh_label(ir);
+    latch_l = ir_fresh_label(ir);
+    end_l = ir_fresh_label(ir);
+    iv = ir_fresh_temp(ir);
+    next = ir_fresh_temp(ir);
+    tcond = ir_fresh_temp(ir);
+
+    /* The phi needs a named predecessor: give the loop its own preheader. */
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, pre_l);
+    sb_append(ir->out, "\n");
+    ir_emit_label_def(ir->out, pre_l);
+    if (step != 1 && step != -1) {
+        trips = emit_for_trip_count(ir, startv, endv, step);
+        k = ir_fresh_temp(ir);
+        knext = ir_fresh_temp(ir);
+    }
+    sb_append(ir->out, "  br label ");
+    ir_emit_label_ref(ir->out, head_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, head_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, iv);
+    sb_append(ir->out, " = phi i32 [ ");
+    emit_i32_value(ir->out, startv);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, pre_l);
+    sb_append(ir->out, " ], [ ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, ", ");
+    ir_emit_label_ref(ir->out, latch_l);
+    sb_append(ir->out, " ]\n  ");
+    if (trips) {
+        ir_emit_temp(ir->out, k);
+        sb_append(ir->out, " = phi i32 [ 0, ");
+        ir_emit_label_ref(ir->out, pre_l);
+        sb_append(ir->out, " ], [ ");
+        ir_emit_temp(ir->out, knext);
+        sb_append(ir->out, ", ");
+        ir_emit_label_ref(ir->out, latch_l);
+        sb_append(ir->out, " ]\n  ");
+        ir_emit_temp(ir->out, tcond);
+        sb_append(ir->out, " = icmp ult i32 ");
+        ir_emit_temp(ir->out, k);
+        sb_append(ir->out, ", ");
+        ir_emit_temp(ir->out, trips);
+    } else {
+        ir_emit_temp(ir->out, tcond);
+        sb_append(ir->out, step > 0 ? " = icmp slt i32 " : " = icmp sgt i32 ");
+        ir_emit_temp(ir->out, iv);
+        sb_append(ir->out, ", ");
+        emit_i32_value(ir->out, endv);
+    }
+    sb_append(ir->out, "\n  br i1 ");
+    ir_emit_temp(ir->out, tcond);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, body_l);
+    sb_append(ir->out, ", label ");
+    ir_emit_label_ref(ir->out, end_l);
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, body_l);
+    scope = env_scope_begin(env);
+    env_add_local(env, name, type_i32());
+    snprintf(operand, sizeof(operand), "t%d", iv);
+    env_bind_value(env, name, operand);
+    for (i = first; i < stmt->count; i++) {
+        if (cg_stmt(ir, env, list_nth(stmt, i), ret_type, NULL)) break;
+    }
+    env_scope_end(env, scope);
+    if (i == stmt->count) {
+        sb_append(ir->out, "  br label ");
+        ir_emit_label_ref(ir->out, latch_l);
+        sb_append(ir->out, "\n");
+    }
+
+    /* A unit step cannot pass END without reaching it first, so it never
+     * overflows. A larger one may wrap on the last trip, which is harmless:
+     * the trip count, not the counter, ends those loops. */
+    ir_emit_label_def(ir->out, latch_l);
+    sb_append(ir->out, "  ");
+    ir_emit_temp(ir->out, next);
+    sb_append(ir->out, trips ? " = add i32 " : " = add nsw i32 ");
+    ir_emit_temp(ir->out, iv);
+    sb_append(ir->out, ", ");
+    sb_printf_i32(ir->out, step);
+    if (trips) {
+        sb_append(ir->out, "\n  ");
+        ir_emit_temp(ir->out, knext);
+        sb_append(ir->out, " = add nuw i32 ");
+        ir_emit_temp(ir->out, k);
+        sb_append(ir->out, ", 1");
+    }
+    sb_append(ir->out, "\n  br label ");
+    ir_emit_label_ref(ir->out, head_l);
+    if (vec || unroll) {
+        sb_append(ir->out, ", !llvm.loop !");
+        sb_printf_i32(ir->out, loop_metadata(ir, vec, unroll));
+    }
+    sb_append(ir->out, "\n");
+
+    ir_emit_label_def(ir->out, end_l);
+    return 0;
+}
+
+/* Statements nested in (let name type init stmt...). */
+static int cg_let_body(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_last) {
+    Value nested_last = {0};
+    int i;
+    for (i = 4; i < stmt->count; i++) {
+        Value tmp = {0};
+        if (cg_stmt(ir, env, list_nth(stmt, i), ret_type, &tmp)) return 1;
+        if (tmp.type) nested_last = tmp;
+    }
+    if (out_last && nested_last.type) *out_last = nested_last;
+    return 0;
+}
+
 int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_last) {
     Node *head;
     Value none = {0};
@@ -34,7 +382,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
     }
 
     if (is_atom(head, "return")) {
-        Value v = cg_expr(ir, env, list_nth(stmt, 1));
+        Value v = convert_numeric(ir, cg_expr(ir, env, list_nth(stmt, 1)), ret_type, "return", stmt);
         if (out_last) *out_last = v;
         sb_append(ir->out, "  ret ");
         if (ret_type && ret_type->kind == TY_VOID) {
@@ -62,6 +410,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         emit_llvm_type(ir->out, ptrv.type);
         sb_append(ir->out, " ");
         emit_value(ir->out, ptrv);
+        tbaa_emit_access(ir, ir->out, ty);
         sb_append(ir->out, "\n");
         return 0;
     }
@@ -104,6 +453,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         emit_llvm_type(ir->out, sd->field_types[fi]);
         sb_append(ir->out, "* ");
         ir_emit_temp(ir->out, pfield);
+        tbaa_emit_field(ir, ir->out, sty, fi);
         sb_append(ir->out, "\n");
         return 0;
     }
@@ -113,14 +463,39 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         Node *type_node = list_nth(stmt, 2);
         Node *init_node = list_nth(stmt, 3);
         const char *name = atom_text(name_node);
-        Value initv = cg_expr(ir, env, init_node);
         TypeEnv *tenv = (TypeEnv *)ir->type_env;
         TypeRef *ty = parse_type_node(tenv, type_node);
-        Value nested_last = none;
         const char *ssa = NULL;
+        Value initv;
+
+        /* A make copied into a struct-typed let, or bound to a pointer
+         * that never escapes (program.c), needs no heap allocation. */
+        if (init_node && init_node->kind == N_LIST && is_atom(list_nth(init_node, 0), "make") &&
+            (ty->kind == TY_STRUCT ||
+             (ty->kind == TY_PTR && env->stack_makes && sl_contains((StrList *)env->stack_makes, name)))) {
+            initv = cg_make_struct_local(ir, env, init_node);
+        } else {
+            initv = convert_numeric(ir, cg_expr(ir, env, init_node), ty, "let", stmt);
+        }
 
         env_add_local(env, name, ty);
         ssa = env_ssa_name(env, name);
+
+        /* Never set nor address-taken: bind the name to the value itself. */
+        if (!env_needs_memory(env, name) && binds_as_value(initv, ty)) {
+            if (initv.kind == 0) {
+                env_bind_const(env, name, initv.const_i32);
+            } else if (initv.kind == 1) {
+                char operand[32];
+                snprintf(operand, sizeof(operand), "t%d", initv.temp);
+                env_bind_value(env, name, operand);
+            } else {
+                env_bind_value(env, name, initv.ssa_name);
+            }
+            STAT_INC(ssa_bindings);
+            return cg_let_body(ir, env, stmt, ret_type, out_last);
+        }
+
         sb_append(ir->out, "  %");
         sb_append(ir->out, ssa ? ssa : name);
         sb_append(ir->out, " = alloca ");
@@ -138,6 +513,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
             emit_llvm_type(ir->out, initv.type);
             sb_append(ir->out, " ");
             emit_value(ir->out, initv);
+            tbaa_emit_access(ir, ir->out, ty);
             sb_append(ir->out, "\n");
             initv = value_temp(ty, loaded_temp);
         }
@@ -150,25 +526,17 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         emit_llvm_type(ir->out, ty);
         sb_append(ir->out, "* %");
         sb_append(ir->out, ssa ? ssa : name);
+        tbaa_emit_access(ir, ir->out, ty);
         sb_append(ir->out, "\n");
-        if (stmt->count > 4) {
-            int i;
-            for (i = 4; i < stmt->count; i++) {
-                Value tmp = none;
-                if (cg_stmt(ir, env, list_nth(stmt, i), ret_type, &tmp)) return 1;
-                if (tmp.type) nested_last = tmp;
-            }
-        }
-        if (out_last && nested_last.type) *out_last = nested_last;
-        return 0;
+        return cg_let_body(ir, env, stmt, ret_type, out_last);
     }
 
     if (is_atom(head, "set")) {
         Node *name_node = list_nth(stmt, 1);
         Node *expr_node = list_nth(stmt, 2);
         const char *name = atom_text(name_node);
-        Value v = cg_expr(ir, env, expr_node);
         TypeRef *ty = env_type(env, name);
+        Value v = convert_numeric(ir, cg_expr(ir, env, expr_node), ty, "set", stmt);
         const char *ssa = env_ssa_name(env, name);
         sb_append(ir->out, "  store ");
         emit_llvm_type(ir->out, ty);
@@ -178,6 +546,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         emit_llvm_type(ir->out, ty);
         sb_append(ir->out, "* %");
         sb_append(ir->out, ssa ? ssa : name);
+        tbaa_emit_access(ir, ir->out, ty);
         sb_append(ir->out, "\n");
         return 0;
     }
@@ -199,11 +568,21 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         Node *then_s = list_nth(stmt, 2);
         Node *else_s = list_nth(stmt, 3);
         Value cv = ensure_type_ctx_at(ir, cg_expr(ir, env, cond), type_i32(), "if-cond", cond);
-        int tcond = ir_fresh_temp(ir);
-        int then_l = ir_fresh_label(ir);
-        int else_l = ir_fresh_label(ir);
-        int end_l = ir_fresh_label(ir);
+        int tcond, then_l, else_l, end_l;
         int then_ret, else_ret;
+        int scope = env_scope_begin(env);
+
+        if (cv.kind == 0) {
+            /* Constant condition: emit only the arm that runs. */
+            STAT_INC(eliminated_branches);
+            then_ret = cg_stmt(ir, env, cv.const_i32 != 0 ? then_s : else_s, ret_type, NULL);
+            env_scope_end(env, scope);
+            return then_ret;
+        }
+        tcond = ir_fresh_temp(ir);
+        then_l = ir_fresh_label(ir);
+        else_l = ir_fresh_label(ir);
+        end_l = ir_fresh_label(ir);
 
         sb_append(ir->out, "  ");
         ir_emit_temp(ir->out, tcond);
@@ -220,6 +599,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
 
         ir_emit_label_def(ir->out, then_l);
         then_ret = cg_stmt(ir, env, then_s, ret_type, NULL);
+        env_scope_end(env, scope);
         if (!then_ret) {
             sb_append(ir->out, "  br label ");
             ir_emit_label_ref(ir->out, end_l);
@@ -228,6 +608,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
 
         ir_emit_label_def(ir->out, else_l);
         else_ret = cg_stmt(ir, env, else_s, ret_type, NULL);
+        env_scope_end(env, scope);
         if (!else_ret) {
             sb_append(ir->out, "  br label ");
             ir_emit_label_ref(ir->out, end_l);
@@ -239,6 +620,8 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         return 0;
     }
 
+    if (is_atom(head, "for")) return cg_for(ir, env, stmt, ret_type);
+
     if (is_atom(head, "while")) {
         Node *cond = list_nth(stmt, 1);
         Node *body = list_nth(stmt, 2);
@@ -246,30 +629,43 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         int body_l = ir_fresh_label(ir);
         int end_l = ir_fresh_label(ir);
         int tcond;
+        int scope;
+        Value cv;
 
         sb_append(ir->out, "  br label ");
         ir_emit_label_ref(ir->out, cond_l);
         sb_append(ir->out, "\n");
 
         ir_emit_label_def(ir->out, cond_l);
-        {
-            Value cv = ensure_type_ctx_at(ir, cg_expr(ir, env, cond), type_i32(), "while-cond", cond);
+        cv = ensure_type_ctx_at(ir, cg_expr(ir, env, cond), type_i32(), "while-cond", cond);
+        if (cv.kind == 0) {
+            /* Constant condition: the loop never runs, or never exits by its test. */
+            STAT_INC(eliminated_branches);
+            sb_append(ir->out, "  br label ");
+            ir_emit_label_ref(ir->out, cv.const_i32 != 0 ? body_l : end_l);
+            sb_append(ir->out, "\n");
+            if (cv.const_i32 == 0) {
+                ir_emit_label_def(ir->out, end_l);
+                return 0;
+            }
+        } else {
             tcond = ir_fresh_temp(ir);
             sb_append(ir->out, "  ");
             ir_emit_temp(ir->out, tcond);
             sb_append(ir->out, " = icmp ne i32 ");
             emit_i32_value(ir->out, cv);
             sb_append(ir->out, ", 0\n");
+            sb_append(ir->out, "  br i1 ");
+            ir_emit_temp(ir->out, tcond);
+            sb_append(ir->out, ", label ");
+            ir_emit_label_ref(ir->out, body_l);
+            sb_append(ir->out, ", label ");
+            ir_emit_label_ref(ir->out, end_l);
+            sb_append(ir->out, "\n");
         }
-        sb_append(ir->out, "  br i1 ");
-        ir_emit_temp(ir->out, tcond);
-        sb_append(ir->out, ", label ");
-        ir_emit_label_ref(ir->out, body_l);
-        sb_append(ir->out, ", label ");
-        ir_emit_label_ref(ir->out, end_l);
-        sb_append(ir->out, "\n");
 
         ir_emit_label_def(ir->out, body_l);
+        scope = env_scope_begin(env);
         if (!cg_stmt(ir, env, body, ret_type, NULL)) {
             sb_append(ir->out, "  br label ");
             ir_emit_label_ref(ir->out, cond_l);
@@ -277,6 +673,7 @@ int cg_stmt(IrCtx *ir, VarEnv *env, Node *stmt, TypeRef *ret_type, Value *out_la
         } else {
             /* return in body: still emit end label for validity */
         }
+        env_scope_end(env, scope);
 
         ir_emit_label_def(ir->out, end_l);
         return 0;
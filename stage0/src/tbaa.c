@@ -0,0 +1,128 @@
+#include "tbaa.h"
+
+#include "type_env.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    struct TypeEnv *tenv;
+    int scalar_tags[TY_F64 + 1]; /* access tag per TypeKind, or -1 (Void, structs) */
+    int *field_tags; /* per TypeEnv struct: tag of field 0 (field i is +i), or -1 */
+    size_t tree_len; /* bytes of ir->metadata holding the tree */
+} TbaaTable;
+
+static int md_open(IrCtx *ir) {
+    int id = ir->metadata_ids++;
+    sb_append(&ir->metadata, "!");
+    sb_printf_i32(&ir->metadata, id);
+    sb_append(&ir->metadata, " = !{");
+    return id;
+}
+
+static void md_ref(IrCtx *ir, int id) {
+    sb_append(&ir->metadata, "!");
+    sb_printf_i32(&ir->metadata, id);
+}
+
+/* !{!"NAME", !PARENT, i64 0} */
+static int md_scalar(IrCtx *ir, const char *name, int parent) {
+    int id = md_open(ir);
+    sb_append(&ir->metadata, "!\"");
+    sb_append(&ir->metadata, name);
+    sb_append(&ir->metadata, "\", ");
+    md_ref(ir, parent);
+    sb_append(&ir->metadata, ", i64 0}\n");
+    return id;
+}
+
+/* !{!BASE, !ACCESS, i64 OFFSET} */
+static int md_tag(IrCtx *ir, int base, int access, int offset) {
+    int id = md_open(ir);
+    md_ref(ir, base);
+    sb_append(&ir->metadata, ", ");
+    md_ref(ir, access);
+    sb_append(&ir->metadata, ", i64 ");
+    sb_printf_i32(&ir->metadata, offset);
+    sb_append(&ir->metadata, "}\n");
+    return id;
+}
+
+void tbaa_init(IrCtx *ir, struct TypeEnv *tenv) {
+    TbaaTable *t;
+    int nodes[TY_F64 + 1];
+    int root, ch;
+    int i, fi;
+
+    if (!ir->strict_aliasing) return;
+    t = (TbaaTable *)xmalloc(sizeof(TbaaTable));
+    t->tenv = tenv;
+    t->field_tags = (int *)xmalloc((size_t)(tenv->struct_count + 1) * sizeof(int));
+
+    root = md_open(ir);
+    sb_append(&ir->metadata, "!\"weave tbaa\"}\n");
+    ch = md_scalar(ir, "omnipotent char", root);
+    for (i = 0; i <= TY_F64; i++) nodes[i] = -1;
+    nodes[TY_I32] = md_scalar(ir, "int", ch);
+    nodes[TY_I64] = md_scalar(ir, "long long", ch);
+    nodes[TY_F32] = md_scalar(ir, "float", ch);
+    nodes[TY_F64] = md_scalar(ir, "double", ch);
+    nodes[TY_PTR] = md_scalar(ir, "any pointer", ch);
+    for (i = 0; i <= TY_F64; i++) {
+        t->scalar_tags[i] = nodes[i] < 0 ? -1 : md_tag(ir, nodes[i], nodes[i], 0);
+    }
+    nodes[TY_I8PTR] = nodes[TY_PTR];
+    t->scalar_tags[TY_I8PTR] = t->scalar_tags[TY_PTR];
+
+    for (i = 0; i < tenv->struct_count; i++) {
+        StructDef *sd = &tenv->structs[i];
+        int node;
+        t->field_tags[i] = -1;
+        if (sd->field_count == 0 || struct_field_offset(sd, sd->field_count - 1, NULL) < 0) continue;
+        node = md_open(ir);
+        sb_append(&ir->metadata, "!\"");
+        sb_append(&ir->metadata, sd->name);
+        sb_append(&ir->metadata, "\"");
+        for (fi = 0; fi < sd->field_count; fi++) {
+            sb_append(&ir->metadata, ", ");
+            md_ref(ir, nodes[sd->field_types[fi]->kind]);
+            sb_append(&ir->metadata, ", i64 ");
+            sb_printf_i32(&ir->metadata, struct_field_offset(sd, fi, NULL));
+        }
+        sb_append(&ir->metadata, "}\n");
+        for (fi = 0; fi < sd->field_count; fi++) {
+            int tag = md_tag(ir, node, nodes[sd->field_types[fi]->kind], struct_field_offset(sd, fi, NULL));
+            if (fi == 0) t->field_tags[i] = tag;
+        }
+    }
+    t->tree_len = ir->metadata.len;
+    ir->tbaa = t;
+}
+
+size_t tbaa_tree_len(IrCtx *ir) {
+    return ir->tbaa ? ((TbaaTable *)ir->tbaa)->tree_len : 0;
+}
+
+static void emit_tag(StrBuf *out, int id) {
+    sb_append(out, ", !tbaa !");
+    sb_printf_i32(out, id);
+}
+
+void tbaa_emit_access(IrCtx *ir, StrBuf *out, TypeRef *ty) {
+    TbaaTable *t = (TbaaTable *)ir->tbaa;
+    if (t && ty && ty->kind == TY_VEC) ty = ty->pointee; /* lanes alias their element type */
+    if (!t || !ty || ty->kind < 0 || ty->kind > TY_F64) return;
+    if (t->scalar_tags[ty->kind] >= 0) emit_tag(out, t->scalar_tags[ty->kind]);
+}
+
+void tbaa_emit_field(IrCtx *ir, StrBuf *out, TypeRef *sty, int fi) {
+    TbaaTable *t = (TbaaTable *)ir->tbaa;
+    StructDef *sd;
+    if (!t || !sty || sty->kind != TY_STRUCT) return;
+    sd = type_env_find_struct(t->tenv, sty->name);
+    if (!sd || fi < 0 || fi >= sd->field_count) return;
+    if (t->field_tags[sd - t->tenv->structs] >= 0) {
+        emit_tag(out, t->field_tags[sd - t->tenv->structs] + fi);
+    } else {
+        tbaa_emit_access(ir, out, sd->field_types[fi]);
+    }
+}
@@ -1,7 +1,231 @@
 // Simple test program for JIT functionality
 #include "llvm_compile.h"
+#include <dirent.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+// Removes the cache directory and the entries written into it.
+static void remove_cache_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[512];
+
+    if (d) {
+        while ((e = readdir(d)) != NULL) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+// Compile the same module in two sessions sharing a cache directory: the
+// first must miss and populate the cache, the second must hit it.
+static int check_cache_session(const char *ir, const char *dir, int pass) {
+    typedef int (*AddFunc)(int, int);
+    LLVMJITSessionRef session = llvm_jit_create_session_ex(2, dir);
+    AddFunc add_func;
+    unsigned hits = 0, misses = 0;
+
+    if (!session || llvm_jit_add_module(session, ir, strlen(ir)) != 0) {
+        printf("❌ JIT session setup failed\n");
+        if (session) llvm_jit_dispose_session(session);
+        return 1;
+    }
+    add_func = (AddFunc)llvm_jit_lookup_function(session, "add");
+    if (!add_func || add_func(1, 2) != 3) {
+        printf("❌ cached JIT function returned wrong result\n");
+        llvm_jit_dispose_session(session);
+        return 1;
+    }
+    llvm_jit_cache_stats(session, &hits, &misses);
+    llvm_jit_dispose_session(session);
+    if (pass == 0 && (hits != 0 || misses != 1)) {
+        printf("❌ expected a cache miss, got hits=%u misses=%u\n", hits, misses);
+        return 1;
+    }
+    if (pass == 1 && (hits != 1 || misses != 0)) {
+        printf("❌ expected a cache hit, got hits=%u misses=%u\n", hits, misses);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_object_cache(const char *ir) {
+    char dir[] = "/tmp/weave_jit_cache_XXXXXX";
+    int rc = 0;
+    int pass;
+
+    if (!mkdtemp(dir)) {
+        printf("❌ mkdtemp failed\n");
+        return 1;
+    }
+    for (pass = 0; pass < 2 && rc == 0; pass++) rc = check_cache_session(ir, dir, pass);
+    remove_cache_dir(dir);
+    if (rc == 0) printf("✅ JIT object cache hit on second session\n");
+    return rc;
+}
+
+static int test_tiering(void) {
+    const char *ir = "define i32 @sum_to(i32 %n) {\n"
+                     "entry:\n"
+                     "  br label %loop\n"
+                     "loop:\n"
+                     "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]\n"
+                     "  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]\n"
+                     "  %i.next = add i32 %i, 1\n"
+                     "  %acc.next = add i32 %acc, %i.next\n"
+                     "  %done = icmp sge i32 %i.next, %n\n"
+                     "  br i1 %done, label %exit, label %loop\n"
+                     "exit:\n"
+                     "  ret i32 %acc.next\n"
+                     "}\n"
+                     "define i32 @twice_sum(i32 %n) {\n"
+                     "  %s = call i32 @sum_to(i32 %n)\n"
+                     "  %r = mul i32 %s, 2\n"
+                     "  ret i32 %r\n"
+                     "}\n";
+    typedef int (*SumFunc)(int);
+    LLVMJITSessionRef session = llvm_jit_create_session_ex(0, NULL);
+    SumFunc twice_sum;
+    unsigned promoted;
+    int i;
+
+    if (!session || llvm_jit_set_tiering(session, 8, 2) != 0 ||
+        llvm_jit_add_module(session, ir, strlen(ir)) != 0) {
+        printf("❌ tiered JIT session setup failed\n");
+        return 1;
+    }
+    twice_sum = (SumFunc)llvm_jit_lookup_function(session, "twice_sum");
+    if (!twice_sum) {
+        printf("❌ tiered lookup failed\n");
+        return 1;
+    }
+    for (i = 0; i < 32; i++) {
+        if (twice_sum(10) != 110) {
+            printf("❌ tier-0 result wrong at call %d\n", i);
+            return 1;
+        }
+    }
+    promoted = llvm_jit_tier_sync(session);
+    /* Both twice_sum and sum_to crossed the threshold. */
+    if (promoted != 2) {
+        printf("❌ expected 2 promoted functions, got %u\n", promoted);
+        return 1;
+    }
+    for (i = 0; i < 32; i++) {
+        if (twice_sum(100) != 10100) {
+            printf("❌ tier-2 result wrong at call %d\n", i);
+            return 1;
+        }
+    }
+    llvm_jit_dispose_session(session);
+    printf("✅ tiered JIT promoted hot functions\n");
+    return 0;
+}
+
+// Tier-2 code must keep using the tier-0 copy of internal state.
+static int test_tiering_state(void) {
+    const char *ir = "@ctr = internal global i32 0\n"
+                     "define internal i32 @next() {\n"
+                     "  %v = load i32, i32* @ctr\n"
+                     "  %n = add i32 %v, 1\n"
+                     "  store i32 %n, i32* @ctr\n"
+                     "  ret i32 %n\n"
+                     "}\n"
+                     "define i32 @bump() {\n"
+                     "  %n = call i32 @next()\n"
+                     "  ret i32 %n\n"
+                     "}\n";
+    typedef int (*BumpFunc)(void);
+    LLVMJITSessionRef session = llvm_jit_create_session_ex(0, NULL);
+    BumpFunc bump;
+    unsigned promoted;
+    int i;
+
+    if (!session || llvm_jit_set_tiering(session, 4, 2) != 0 ||
+        llvm_jit_add_module(session, ir, strlen(ir)) != 0) {
+        printf("❌ stateful tiered JIT session setup failed\n");
+        return 1;
+    }
+    bump = (BumpFunc)llvm_jit_lookup_function(session, "bump");
+    if (!bump) {
+        printf("❌ stateful tiered lookup failed\n");
+        return 1;
+    }
+    for (i = 1; i <= 8; i++) {
+        if (bump() != i) {
+            printf("❌ tier-0 counter wrong at call %d\n", i);
+            return 1;
+        }
+    }
+    promoted = llvm_jit_tier_sync(session);
+    if (promoted != 1) {
+        printf("❌ expected 1 promoted function, got %u\n", promoted);
+        return 1;
+    }
+    for (i = 9; i <= 16; i++) {
+        if (bump() != i) {
+            printf("❌ tier-2 counter restarted: call %d returned a different count\n", i);
+            return 1;
+        }
+    }
+    llvm_jit_dispose_session(session);
+    printf("✅ tiered JIT kept internal state across promotion\n");
+    return 0;
+}
+
+// A session created with WEAVE_JIT_PERF=map must list its JIT'd functions
+// in /tmp/perf-<pid>.map.
+static int test_perf_map(void) {
+    const char *ir = "define i32 @weave_perf_probe(i32 %x) {\n"
+                     "  %r = add i32 %x, 1\n"
+                     "  ret i32 %r\n"
+                     "}\n";
+    typedef int (*ProbeFunc)(int);
+    LLVMJITSessionRef session;
+    ProbeFunc probe;
+    char path[64];
+    char line[512];
+    FILE *map;
+    int found = 0;
+
+    setenv("WEAVE_JIT_PERF", "map", 1);
+    session = llvm_jit_create_session_ex(0, NULL);
+    unsetenv("WEAVE_JIT_PERF");
+    if (!session || llvm_jit_add_module(session, ir, strlen(ir)) != 0) {
+        printf("❌ perf-map JIT session setup failed\n");
+        if (session) llvm_jit_dispose_session(session);
+        return 1;
+    }
+    probe = (ProbeFunc)llvm_jit_lookup_function(session, "weave_perf_probe");
+    if (!probe || probe(41) != 42) {
+        printf("❌ perf-map JIT function returned wrong result\n");
+        llvm_jit_dispose_session(session);
+        return 1;
+    }
+    llvm_jit_dispose_session(session);
+
+    snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+    map = fopen(path, "r");
+    if (map) {
+        while (!found && fgets(line, sizeof(line), map)) {
+            if (strstr(line, " weave_perf_probe")) found = 1;
+        }
+        fclose(map);
+        unlink(path);
+    }
+    if (!found) {
+        printf("❌ %s does not list weave_perf_probe\n", path);
+        return 1;
+    }
+    printf("✅ perf map lists JIT'd functions\n");
+    return 0;
+}
 
 int main() {
     const char *ir = "define i32 @add(i32 %a, i32 %b) {\n"
@@ -28,7 +252,10 @@ int main() {
     
     if (result == 30) {
         printf("✅ JIT execution successful!\n");
-        return 0;
+        if (test_object_cache(ir) != 0) return 1;
+        if (test_perf_map() != 0) return 1;
+        if (test_tiering() != 0) return 1;
+        return test_tiering_state();
     } else {
         printf("❌ Wrong result: expected 30, got %d\n", result);
         return 1;
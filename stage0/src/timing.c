@@ -0,0 +1,249 @@
+#include "timing.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TIMING_MAX_PHASES 128
+#define TIMING_MAX_DEPTH 32
+
+typedef struct {
+    const char *name;
+    int parent;       /* -1 for top-level phases */
+    int first_child;  /* -1 when none */
+    int next_sibling; /* -1 when last */
+    long count;
+    double wall;      /* seconds */
+    double cpu;
+} TimerPhase;
+
+typedef struct {
+    int phase; /* -1 when the phase table was full or timing is off */
+    const char *name;
+    const char *detail;
+    double wall0;
+    double cpu0;
+} TimerFrame;
+
+static __thread int timing_on = 0;
+static __thread TimerPhase phases[TIMING_MAX_PHASES];
+static __thread int phase_count = 0;
+static __thread TimerFrame frames[TIMING_MAX_DEPTH];
+static __thread int depth = 0;
+
+/* Trace events from every thread go to one file, written as they end. */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file = NULL;
+static int trace_on = 0;
+static double trace_start;
+static __thread int trace_tid = 0; /* 0 until this thread's first event */
+
+static double clock_seconds(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void timing_enable(int on) {
+    timing_on = on;
+    phase_count = 0;
+    depth = 0;
+}
+
+int timing_enabled(void) {
+    return timing_on;
+}
+
+/* The phase NAME under PARENT, created (last among its siblings) if new. */
+static int find_phase(int parent, const char *name) {
+    int i;
+    int last = -1;
+    for (i = 0; i < phase_count; i++) {
+        if (phases[i].parent != parent) continue;
+        if (strcmp(phases[i].name, name) == 0) return i;
+        if (phases[i].next_sibling < 0) last = i;
+    }
+    if (phase_count >= TIMING_MAX_PHASES) return -1;
+    i = phase_count++;
+    phases[i].name = name;
+    phases[i].parent = parent;
+    phases[i].first_child = -1;
+    phases[i].next_sibling = -1;
+    phases[i].count = 0;
+    phases[i].wall = 0;
+    phases[i].cpu = 0;
+    if (last >= 0) {
+        phases[last].next_sibling = i;
+    } else if (parent >= 0) {
+        phases[parent].first_child = i;
+    }
+    return i;
+}
+
+void timing_push(const char *name) {
+    timing_push_detail(name, NULL);
+}
+
+void timing_push_detail(const char *name, const char *detail) {
+    int parent = -1;
+    TimerFrame *f;
+    if (!timing_on && !trace_on) return;
+    if (depth >= TIMING_MAX_DEPTH) {
+        depth++; /* keep pushes and pops paired */
+        return;
+    }
+    if (depth > 0) parent = frames[depth - 1].phase;
+    f = &frames[depth++];
+    /* Below an untracked phase, record nothing. */
+    f->phase = (!timing_on || (depth > 1 && parent < 0)) ? -1 : find_phase(parent, name);
+    f->name = name;
+    f->detail = detail;
+    f->wall0 = clock_seconds(CLOCK_MONOTONIC);
+    f->cpu0 = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static void print_json_chars(FILE *out, const char *s) {
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(out, "\\%c", ch);
+        else if (ch < 0x20) fprintf(out, "\\u%04x", ch);
+        else fputc(ch, out);
+    }
+}
+
+static void print_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    print_json_chars(out, s);
+    fputc('"', out);
+}
+
+/* A complete ("X") event for F, which ended at END. */
+static void trace_event(const TimerFrame *f, double end) {
+    int pid = (int)getpid();
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_file) {
+        pthread_mutex_unlock(&trace_lock);
+        return;
+    }
+    if (!trace_tid) {
+        trace_tid = (int)syscall(SYS_gettid);
+        fprintf(trace_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}", pid, trace_tid, trace_tid == pid ? "main" : "worker");
+    }
+    fputs(",\n{\"name\":\"", trace_file);
+    print_json_chars(trace_file, f->name);
+    if (f->detail) {
+        fputc(' ', trace_file);
+        print_json_chars(trace_file, f->detail);
+    }
+    fputs("\",\"cat\":", trace_file);
+    print_json_string(trace_file, f->name);
+    fprintf(trace_file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+            (f->wall0 - trace_start) * 1e6, (end - f->wall0) * 1e6, pid, trace_tid);
+    if (f->detail) {
+        fputs(",\"args\":{\"detail\":", trace_file);
+        print_json_string(trace_file, f->detail);
+        fputc('}', trace_file);
+    }
+    fputc('}', trace_file);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void timing_pop(void) {
+    TimerFrame *f;
+    double end;
+    if ((!timing_on && !trace_on) || depth == 0) return;
+    depth--;
+    if (depth >= TIMING_MAX_DEPTH) return;
+    f = &frames[depth];
+    end = clock_seconds(CLOCK_MONOTONIC);
+    if (trace_on) trace_event(f, end);
+    if (f->phase < 0) return;
+    phases[f->phase].count++;
+    phases[f->phase].wall += end - f->wall0;
+    phases[f->phase].cpu += clock_seconds(CLOCK_THREAD_CPUTIME_ID) - f->cpu0;
+}
+
+void timing_unwind(void) {
+    while (depth > 0) timing_pop();
+}
+
+static void trace_at_exit(void) {
+    timing_unwind();
+    timing_trace_close();
+}
+
+int timing_trace_open(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file) fclose(trace_file);
+    trace_file = f;
+    trace_start = clock_seconds(CLOCK_MONOTONIC);
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"weavec0\"}}",
+            (int)getpid());
+    pthread_mutex_unlock(&trace_lock);
+    if (!trace_on) atexit(trace_at_exit);
+    trace_on = 1;
+    return 0;
+}
+
+void timing_trace_close(void) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file) {
+        fputs("\n]}\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void report_json(FILE *out, int first) {
+    int i;
+    fputc('[', out);
+    for (i = first; i >= 0; i = phases[i].next_sibling) {
+        if (i != first) fputc(',', out);
+        fputs("{\"name\":", out);
+        print_json_string(out, phases[i].name);
+        fprintf(out, ",\"count\":%ld,\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"children\":", phases[i].count,
+                phases[i].wall * 1e3, phases[i].cpu * 1e3);
+        report_json(out, phases[i].first_child);
+        fputc('}', out);
+    }
+    fputc(']', out);
+}
+
+static void report_table(FILE *out, int first, int level, double total) {
+    int i;
+    for (i = first; i >= 0; i = phases[i].next_sibling) {
+        fprintf(out, "  %10.3f %5.1f%%  %10.3f  %7ld  %*s%s\n", phases[i].wall * 1e3,
+                total > 0 ? phases[i].wall * 100.0 / total : 0.0, phases[i].cpu * 1e3, phases[i].count,
+                level * 2, "", phases[i].name);
+        report_table(out, phases[i].first_child, level + 1, total);
+    }
+}
+
+void timing_report(FILE *out, const char *input, int json) {
+    double total = 0;
+    int first = phase_count > 0 ? 0 : -1;
+    int i;
+    for (i = first; i >= 0; i = phases[i].next_sibling) total += phases[i].wall;
+
+    flockfile(out);
+    if (json) {
+        fputs("{\"input\":", out);
+        print_json_string(out, input ? input : "");
+        fputs(",\"phases\":", out);
+        report_json(out, first);
+        fputs("}\n", out);
+    } else {
+        fprintf(out, "===-- weavec0 time report: %s --===\n", input ? input : "");
+        fprintf(out, "   Wall (ms)   Wall%%    CPU (ms)    Count  Phase\n");
+        report_table(out, first, 0, total);
+    }
+    funlockfile(out);
+}
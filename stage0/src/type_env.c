@@ -1,5 +1,7 @@
 #include "type_env.h"
 
+#include "mem_stats.h"
+
 #include <string.h>
 
 static void reserve_aliases(TypeEnv *e, int need) {
@@ -30,6 +32,7 @@ void type_env_init(TypeEnv *e) {
 }
 
 void type_env_add_alias(TypeEnv *e, const char *name, TypeRef *target) {
+    MemCategory prev;
     int i;
     for (i = 0; i < e->alias_count; i++) {
         if (strcmp(e->aliases[i].name, name) == 0) {
@@ -37,8 +40,10 @@ void type_env_add_alias(TypeEnv *e, const char *name, TypeRef *target) {
             return;
         }
     }
+    prev = mem_category_enter(MEM_TYPES);
     reserve_aliases(e, e->alias_count + 1);
     e->aliases[e->alias_count].name = xstrdup(name);
+    mem_category_leave(prev);
     e->aliases[e->alias_count].target = target;
     e->alias_count += 1;
 }
@@ -55,6 +60,7 @@ TypeRef *type_env_resolve_alias(TypeEnv *e, const char *name) {
 void type_env_add_struct(TypeEnv *e, const char *name, int field_count, char **field_names, TypeRef **field_types) {
     int i;
     StructDef *s;
+    MemCategory prev;
     for (i = 0; i < e->struct_count; i++) {
         if (strcmp(e->structs[i].name, name) == 0) {
             /* Replace (minimal). */
@@ -64,9 +70,11 @@ void type_env_add_struct(TypeEnv *e, const char *name, int field_count, char **f
             return;
         }
     }
+    prev = mem_category_enter(MEM_TYPES);
     reserve_structs(e, e->struct_count + 1);
     s = &e->structs[e->struct_count];
     s->name = xstrdup(name);
+    mem_category_leave(prev);
     s->field_count = field_count;
     s->field_names = field_names;
     s->field_types = field_types;
@@ -90,3 +98,23 @@ int struct_field_index(StructDef *s, const char *field) {
     return -1;
 }
 
+int struct_field_offset(StructDef *s, int fi, int *size) {
+    int off = 0;
+    int i;
+    if (!s || fi < 0 || fi >= s->field_count) return -1;
+    for (i = 0; i <= fi; i++) {
+        TypeRef *t = s->field_types[i];
+        int n;
+        if (t->kind == TY_I32 || t->kind == TY_F32) n = 4;
+        else if (t->kind == TY_I8PTR || t->kind == TY_PTR || t->kind == TY_I64 || t->kind == TY_F64) n = 8;
+        else return -1;
+        off = (off + n - 1) & ~(n - 1);
+        if (i == fi) {
+            if (size) *size = n;
+            return off;
+        }
+        off += n;
+    }
+    return -1;
+}
+
@@ -1,5 +1,7 @@
 #include "types.h"
 
+#include "diagnostics.h"
+#include "mem_stats.h"
 #include "type_env.h"
 
 #include <stdio.h>
@@ -9,16 +11,25 @@
 static TypeRef g_i32 = { TY_I32, NULL, NULL };
 static TypeRef g_i8ptr = { TY_I8PTR, NULL, NULL };
 static TypeRef g_void = { TY_VOID, NULL, NULL };
+static TypeRef g_i64 = { TY_I64, NULL, NULL };
+static TypeRef g_f32 = { TY_F32, NULL, NULL };
+static TypeRef g_f64 = { TY_F64, NULL, NULL };
 
 TypeRef *type_i32(void) { return &g_i32; }
 TypeRef *type_i8ptr(void) { return &g_i8ptr; }
 TypeRef *type_void(void) { return &g_void; }
+TypeRef *type_i64(void) { return &g_i64; }
+TypeRef *type_f32(void) { return &g_f32; }
+TypeRef *type_f64(void) { return &g_f64; }
 
 TypeRef *type_struct(const char *name) {
+    MemCategory prev = mem_category_enter(MEM_TYPES);
     TypeRef *t = (TypeRef *)xmalloc(sizeof(TypeRef));
     t->kind = TY_STRUCT;
     t->name = xstrdup(name ? name : "");
     t->pointee = NULL;
+    t->lanes = 0;
+    mem_category_leave(prev);
     /* Debug: track TypeRef allocation */
     if (getenv("WEAVEC0_DEBUG_MEM")) {
         fprintf(stderr, "[mem] type_struct allocated: %p, kind=%d, name='%s'\n",
@@ -28,10 +39,13 @@ TypeRef *type_struct(const char *name) {
 }
 
 TypeRef *type_ptr(TypeRef *pointee) {
+    MemCategory prev = mem_category_enter(MEM_TYPES);
     TypeRef *t = (TypeRef *)xmalloc(sizeof(TypeRef));
+    mem_category_leave(prev);
     t->kind = TY_PTR;
     t->name = NULL;
     t->pointee = pointee;
+    t->lanes = 0;
     /* Debug: track TypeRef allocation */
     if (getenv("WEAVEC0_DEBUG_MEM")) {
         fprintf(stderr, "[mem] type_ptr allocated: %p, kind=%d, pointee=%p\n",
@@ -40,15 +54,39 @@ TypeRef *type_ptr(TypeRef *pointee) {
     return t;
 }
 
+TypeRef *type_vec(TypeRef *elem, int lanes) {
+    MemCategory prev = mem_category_enter(MEM_TYPES);
+    TypeRef *t = (TypeRef *)xmalloc(sizeof(TypeRef));
+    mem_category_leave(prev);
+    t->kind = TY_VEC;
+    t->name = NULL;
+    t->pointee = elem;
+    t->lanes = lanes;
+    return t;
+}
+
+int type_vec_lanes_valid(long lanes) {
+    return lanes >= 2 && lanes <= 64 && (lanes & (lanes - 1)) == 0;
+}
+
 int type_eq(TypeRef *a, TypeRef *b) {
     if (a == b) return 1;
     if (!a || !b) return 0;
     if (a->kind != b->kind) return 0;
     if (a->kind == TY_STRUCT) return strcmp(a->name ? a->name : "", b->name ? b->name : "") == 0;
     if (a->kind == TY_PTR) return type_eq(a->pointee, b->pointee);
+    if (a->kind == TY_VEC) return a->lanes == b->lanes && type_eq(a->pointee, b->pointee);
     return 1;
 }
 
+int type_is_int(TypeRef *t) {
+    return t && (t->kind == TY_I32 || t->kind == TY_I64);
+}
+
+int type_is_float(TypeRef *t) {
+    return t && (t->kind == TY_F32 || t->kind == TY_F64);
+}
+
 void emit_llvm_type(StrBuf *out, TypeRef *t) {
     if (!t) {
         sb_append(out, "i32");
@@ -57,12 +95,21 @@ void emit_llvm_type(StrBuf *out, TypeRef *t) {
     if (t->kind == TY_I32) sb_append(out, "i32");
     else if (t->kind == TY_I8PTR) sb_append(out, "i8*");
     else if (t->kind == TY_VOID) sb_append(out, "void");
+    else if (t->kind == TY_I64) sb_append(out, "i64");
+    else if (t->kind == TY_F32) sb_append(out, "float");
+    else if (t->kind == TY_F64) sb_append(out, "double");
     else if (t->kind == TY_STRUCT) {
         sb_append(out, "%");
         sb_append(out, t->name ? t->name : "");
     } else if (t->kind == TY_PTR) {
         emit_llvm_type(out, t->pointee);
         sb_append(out, "*");
+    } else if (t->kind == TY_VEC) {
+        sb_append(out, "<");
+        sb_printf_i32(out, t->lanes);
+        sb_append(out, " x ");
+        emit_llvm_type(out, t->pointee);
+        sb_append(out, ">");
     } else {
         sb_append(out, "i32");
     }
@@ -80,7 +127,7 @@ TypeRef *parse_type_node(TypeEnv *tenv, Node *n) {
     TypeRef *alias;
     if (!n) return type_i32();
 
-    /* Handle list types: (ptr T) or (struct Name) */
+    /* Handle list types: (ptr T), (vec T N) or (struct Name) */
     if (n->kind == N_LIST) {
         Node *head = list_nth(n, 0);
         if (head && is_atom(head, "ptr")) {
@@ -99,6 +146,19 @@ TypeRef *parse_type_node(TypeEnv *tenv, Node *n) {
             /* If inner is already a pointer, that means (ptr (ptr T)) which is valid */
             return type_ptr(inner);
         }
+        if (is_atom(head, "vec")) {
+            TypeRef *elem = parse_type_node(tenv, list_nth(n, 1));
+            Node *lanes_node = list_nth(n, 2);
+            const char *lanes_text = lanes_node && lanes_node->kind == N_ATOM ? atom_text(lanes_node) : NULL;
+            char *endp = NULL;
+            long lanes = lanes_text ? strtol(lanes_text, &endp, 10) : 0;
+            if (n->count != 3 || !(type_is_int(elem) || type_is_float(elem)) || !endp || *endp != '\0' ||
+                !type_vec_lanes_valid(lanes)) {
+                diag_fatal(n->filename, n->line, n->col, "invalid-type", "malformed (vec T N) type",
+                           "T is Int32, Int64, Float32 or Float64 and N a power of two from 2 to 64");
+            }
+            return type_vec(elem, (int)lanes);
+        }
         if (is_atom(head, "struct")) {
             Node *name_node = list_nth(n, 1);
             if (name_node && name_node->kind == N_ATOM) {
@@ -110,11 +170,14 @@ TypeRef *parse_type_node(TypeEnv *tenv, Node *n) {
         return type_i32();
     }
 
-    /* Handle atom types: Int32, String, Arena, etc. */
+    /* Handle atom types: Int32, Int64, Float64, String, Arena, etc. */
     if (n->kind != N_ATOM) return type_i32();
     s = atom_text(n);
     if (!s) return type_i32();
     if (strcmp(s, "Int32") == 0) return type_i32();
+    if (strcmp(s, "Int64") == 0) return type_i64();
+    if (strcmp(s, "Float32") == 0) return type_f32();
+    if (strcmp(s, "Float64") == 0) return type_f64();
     if (strcmp(s, "Void") == 0) return type_void();
     if (is_handle_name(s)) return type_i8ptr();
 
@@ -1,10 +1,15 @@
 #include "codegen.h"
 
+#include <stdio.h>
+#include <string.h>
+
 Value value_const_i32(int v) {
     Value out;
     out.type = type_i32();
     out.kind = 0;
     out.const_i32 = v;
+    out.const_i64 = v;
+    out.const_f64 = v;
     out.temp = -1;
     out.ssa_name = NULL;
     out.is_const = 1;
@@ -18,6 +23,8 @@ Value value_temp(TypeRef *t, int temp) {
     out.type = t;
     out.kind = 1;
     out.const_i32 = 0;
+    out.const_i64 = 0;
+    out.const_f64 = 0;
     out.temp = temp;
     out.ssa_name = NULL;
     out.is_const = 0;
@@ -31,6 +38,8 @@ Value value_ssa(TypeRef *t, const char *name) {
     out.type = t;
     out.kind = 2;
     out.const_i32 = 0;
+    out.const_i64 = 0;
+    out.const_f64 = 0;
     out.temp = -1;
     out.ssa_name = name;
     out.is_const = 0;
@@ -38,3 +47,35 @@ Value value_ssa(TypeRef *t, const char *name) {
     out.is_boxed = 0;
     return out;
 }
+
+Value value_const_i64(long long v) {
+    Value out = value_const_i32((int)v);
+    out.type = type_i64();
+    out.kind = 3;
+    out.const_i64 = v;
+    out.const_f64 = (double)v;
+    return out;
+}
+
+Value value_const_float(TypeRef *t, double v) {
+    Value out = value_const_i32(0);
+    out.type = t;
+    out.kind = 3;
+    out.const_f64 = t && t->kind == TY_F32 ? (double)(float)v : v;
+    out.const_i64 = 0;
+    return out;
+}
+
+void emit_const_literal(StrBuf *out, Value v) {
+    char buf[32];
+    if (v.type && v.type->kind == TY_I64) {
+        snprintf(buf, sizeof(buf), "%lld", v.const_i64);
+    } else {
+        /* LLVM spells both float and double constants as the hex bits of
+         * the double; Float32 values were rounded when constructed. */
+        unsigned long long bits;
+        memcpy(&bits, &v.const_f64, sizeof(bits));
+        snprintf(buf, sizeof(buf), "0x%016llX", bits);
+    }
+    sb_append(out, buf);
+}
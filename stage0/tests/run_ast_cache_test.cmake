@@ -0,0 +1,62 @@
+foreach(var WEAVEC0 CLANG TEST_FILE OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(SRC "${OUT_DIR}/input.weave")
+set(STORE "${OUT_DIR}/ast")
+set(LL "${OUT_DIR}/input.ll")
+set(EXE "${OUT_DIR}/input")
+configure_file("${TEST_FILE}" "${SRC}" COPYONLY)
+
+# Compiles SRC with the AST store and checks the hit/miss counts --stats
+# reports for it.
+function(compile_expect step hits misses)
+  execute_process(
+    COMMAND "${WEAVEC0}" --ast-cache-dir "${STORE}" --stats "${SRC}" -S -o "${LL}"
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${step}: weavec0 failed (rc=${rc}):\n${err}")
+  endif()
+  if(NOT out MATCHES "AST store: ${hits} hit\\(s\\), ${misses} miss\\(es\\)")
+    message(FATAL_ERROR "${step}: expected ${hits} hit(s), ${misses} miss(es):\n${out}")
+  endif()
+endfunction()
+
+compile_expect("cold" 0 1)
+compile_expect("warm" 1 0)
+
+# An edited source has a different content hash.
+file(APPEND "${SRC}" ";; edited\n")
+compile_expect("edited" 0 1)
+compile_expect("edited, warm" 1 0)
+
+# A corrupt entry is ignored and rewritten.
+file(GLOB entries "${STORE}/*.wast")
+if(NOT entries)
+  message(FATAL_ERROR "no .wast entries in ${STORE}")
+endif()
+foreach(entry IN LISTS entries)
+  file(READ "${entry}" head LIMIT 64 HEX)
+  file(WRITE "${entry}" "WAST garbage ${head}")
+endforeach()
+compile_expect("corrupt" 0 1)
+compile_expect("rewritten" 1 0)
+
+execute_process(
+  COMMAND "${CLANG}" -Wno-null-character "${LL}" -lm -o "${EXE}"
+  RESULT_VARIABLE rc
+)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "clang failed (rc=${rc}) for ${LL}")
+endif()
+execute_process(COMMAND "${EXE}" RESULT_VARIABLE rc)
+if(NOT rc EQUAL 42)
+  message(FATAL_ERROR "expected exit code 42, got ${rc} for ${TEST_FILE}")
+endif()
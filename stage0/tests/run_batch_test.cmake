@@ -0,0 +1,45 @@
+foreach(var WEAVEC0 CLANG TEST_FILES OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+# TEST_FILES is space-separated so it survives the add_test command line.
+separate_arguments(inputs UNIX_COMMAND "${TEST_FILES}")
+
+# One failing input must fail the batch without stopping the others.
+set(BAD "${OUT_DIR}/bad_input.weave")
+file(WRITE "${BAD}" "(program (name \"bad\") (entry main (params ()) (returns Int32) (body (return (cast Nope 1)))))\n")
+
+execute_process(
+  COMMAND "${WEAVEC0}" -j 4 --out-dir "${OUT_DIR}/out" -S ${inputs} "${BAD}"
+  ERROR_VARIABLE err
+  RESULT_VARIABLE rc
+)
+if(rc EQUAL 0)
+  message(FATAL_ERROR "batch with a failing input exited 0")
+endif()
+list(LENGTH inputs n)
+math(EXPR total "${n} + 1")
+if(NOT err MATCHES "1 of ${total} input\\(s\\) failed")
+  message(FATAL_ERROR "expected one failed input, got:\n${err}")
+endif()
+
+foreach(input IN LISTS inputs)
+  get_filename_component(name "${input}" NAME_WE)
+  set(LL "${OUT_DIR}/out/${name}.ll")
+  set(EXE "${OUT_DIR}/${name}")
+  execute_process(
+    COMMAND "${CLANG}" -Wno-null-character "${LL}" -lm -o "${EXE}"
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "clang failed (rc=${rc}) for ${LL}")
+  endif()
+  execute_process(COMMAND "${EXE}" RESULT_VARIABLE rc)
+  if(NOT rc EQUAL 42)
+    message(FATAL_ERROR "expected exit code 42, got ${rc} for ${input}")
+  endif()
+endforeach()
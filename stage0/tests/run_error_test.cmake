@@ -0,0 +1,23 @@
+# Compiles TEST_FILE and expects weavec0 to reject it with a diagnostic
+# matching EXPECT_ERROR (a regex, e.g. the [code]).
+foreach(var WEAVEC0 TEST_FILE OUT_DIR EXPECT_ERROR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(MAKE_DIRECTORY "${OUT_DIR}")
+get_filename_component(TEST_NAME "${TEST_FILE}" NAME_WE)
+
+execute_process(
+  COMMAND "${WEAVEC0}" "${TEST_FILE}" -S -o "${OUT_DIR}/${TEST_NAME}.ll"
+  OUTPUT_VARIABLE out
+  ERROR_VARIABLE err
+  RESULT_VARIABLE rc
+)
+if(rc EQUAL 0)
+  message(FATAL_ERROR "weavec0 accepted ${TEST_FILE}; expected an error matching '${EXPECT_ERROR}'")
+endif()
+if(NOT err MATCHES "${EXPECT_ERROR}")
+  message(FATAL_ERROR "expected an error matching '${EXPECT_ERROR}' for ${TEST_FILE}, got:\n${err}")
+endif()
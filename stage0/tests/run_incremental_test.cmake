@@ -0,0 +1,58 @@
+foreach(var WEAVEC0 CLANG TEST_FILE OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(SRC "${OUT_DIR}/input.weave")
+set(INCR "${OUT_DIR}/incr")
+set(LL "${OUT_DIR}/input.ll")
+set(EXE "${OUT_DIR}/input")
+configure_file("${TEST_FILE}" "${SRC}" COPYONLY)
+
+# Compiles SRC against the incremental directory and checks the function
+# counts --stats reports for it, then links and runs the result.
+function(compile_expect step reused recompiled)
+  execute_process(
+    COMMAND "${WEAVEC0}" --incremental-dir "${INCR}" --stats "${SRC}" -S -o "${LL}"
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${step}: weavec0 failed (rc=${rc}):\n${err}")
+  endif()
+  if(NOT out MATCHES "Functions: ${reused} reused, ${recompiled} recompiled")
+    message(FATAL_ERROR "${step}: expected ${reused} reused, ${recompiled} recompiled:\n${out}")
+  endif()
+  execute_process(
+    COMMAND "${CLANG}" -Wno-null-character "${LL}" -lm -o "${EXE}"
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${step}: clang failed (rc=${rc}) for ${LL}")
+  endif()
+  execute_process(COMMAND "${EXE}" OUTPUT_VARIABLE out RESULT_VARIABLE rc)
+  if(NOT rc EQUAL 42)
+    message(FATAL_ERROR "${step}: expected exit code 42, got ${rc}")
+  endif()
+  set(RUN_OUTPUT "${out}" PARENT_SCOPE)
+endfunction()
+
+compile_expect("cold" 0 2)
+compile_expect("warm" 2 0)
+
+# Editing greet's body recompiles greet alone; main is reused.
+file(READ "${SRC}" text)
+string(REPLACE "hello from greet" "hello again from greet" edited "${text}")
+if(edited STREQUAL text)
+  message(FATAL_ERROR "${TEST_FILE} has no \"hello from greet\" to edit")
+endif()
+file(WRITE "${SRC}" "${edited}")
+compile_expect("edited" 1 1)
+if(NOT RUN_OUTPUT MATCHES "hello again from greet")
+  message(FATAL_ERROR "edited: stale greet output:\n${RUN_OUTPUT}")
+endif()
+compile_expect("edited, warm" 2 0)
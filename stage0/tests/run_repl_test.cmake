@@ -0,0 +1,35 @@
+if(NOT DEFINED WEAVEC0)
+  message(FATAL_ERROR "WEAVEC0 not set")
+endif()
+if(NOT DEFINED INPUT_FILE)
+  message(FATAL_ERROR "INPUT_FILE not set")
+endif()
+
+# Feed a scripted session to weavec0 --repl (stdin is not a tty, so no
+# prompts are printed) and compare the printed results.
+execute_process(
+  COMMAND "${WEAVEC0}" --repl
+  INPUT_FILE "${INPUT_FILE}"
+  OUTPUT_VARIABLE out
+  ERROR_VARIABLE err
+  RESULT_VARIABLE rc
+)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "weavec0 --repl failed (rc=${rc}):\n${err}")
+endif()
+
+set(expected "=> 42\n=> 6\n=> \"hi\"\n=> 3\n=> 8\n=> 63\n=> 6\n=> 15\n")
+if(NOT out STREQUAL expected)
+  message(FATAL_ERROR "unexpected REPL output:\n${out}\nexpected:\n${expected}")
+endif()
+foreach(diag
+    "error: \\[type-mismatch\\]"
+    "'g' could not be linked"
+    "error: \\[unbound-function\\]: 'g'"
+    "'twice' could not be linked"
+    "error: \\[repl-let\\]"
+    "error: \\[unbound-variable\\]: 'q'")
+  if(NOT err MATCHES "${diag}")
+    message(FATAL_ERROR "expected a diagnostic matching '${diag}', got:\n${err}")
+  endif()
+endforeach()
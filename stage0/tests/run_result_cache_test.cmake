@@ -0,0 +1,67 @@
+foreach(var WEAVEC0 CLANG TEST_FILE OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(STORE "${OUT_DIR}/cache")
+
+# A second program that differs from TEST_FILE only in its exit code.
+file(READ "${TEST_FILE}" text)
+string(REPLACE "(return 42)" "(return 17)" other "${text}")
+if(other STREQUAL text)
+  message(FATAL_ERROR "${TEST_FILE} has no (return 42) to edit")
+endif()
+configure_file("${TEST_FILE}" "${OUT_DIR}/a.weave" COPYONLY)
+file(WRITE "${OUT_DIR}/b.weave" "${other}")
+
+# Compiles NAME.weave through the result cache, checks what --stats says
+# about the cache, then links and runs the result.
+function(compile_expect step name result code)
+  set(ll "${OUT_DIR}/${name}.ll")
+  set(exe "${OUT_DIR}/${name}")
+  file(REMOVE "${ll}")
+  execute_process(
+    COMMAND "${WEAVEC0}" --cache-dir "${STORE}" --stats "${OUT_DIR}/${name}.weave" -S -o "${ll}"
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${step}: weavec0 failed (rc=${rc}):\n${err}")
+  endif()
+  if(NOT out MATCHES "Result cache: ${result}")
+    message(FATAL_ERROR "${step}: expected a result cache ${result}:\n${out}")
+  endif()
+  execute_process(
+    COMMAND "${CLANG}" -Wno-null-character "${ll}" -lm -o "${exe}"
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${step}: clang failed (rc=${rc}) for ${ll}")
+  endif()
+  execute_process(COMMAND "${exe}" RESULT_VARIABLE rc)
+  if(NOT rc EQUAL code)
+    message(FATAL_ERROR "${step}: expected exit code ${code}, got ${rc}")
+  endif()
+endfunction()
+
+compile_expect("cold" a miss 42)
+compile_expect("warm" a hit 42)
+file(GLOB a_entry "${STORE}/*.out")
+
+compile_expect("other program" b miss 17)
+file(GLOB entries "${STORE}/*.out")
+list(REMOVE_ITEM entries ${a_entry})
+list(LENGTH entries n)
+if(NOT n EQUAL 1)
+  message(FATAL_ERROR "expected one new entry for b.weave, found ${n}")
+endif()
+
+# A different key stored under a's file name (as in a hash collision) must
+# not be returned for a.
+configure_file("${entries}" "${a_entry}" COPYONLY)
+compile_expect("colliding entry" a miss 42)
+compile_expect("rewritten" a hit 42)
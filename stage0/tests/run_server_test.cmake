@@ -0,0 +1,54 @@
+foreach(var WEAVEC0 CLANG TEST_FILE OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(SOCK "${OUT_DIR}/weavec0.sock")
+set(LL "${OUT_DIR}/server.ll")
+set(EXE "${OUT_DIR}/server")
+
+# Start a compile server in the background and wait for its socket.
+execute_process(
+  COMMAND sh -c "\"$0\" --server \"$1\" >\"$2\" 2>&1 & echo $!" "${WEAVEC0}" "${SOCK}" "${OUT_DIR}/server.log"
+  OUTPUT_VARIABLE server_pid
+  OUTPUT_STRIP_TRAILING_WHITESPACE
+)
+foreach(i RANGE 50)
+  if(EXISTS "${SOCK}")
+    break()
+  endif()
+  execute_process(COMMAND "${CMAKE_COMMAND}" -E sleep 0.1)
+endforeach()
+
+# Compile twice through it. Only a served compile reports the server's
+# in-memory AST cache, so --stats tells a served compile from the local
+# fallback.
+foreach(run 1 2)
+  execute_process(
+    COMMAND "${WEAVEC0}" --connect "${SOCK}" "${TEST_FILE}" -S -o "${LL}" --stats
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0 OR NOT out MATCHES "AST cache: [1-9][0-9]* hit")
+    execute_process(COMMAND kill ${server_pid})
+    message(FATAL_ERROR "compile ${run} was not served (rc=${rc}):\n${out}\n${err}")
+  endif()
+endforeach()
+execute_process(COMMAND kill ${server_pid})
+file(REMOVE "${SOCK}")
+
+execute_process(
+  COMMAND "${CLANG}" -Wno-null-character "${LL}" -lm -o "${EXE}"
+  RESULT_VARIABLE rc
+)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "clang failed (rc=${rc}) for ${LL}")
+endif()
+execute_process(COMMAND "${EXE}" RESULT_VARIABLE rc)
+if(NOT rc EQUAL 42)
+  message(FATAL_ERROR "expected exit code 42, got ${rc} for ${TEST_FILE}")
+endif()
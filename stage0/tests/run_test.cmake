@@ -17,17 +17,41 @@ get_filename_component(TEST_NAME "${TEST_FILE}" NAME_WE)
 set(LL "${OUT_DIR}/${TEST_NAME}.ll")
 set(EXE "${OUT_DIR}/${TEST_NAME}")
 
+# Optional extra compiler flags (space-separated), e.g. --inline-llvm-jit.
+separate_arguments(WEAVEC0_EXTRA_FLAGS UNIX_COMMAND "${WEAVEC0_FLAGS}")
+
 execute_process(
-  COMMAND "${WEAVEC0}" "${TEST_FILE}" -S -o "${LL}"
+  COMMAND "${WEAVEC0}" ${WEAVEC0_EXTRA_FLAGS} "${TEST_FILE}" -S -o "${LL}"
   RESULT_VARIABLE rc
 )
 if(NOT rc EQUAL 0)
   message(FATAL_ERROR "weavec0 failed (rc=${rc}) on ${TEST_FILE}")
 endif()
 
-# Link (no runtime needed - arena-create uses only malloc which is in libc)
+# Optional lists of regexes the emitted IR must (EXPECT_IR) or must not
+# (REJECT_IR) match, e.g. inferred attributes that the exit code cannot show.
+file(READ "${LL}" ir)
+foreach(re IN LISTS EXPECT_IR)
+  if(NOT ir MATCHES "${re}")
+    message(FATAL_ERROR "${LL} does not match '${re}'")
+  endif()
+endforeach()
+foreach(re IN LISTS REJECT_IR)
+  if(ir MATCHES "${re}")
+    message(FATAL_ERROR "${LL} matches '${re}': ${CMAKE_MATCH_0}")
+  endif()
+endforeach()
+
+# Link (no runtime needed - arena-create uses only malloc which is in libc).
+# LINK_LIB optionally names a shared library the program calls into, e.g.
+# the llvm-jit runtime.
+set(LINK_ARGS "")
+if(DEFINED LINK_LIB)
+  get_filename_component(LINK_LIB_DIR "${LINK_LIB}" DIRECTORY)
+  set(LINK_ARGS "${LINK_LIB}" "-Wl,-rpath,${LINK_LIB_DIR}")
+endif()
 execute_process(
-  COMMAND "${CLANG}" -Wno-null-character "${LL}" -lm -o "${EXE}"
+  COMMAND "${CLANG}" -Wno-null-character "${LL}" ${LINK_ARGS} -lm -o "${EXE}"
   RESULT_VARIABLE rc
 )
 if(NOT rc EQUAL 0)
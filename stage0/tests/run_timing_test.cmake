@@ -0,0 +1,132 @@
+# --time-report=json and --trace: the report parses and has one "total"
+# phase, also for --list-tests, and the trace is valid JSON whose spans nest
+# inside the "total" span, also for a compile that fails.
+foreach(var WEAVEC0 TEST_FILE OUT_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} not set")
+  endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUT_DIR}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(BAD "${OUT_DIR}/syntax_error.weave")
+file(WRITE "${BAD}" "(program\n  (entry main\n    (params ())\n    (returns Int32)\n    (body (return 42)\n")
+
+# Runs weavec0 with ARGN and the time report in OUT_DIR/NAME.json; checks
+# that it is one JSON object with a single top-level "total" phase that
+# contains CHILD.
+function(check_time_report name child)
+  set(report "${OUT_DIR}/${name}.json")
+  execute_process(
+    COMMAND "${WEAVEC0}" --time-report=json "--time-report-file=${report}" ${ARGN}
+    OUTPUT_QUIET
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc
+  )
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${name}: weavec0 failed (rc=${rc}):\n${err}")
+  endif()
+  file(READ "${report}" json)
+  string(JSON n ERROR_VARIABLE jerr LENGTH "${json}" phases)
+  if(jerr)
+    message(FATAL_ERROR "${name}: bad time report (${jerr}):\n${json}")
+  endif()
+  string(JSON top GET "${json}" phases 0 name)
+  string(JSON count GET "${json}" phases 0 count)
+  if(NOT n EQUAL 1 OR NOT top STREQUAL "total" OR NOT count EQUAL 1)
+    message(FATAL_ERROR "${name}: expected a single total phase:\n${json}")
+  endif()
+  string(JSON children GET "${json}" phases 0 children)
+  if(NOT children MATCHES "\"name\" : \"${child}\"")
+    message(FATAL_ERROR "${name}: no ${child} phase under total:\n${json}")
+  endif()
+endfunction()
+
+# Whole microseconds of a trace timestamp.
+function(trace_us var value)
+  if(NOT value MATCHES "^([0-9]+)")
+    message(FATAL_ERROR "bad trace time: ${value}")
+  endif()
+  set(${var} ${CMAKE_MATCH_1} PARENT_SCOPE)
+endfunction()
+
+# Checks the trace in FILE: every event is metadata ("M") or a complete
+# span ("X"), and exactly one span is "total" with every other span on its
+# thread inside it (within rounding). EXPECT is a span that must be there.
+function(check_trace name file expect)
+  file(READ "${file}" json)
+  string(JSON n ERROR_VARIABLE jerr LENGTH "${json}" traceEvents)
+  if(jerr)
+    message(FATAL_ERROR "${name}: trace is not valid JSON (${jerr}):\n${json}")
+  endif()
+  math(EXPR last "${n} - 1")
+  set(totals 0)
+  set(spans "")
+  foreach(i RANGE 0 ${last})
+    string(JSON ph GET "${json}" traceEvents ${i} ph)
+    if(ph STREQUAL "X")
+      string(JSON cat GET "${json}" traceEvents ${i} cat)
+      string(JSON ts GET "${json}" traceEvents ${i} ts)
+      string(JSON dur GET "${json}" traceEvents ${i} dur)
+      trace_us(ts "${ts}")
+      trace_us(dur "${dur}")
+      math(EXPR end "${ts} + ${dur}")
+      if(cat STREQUAL "total")
+        math(EXPR totals "${totals} + 1")
+        set(total_ts ${ts})
+        set(total_end ${end})
+      else()
+        list(APPEND spans "${cat}:${ts}:${end}")
+      endif()
+    elseif(NOT ph STREQUAL "M")
+      message(FATAL_ERROR "${name}: unexpected event phase '${ph}'")
+    endif()
+  endforeach()
+  if(NOT totals EQUAL 1)
+    message(FATAL_ERROR "${name}: expected one total span, found ${totals}:\n${json}")
+  endif()
+  set(found 0)
+  foreach(span IN LISTS spans)
+    string(REPLACE ":" ";" span "${span}")
+    list(GET span 0 cat)
+    list(GET span 1 ts)
+    list(GET span 2 end)
+    if(ts LESS total_ts OR end GREATER total_end)
+      math(EXPR slack_ts "${ts} + 1")
+      math(EXPR slack_end "${end} - 2")
+      if(slack_ts LESS total_ts OR slack_end GREATER total_end)
+        message(FATAL_ERROR "${name}: ${cat} span is outside total:\n${json}")
+      endif()
+    endif()
+    if(cat STREQUAL expect)
+      set(found 1)
+    endif()
+  endforeach()
+  if(NOT found)
+    message(FATAL_ERROR "${name}: no ${expect} span:\n${json}")
+  endif()
+endfunction()
+
+check_time_report(compile "codegen" "${TEST_FILE}" -S -o "${OUT_DIR}/out.ll")
+check_time_report(list_tests "merge includes" --list-tests "${TEST_FILE}")
+
+execute_process(
+  COMMAND "${WEAVEC0}" "--trace=${OUT_DIR}/trace.json" "${TEST_FILE}" -S -o "${OUT_DIR}/out.ll"
+  RESULT_VARIABLE rc
+)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "trace: weavec0 failed (rc=${rc})")
+endif()
+check_trace(trace "${OUT_DIR}/trace.json" "codegen")
+
+# A syntax error exits from inside "parse": the trace still ends every span.
+execute_process(
+  COMMAND "${WEAVEC0}" "--trace=${OUT_DIR}/failed.json" "${BAD}" -S -o "${OUT_DIR}/bad.ll"
+  OUTPUT_QUIET
+  ERROR_QUIET
+  RESULT_VARIABLE rc
+)
+if(rc EQUAL 0)
+  message(FATAL_ERROR "failed trace: weavec0 accepted ${BAD}")
+endif()
+check_trace(failed_trace "${OUT_DIR}/failed.json" "parse")